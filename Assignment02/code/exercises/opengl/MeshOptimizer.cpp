@@ -0,0 +1,257 @@
+#include "MeshOptimizer.hpp"
+
+namespace ogl
+{
+
+// FIFO cache simulation by time stamps: a vertex is cached while less than
+// cacheSize other vertices have been inserted after it
+struct VertexCacheSimulation
+{
+  VertexCacheSimulation(size_t numVertices, size_t cacheSize) :
+    stamps(numVertices,0), time(cacheSize+1), size(cacheSize) {}
+
+  // Returns 1 on a cache miss, 0 on a hit
+  unsigned int access(unsigned int v)
+  {
+    if(time-stamps[v] <= size)
+      return 0;
+    stamps[v]=time++;
+    return 1;
+  }
+
+  void reset() { time+=size+1; }
+
+  std::vector<size_t> stamps;
+  size_t time;
+  size_t size;
+};
+
+float MeshOptimizer::computeACMR(const std::vector<unsigned int>& t, size_t numVertices, size_t cacheSize)
+{
+  if(t.size() < 3)
+    return 0.f;
+
+  VertexCacheSimulation cache(numVertices,cacheSize);
+  size_t misses=0;
+  for(size_t i=0;i<t.size();++i)
+    misses+=cache.access(t[i]);
+  return float(misses)/float(t.size()/3);
+}
+
+// Returns a vertex with remaining triangles from the dead-end stack or, if it
+// is empty, the next one in input order. Returns -1 if all triangles are done.
+static int skipDeadEnd(const std::vector<unsigned int>& liveCount, std::vector<unsigned int>& deadEnd, size_t& cursor)
+{
+  while(!deadEnd.empty())
+  {
+    const unsigned int v=deadEnd.back();
+    deadEnd.pop_back();
+    if(liveCount[v] > 0)
+      return int(v);
+  }
+  while(cursor < liveCount.size())
+  {
+    if(liveCount[cursor] > 0)
+      return int(cursor++);
+    ++cursor;
+  }
+  return -1;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& t, size_t numVertices, size_t cacheSize)
+{
+  const size_t numTriangles=t.size()/3;
+  if(numTriangles == 0)
+    return;
+
+  // Triangles adjacent to every vertex
+  std::vector<unsigned int> liveCount(numVertices,0);
+  for(size_t i=0;i<3*numTriangles;++i)
+    ++liveCount[t[i]];
+  std::vector<size_t> offsets(numVertices+1,0);
+  for(size_t v=0;v<numVertices;++v)
+    offsets[v+1]=offsets[v]+liveCount[v];
+  std::vector<unsigned int> adjacency(offsets[numVertices]);
+  std::vector<size_t> fill(offsets.begin(),offsets.end()-1);
+  for(size_t i=0;i<3*numTriangles;++i)
+    adjacency[fill[t[i]]++]=unsigned(i/3);
+
+  std::vector<size_t> stamps(numVertices,0);
+  std::vector<bool> emitted(numTriangles,false);
+  std::vector<unsigned int> deadEnd, candidates, result;
+  result.reserve(3*numTriangles);
+  size_t time=cacheSize+1;
+  size_t cursor=0;
+
+  int f=skipDeadEnd(liveCount,deadEnd,cursor);
+  while(f >= 0)
+  {
+    // Emit all remaining triangles around the fanning vertex
+    candidates.clear();
+    for(size_t a=offsets[f];a<offsets[f+1];++a)
+    {
+      const unsigned int tri=adjacency[a];
+      if(emitted[tri])
+        continue;
+      for(size_t c=0;c<3;++c)
+      {
+        const unsigned int v=t[3*tri+c];
+        result.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        --liveCount[v];
+        if(time-stamps[v] > cacheSize)
+          stamps[v]=time++;
+      }
+      emitted[tri]=true;
+    }
+
+    // Continue with the oldest candidate which stays in the cache while its triangles are emitted
+    int next=-1;
+    long bestPriority=-1;
+    for(size_t i=0;i<candidates.size();++i)
+    {
+      const unsigned int v=candidates[i];
+      if(liveCount[v] == 0)
+        continue;
+      long priority=0;
+      if(time-stamps[v]+2*liveCount[v] <= cacheSize)
+        priority=long(time-stamps[v]);
+      if(priority > bestPriority)
+      {
+        bestPriority=priority;
+        next=int(v);
+      }
+    }
+    f=next >= 0 ? next : skipDeadEnd(liveCount,deadEnd,cursor);
+  }
+
+  t.swap(result);
+}
+
+// Triangle range of the reordered mesh with its overdraw sort key
+struct OverdrawCluster
+{
+  size_t begin, end;
+  float key;
+  bool operator<(const OverdrawCluster& other) const { return key > other.key; }
+};
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& t, const std::vector<Vec3f>& p,
+                                     size_t cacheSize, float threshold)
+{
+  const size_t numTriangles=t.size()/3;
+  if(numTriangles < 2)
+    return;
+
+  // Split where a cluster on its own has a small enough cache miss ratio
+  const float limit=threshold*computeACMR(t,p.size(),cacheSize);
+  std::vector<OverdrawCluster> clusters;
+  VertexCacheSimulation cache(p.size(),cacheSize);
+  OverdrawCluster cluster={0,0,0.f};
+  size_t misses=0;
+  for(size_t i=0;i<numTriangles;++i)
+  {
+    for(size_t c=0;c<3;++c)
+      misses+=cache.access(t[3*i+c]);
+    if(float(misses) <= limit*float(i+1-cluster.begin) || i+1 == numTriangles)
+    {
+      cluster.end=i+1;
+      clusters.push_back(cluster);
+      cluster.begin=i+1;
+      misses=0;
+      cache.reset();
+    }
+  }
+
+  // Area weighted centroid of the mesh
+  Vec3f meshCentroid(0,0,0);
+  float meshArea=0.f;
+  for(size_t i=0;i<numTriangles;++i)
+  {
+    const Vec3f &a=p[t[3*i]], &b=p[t[3*i+1]], &c=p[t[3*i+2]];
+    const float area=cross(b-a,c-a).length();
+    meshCentroid+=(a+b+c)*area;
+    meshArea+=area;
+  }
+  if(meshArea > 0.f)
+    meshCentroid/=3.f*meshArea;
+
+  // Clusters pointing away from the centroid are likely in front of the others
+  for(size_t k=0;k<clusters.size();++k)
+  {
+    Vec3f centroid(0,0,0), normal(0,0,0);
+    float area=0.f;
+    for(size_t i=clusters[k].begin;i<clusters[k].end;++i)
+    {
+      const Vec3f &a=p[t[3*i]], &b=p[t[3*i+1]], &c=p[t[3*i+2]];
+      const Vec3f n=cross(b-a,c-a);
+      const float triangleArea=n.length();
+      centroid+=(a+b+c)*triangleArea;
+      normal+=n;
+      area+=triangleArea;
+    }
+    const float normalLength=normal.length();
+    clusters[k].key=0.f;
+    if(area > 0.f && normalLength > 0.f)
+      clusters[k].key=dot(centroid/(3.f*area)-meshCentroid,normal/normalLength);
+  }
+  std::stable_sort(clusters.begin(),clusters.end());
+
+  std::vector<unsigned int> result;
+  result.reserve(t.size());
+  for(size_t k=0;k<clusters.size();++k)
+    result.insert(result.end(),t.begin()+3*clusters[k].begin,t.begin()+3*clusters[k].end);
+  t.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t)
+{
+  // Renumbering only the positions would detach the normals from their vertices
+  if(!n.empty() && n.size() != p.size())
+    return;
+
+  const unsigned int unused=~0u;
+  std::vector<unsigned int> remap(p.size(),unused);
+  unsigned int next=0;
+  for(size_t i=0;i<t.size();++i)
+  {
+    if(remap[t[i]] == unused)
+      remap[t[i]]=next++;
+    t[i]=remap[t[i]];
+  }
+  for(size_t v=0;v<remap.size();++v)
+    if(remap[v] == unused)
+      remap[v]=next++;
+
+  std::vector<Vec3f> reordered(p.size());
+  for(size_t v=0;v<p.size();++v)
+    reordered[remap[v]]=p[v];
+  p.swap(reordered);
+
+  for(size_t v=0;v<n.size();++v)
+    reordered[remap[v]]=n[v];
+  n.swap(reordered);
+}
+
+void MeshOptimizer::optimize(std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t,
+                             size_t cacheSize, float overdrawThreshold)
+{
+  // Each step only keeps its order if the vertex cache does not suffer from it
+  const float inputACMR=computeACMR(t,p.size(),cacheSize);
+  std::vector<unsigned int> reordered(t);
+  optimizeVertexCache(reordered,p.size(),cacheSize);
+  const float cacheACMR=computeACMR(reordered,p.size(),cacheSize);
+  if(cacheACMR <= inputACMR)
+    t.swap(reordered);
+
+  reordered=t;
+  optimizeOverdraw(reordered,p,cacheSize);
+  const float overdrawACMR=computeACMR(reordered,p.size(),cacheSize);
+  if(overdrawACMR <= overdrawThreshold*std::min(cacheACMR,inputACMR) && overdrawACMR <= inputACMR)
+    t.swap(reordered);
+
+  optimizeVertexFetch(p,n,t);
+}
+
+} //namespace ogl
@@ -0,0 +1,47 @@
+#ifndef MESHOPTIMIZER_HPP_INCLUDE_ONCE
+#define MESHOPTIMIZER_HPP_INCLUDE_ONCE
+#include "openglConfig.hpp"
+
+#include "Math.hpp"
+#include <vector>
+
+namespace ogl
+{
+
+// This class reorders an indexed triangle mesh before it is uploaded to the GPU.
+// The triangle order is optimized for the post-transform vertex cache with
+// Tipsify (Sander et al. 2007), split into clusters which are sorted to draw
+// outward facing parts first to reduce overdraw, and finally the vertices are
+// renumbered in the order of their first use for vertex fetch locality.
+// All steps keep the rendered surface (and triangle orientation) unchanged.
+class MeshOptimizer
+{
+public:
+  // Average cache miss ratio (transformed vertices per triangle) for a FIFO
+  // vertex cache with cacheSize entries, between 0.5 and 3
+  OPENGL_EXPORTS static float computeACMR(const std::vector<unsigned int>& t, size_t numVertices, size_t cacheSize=16);
+
+  // Reorders the triangles for a FIFO vertex cache with cacheSize entries
+  OPENGL_EXPORTS static void optimizeVertexCache(std::vector<unsigned int>& t, size_t numVertices, size_t cacheSize=16);
+
+  // Splits the (vertex cache optimized) triangle order into clusters where
+  // the ACMR stays below threshold times the ACMR of the whole mesh, and
+  // sorts them to draw clusters facing away from the mesh center first
+  OPENGL_EXPORTS static void optimizeOverdraw(std::vector<unsigned int>& t, const std::vector<Vec3f>& p,
+                                              size_t cacheSize=16, float threshold=1.05f);
+
+  // Renumbers the vertices in the order they are first referenced by the triangles,
+  // unreferenced vertices are moved to the end. The mesh is left unchanged if
+  // there are normals, but not one per position
+  OPENGL_EXPORTS static void optimizeVertexFetch(std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t);
+
+  // Applies all three steps. The vertex cache order is dropped if it has a higher
+  // ACMR than the input, the overdraw order if its ACMR exceeds overdrawThreshold
+  // times the ACMR before it or the ACMR of the input
+  OPENGL_EXPORTS static void optimize(std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t,
+                                      size_t cacheSize=16, float overdrawThreshold=1.05f);
+};
+
+} //namespace ogl
+
+#endif //MESHOPTIMIZER_HPP_INCLUDE_ONCE
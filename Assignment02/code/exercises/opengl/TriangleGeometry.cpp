@@ -1,4 +1,5 @@
 #include "TriangleGeometry.hpp"
+#include "MeshOptimizer.hpp"
 
 namespace ogl
 {
@@ -22,30 +23,41 @@ TriangleGeometry::~TriangleGeometry()
   this->clear();
 }
 
-void TriangleGeometry::init(const std::vector<Vec3f>& p, const std::vector<Vec3f>& n, const std::vector<unsigned int>& t)
+void TriangleGeometry::init(const std::vector<Vec3f>& positions, const std::vector<Vec3f>& normals, const std::vector<unsigned int>& indices)
+{
+  // Reorder the mesh for the vertex cache, overdraw and vertex fetch
+  std::vector<Vec3f> p(positions), n(normals);
+  std::vector<unsigned int> t(indices);
+  MeshOptimizer::optimize(p,n,t);
+
+  this->upload(p.empty() ? NULL : &p[0], p.size(), n.empty() ? NULL : &n[0], n.size(),
+               t.empty() ? NULL : &t[0], t.size());
+}
+
+void TriangleGeometry::upload(const Vec3f* p, size_t numPositions, const Vec3f* n, size_t numNormals, const unsigned int* t, size_t numIndices)
 {
   //Create and copy buffer data for the indexed triangle set
 
   this->clear();
 
-  mNumIndices = GLsizei(t.size());
+  mNumIndices = GLsizei(numIndices);
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mIndexBuffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * t.size(), &t[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * numIndices, t, GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mPositionBuffer);
   glBindBuffer(GL_ARRAY_BUFFER, mPositionBuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * p.size(), &p[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * numPositions, p, GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mNormalBuffer);
   glBindBuffer(GL_ARRAY_BUFFER, mNormalBuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * n.size(), &n[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * numNormals, n, GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Generate a vertex array object
@@ -70,6 +82,41 @@ void TriangleGeometry::init(const std::vector<Vec3f>& p, const std::vector<Vec3f
   mInitialized=true;
 }
 
+bool TriangleGeometry::init(const rt::MeshFile& file)
+{
+  const size_t numVertices=file.count(rt::MeshFile::Positions);
+  if(file.count(rt::MeshFile::Normals)!=numVertices)
+  {
+    std::cerr<<"Error: Mesh file does not contain vertex normals"<<std::endl;
+    return false;
+  }
+
+  // Check the indices before they reach the GPU
+  const size_t numIndices=file.count(rt::MeshFile::Indices);
+  const unsigned int* indices=(const unsigned int*)file.data(rt::MeshFile::Indices);
+  bool valid=numIndices%3==0;
+  for(size_t i=0;valid && i<numIndices;++i)
+    valid=indices[i]<numVertices;
+  if(!valid)
+  {
+    std::cerr<<"Error: Mesh file contains invalid triangle indices"<<std::endl;
+    return false;
+  }
+
+  // Float attributes are uploaded straight from the mapped file
+  if(file.singlePrecision())
+  {
+    this->upload((const Vec3f*)file.data(rt::MeshFile::Positions),numVertices,
+                 (const Vec3f*)file.data(rt::MeshFile::Normals),numVertices,indices,numIndices);
+    return true;
+  }
+  std::vector<Vec3f> p,n;
+  file.copyAttribute(rt::MeshFile::Positions,p);
+  file.copyAttribute(rt::MeshFile::Normals,n);
+  this->upload(p.empty() ? NULL : &p[0],p.size(),n.empty() ? NULL : &n[0],n.size(),indices,numIndices);
+  return true;
+}
+
 void TriangleGeometry::initInstance(std::shared_ptr<TriangleGeometry> original)
 {
   // For instances, only create uniform buffer 
@@ -3,6 +3,7 @@
 #include "openglConfig.hpp"
 
 #include "OpenGL.hpp"
+#include <raytracer/MeshFile.hpp>
 #include <vector>
 #include <memory>
 
@@ -19,8 +20,14 @@ public:
   OPENGL_EXPORTS virtual ~TriangleGeometry();
 
   // Initialize by a set of vertex positions, vertex normals and triangle indices (starting from 0)
+  // The mesh is reordered by the MeshOptimizer before the upload
   OPENGL_EXPORTS void init(const std::vector<Vec3f>& p, const std::vector<Vec3f>& n, const std::vector<unsigned int>& t);
 
+  // Initialize from a binary mesh file (see rt::MeshFile), which needs vertex normals
+  // The file is uploaded as it is, so it should be optimized when it is written
+  // Returns false if they are missing or the indices do not reference existing vertices
+  OPENGL_EXPORTS bool init(const rt::MeshFile& file);
+
   // Initialize an instance by storing a shared pointer to the original triangle geometry
   OPENGL_EXPORTS void initInstance(std::shared_ptr<TriangleGeometry> original);
   OPENGL_EXPORTS void clear();
@@ -50,6 +57,9 @@ public:
   OPENGL_EXPORTS void bind(const GLuint shaderProgram,const GLuint bindingPoint=0, const std::string &blockName="ub_Geometry") const;
 
 private:
+  // Creates the buffers and the vertex array object from the given arrays
+  void upload(const Vec3f* p, size_t numPositions, const Vec3f* n, size_t numNormals, const unsigned int* t, size_t numIndices);
+
   Mat4x4f   mModelMatrix;                          //< The model matrix.
   //<
   GLuint mIndexBuffer;                          //< Handle to the VBO storing triangle indices
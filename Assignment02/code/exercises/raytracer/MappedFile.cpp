@@ -0,0 +1,116 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rt
+{
+
+MappedFile::MappedFile() : mData(0), mSize(0), mMapping(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+  this->close();
+}
+
+bool MappedFile::open(const std::string &filePath)
+{
+  this->close();
+
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file != INVALID_HANDLE_VALUE)
+  {
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+      HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping)
+      {
+        const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view)
+        {
+          CloseHandle(file);
+          mData    = (const char*)view;
+          mSize    = size_t(size.QuadPart);
+          mMapping = (void*)view;
+          return true;
+        }
+      }
+    }
+    CloseHandle(file);
+  }
+#else
+  int file = ::open(filePath.c_str(), O_RDONLY);
+  if (file >= 0)
+  {
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+    {
+      void *view = mmap(0, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+      if (view != MAP_FAILED)
+      {
+        ::close(file);
+#if defined(MADV_SEQUENTIAL)
+        madvise(view, size_t(status.st_size), MADV_SEQUENTIAL);
+#endif
+        mData    = (const char*)view;
+        mSize    = size_t(status.st_size);
+        mMapping = view;
+        return true;
+      }
+    }
+    ::close(file);
+  }
+#endif
+
+  //mapping failed (or the file is empty), read the whole file instead
+  std::ifstream in(filePath, std::ios::binary | std::ios::in);
+  if (!in.is_open())
+    return false;
+  in.seekg(0, std::ios::end);
+  const std::streamoff size = in.tellg();
+  in.seekg(0, std::ios::beg);
+  if (size > 0)
+  {
+    mBuffer.resize(size_t(size));
+    if (!in.read(&mBuffer[0], size))
+    {
+      std::vector<char>().swap(mBuffer);
+      return false;
+    }
+  }
+  mData = mBuffer.empty() ? 0 : &mBuffer[0];
+  mSize = mBuffer.size();
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (mMapping)
+  {
+#if defined(_WIN32)
+    UnmapViewOfFile(mMapping);
+#else
+    munmap(mMapping, mSize);
+#endif
+  }
+  std::vector<char>().swap(mBuffer);
+  mData    = 0;
+  mSize    = 0;
+  mMapping = 0;
+}
+
+} //namespace rt
@@ -0,0 +1,293 @@
+#include "MeshFile.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace rt
+{
+
+static const char     MeshFileMagic[8]  = {'C','G','M','E','S','H',0,0};
+static const uint32_t MeshFileByteOrder = 0x01020304u;
+static const uint32_t MeshFileVersion   = 1;
+static const uint64_t SectionAlignment  = 64;
+
+struct MeshFileHeader
+{
+  char     magic[8];
+  uint32_t byteOrder;    // detects files written on a machine with different endianness
+  uint32_t version;
+  uint32_t numSections;
+  uint32_t reserved;
+};
+
+struct MeshFileSection
+{
+  uint32_t type;
+  uint32_t elementSize;
+  uint64_t offset;       // from the start of the file, multiple of SectionAlignment
+  uint64_t count;
+};
+
+struct PendingMeshFileSection
+{
+  MeshFileSection   entry;
+  std::vector<char> bytes;
+};
+
+template<class T>
+static void appendAttribute(std::vector<PendingMeshFileSection> &sections, MeshFile::SectionType type,
+                            const std::vector<Vec3d> &values)
+{
+  if (values.empty())
+    return;
+  PendingMeshFileSection section;
+  section.entry.type = uint32_t(type);
+  section.entry.elementSize = uint32_t(3*sizeof(T));
+  section.entry.count = values.size();
+  section.bytes.resize(values.size()*3*sizeof(T));
+  T *out = (T*)&section.bytes[0];
+  for (size_t i=0;i<values.size();++i)
+    for (unsigned int d=0;d<3;++d)
+      out[3*i+d] = T(values[i][d]);
+  sections.push_back(section);
+}
+
+MeshFile::MeshFile()
+{
+}
+
+void MeshFile::close()
+{
+  mFile.close();
+  for (int i=0;i<NumSectionTypes;++i)
+    mSections[i] = Section();
+}
+
+bool MeshFile::open(const std::string &filePath)
+{
+  this->close();
+  if (!mFile.open(filePath))
+  {
+    std::cerr<<"Error: Could not open file "<<filePath<<std::endl;
+    return false;
+  }
+  return this->parse(mFile.data(),mFile.size(),filePath);
+}
+
+bool MeshFile::open(const char *data, size_t size)
+{
+  this->close();
+  return this->parse(data,size,"embedded data");
+}
+
+bool MeshFile::parse(const char *data, size_t dataSize, const std::string &filePath)
+{
+  const uint64_t size = dataSize;
+
+  MeshFileHeader header;
+  if (size < sizeof(MeshFileHeader))
+  {
+    std::cerr<<"Error: "<<filePath<<" is not a mesh file"<<std::endl;
+    this->close();
+    return false;
+  }
+  memcpy(&header,data,sizeof(MeshFileHeader));
+  if (memcmp(header.magic,MeshFileMagic,sizeof(MeshFileMagic)) != 0 || header.byteOrder != MeshFileByteOrder)
+  {
+    std::cerr<<"Error: "<<filePath<<" is not a mesh file"<<std::endl;
+    this->close();
+    return false;
+  }
+  if (header.version != MeshFileVersion)
+  {
+    std::cerr<<"Error: Unsupported mesh file version "<<header.version<<std::endl;
+    this->close();
+    return false;
+  }
+  if (header.numSections > NumSectionTypes ||
+      size < sizeof(MeshFileHeader) + header.numSections*sizeof(MeshFileSection))
+  {
+    std::cerr<<"Error: Corrupt section table in "<<filePath<<std::endl;
+    this->close();
+    return false;
+  }
+
+  for (uint32_t i=0;i<header.numSections;++i)
+  {
+    MeshFileSection entry;
+    memcpy(&entry,data+sizeof(MeshFileHeader)+i*sizeof(MeshFileSection),sizeof(MeshFileSection));
+
+    //the section has to lie inside the file and fit its element type
+    bool valid = entry.type < NumSectionTypes && entry.elementSize > 0 &&
+                 entry.offset % SectionAlignment == 0 && entry.offset <= size &&
+                 entry.count <= (size-entry.offset)/entry.elementSize;
+    if (valid && entry.type <= TextureCoordinates)
+      valid = entry.elementSize == sizeof(Vec3f) || entry.elementSize == sizeof(Vec3d);
+    if (valid && entry.type == Indices)
+      valid = entry.elementSize == sizeof(int32_t);
+    if (!valid)
+    {
+      std::cerr<<"Error: Corrupt section table in "<<filePath<<std::endl;
+      this->close();
+      return false;
+    }
+
+    mSections[entry.type].data        = data+entry.offset;
+    mSections[entry.type].count       = size_t(entry.count);
+    mSections[entry.type].elementSize = entry.elementSize;
+  }
+
+  //all attributes share the precision of the positions
+  for (int type=Normals;type<=TextureCoordinates;++type)
+  {
+    if (mSections[type].count != 0 && mSections[type].elementSize != mSections[Positions].elementSize)
+    {
+      std::cerr<<"Error: Mixed attribute precision in "<<filePath<<std::endl;
+      this->close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void MeshFile::copyAttribute(SectionType type, std::vector<Vec3d> &values) const
+{
+  const Section &section = mSections[type];
+  if (section.elementSize == sizeof(Vec3d))
+  {
+    values.resize(section.count);
+    if (section.count)
+      memcpy((double*)&values[0][0],section.data,section.count*sizeof(Vec3d));
+    return;
+  }
+
+  const float *in = (const float*)section.data;
+  values.resize(section.count);
+  for (size_t i=0;i<section.count;++i)
+    values[i] = Vec3d(in[3*i+0],in[3*i+1],in[3*i+2]);
+}
+
+void MeshFile::copyAttribute(SectionType type, std::vector<Vec3f> &values) const
+{
+  const Section &section = mSections[type];
+  if (section.elementSize == sizeof(Vec3f))
+  {
+    values.resize(section.count);
+    if (section.count)
+      memcpy((float*)&values[0][0],section.data,section.count*sizeof(Vec3f));
+    return;
+  }
+
+  const double *in = (const double*)section.data;
+  values.resize(section.count);
+  for (size_t i=0;i<section.count;++i)
+    values[i] = Vec3f(float(in[3*i+0]),float(in[3*i+1]),float(in[3*i+2]));
+}
+
+bool MeshFile::write(const std::string &filePath,
+                     const std::vector<Vec3d> &positions,
+                     const std::vector<Vec3d> &normals,
+                     const std::vector<Vec3d> &textureCoordinates,
+                     const std::vector<int> &indices,
+                     bool singlePrecision,
+                     const void *nodes, size_t numNodes, size_t nodeSize)
+{
+  std::ofstream out(filePath, std::ios::binary | std::ios::out);
+  if (!out.is_open())
+  {
+    std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  if (!MeshFile::write(out,positions,normals,textureCoordinates,indices,singlePrecision,nodes,numNodes,nodeSize))
+  {
+    if (!out)
+      std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool MeshFile::write(std::ostream &out,
+                     const std::vector<Vec3d> &positions,
+                     const std::vector<Vec3d> &normals,
+                     const std::vector<Vec3d> &textureCoordinates,
+                     const std::vector<int> &indices,
+                     bool singlePrecision,
+                     const void *nodes, size_t numNodes, size_t nodeSize)
+{
+  if ((!normals.empty() && normals.size() != positions.size()) ||
+      (!textureCoordinates.empty() && textureCoordinates.size() != positions.size()))
+  {
+    std::cerr<<"Error: Vertex attributes differ in size"<<std::endl;
+    return false;
+  }
+
+  std::vector<PendingMeshFileSection> sections;
+  if (singlePrecision)
+  {
+    appendAttribute<float>(sections,Positions,positions);
+    appendAttribute<float>(sections,Normals,normals);
+    appendAttribute<float>(sections,TextureCoordinates,textureCoordinates);
+  }
+  else
+  {
+    appendAttribute<double>(sections,Positions,positions);
+    appendAttribute<double>(sections,Normals,normals);
+    appendAttribute<double>(sections,TextureCoordinates,textureCoordinates);
+  }
+  if (!indices.empty())
+  {
+    PendingMeshFileSection section;
+    section.entry.type = Indices;
+    section.entry.elementSize = sizeof(int32_t);
+    section.entry.count = indices.size();
+    section.bytes.resize(indices.size()*sizeof(int32_t));
+    memcpy(&section.bytes[0],&indices[0],section.bytes.size());
+    sections.push_back(section);
+  }
+  if (nodes && numNodes && nodeSize)
+  {
+    PendingMeshFileSection section;
+    section.entry.type = HierarchyNodes;
+    section.entry.elementSize = uint32_t(nodeSize);
+    section.entry.count = numNodes;
+    section.bytes.resize(numNodes*nodeSize);
+    memcpy(&section.bytes[0],nodes,section.bytes.size());
+    sections.push_back(section);
+  }
+
+  MeshFileHeader header;
+  memcpy(header.magic,MeshFileMagic,sizeof(MeshFileMagic));
+  header.byteOrder   = MeshFileByteOrder;
+  header.version     = MeshFileVersion;
+  header.numSections = uint32_t(sections.size());
+  header.reserved    = 0;
+
+  //place the sections behind the table, each aligned
+  uint64_t offset = sizeof(MeshFileHeader) + sections.size()*sizeof(MeshFileSection);
+  for (size_t i=0;i<sections.size();++i)
+  {
+    offset = (offset+SectionAlignment-1)/SectionAlignment*SectionAlignment;
+    sections[i].entry.offset = offset;
+    offset += sections[i].bytes.size();
+  }
+
+  out.write((const char*)&header,sizeof(header));
+  for (size_t i=0;i<sections.size();++i)
+    out.write((const char*)&sections[i].entry,sizeof(MeshFileSection));
+
+  const char padding[SectionAlignment] = {0};
+  uint64_t position = sizeof(MeshFileHeader) + sections.size()*sizeof(MeshFileSection);
+  for (size_t i=0;i<sections.size();++i)
+  {
+    out.write(padding,std::streamsize(sections[i].entry.offset-position));
+    if (!sections[i].bytes.empty())
+      out.write(&sections[i].bytes[0],std::streamsize(sections[i].bytes.size()));
+    position = sections[i].entry.offset + sections[i].bytes.size();
+  }
+  return bool(out);
+}
+
+} //namespace rt
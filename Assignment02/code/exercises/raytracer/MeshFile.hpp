@@ -0,0 +1,101 @@
+#ifndef MESHFILE_HPP_INCLUDE_ONCE
+#define MESHFILE_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "Math.hpp"
+#include "MappedFile.hpp"
+
+namespace rt
+{
+
+/// Binary container for an indexed triangle mesh. The file starts with a
+/// header and a section table, followed by the raw arrays, each aligned to
+/// 64 bytes. Opening a file only maps it and validates the table, the
+/// sections can then be used in place without any parsing.
+///
+/// Vertex attributes are stored either as double or as float triples,
+/// indices as 32 bit integers and the optional hierarchy as packed
+/// BVTree nodes. All values are little-endian.
+class MeshFile
+{
+public:
+  enum SectionType
+  {
+    Positions,
+    Normals,
+    TextureCoordinates,
+    Indices,
+    HierarchyNodes,
+    NumSectionTypes
+  };
+
+  RAYTRACER_EXPORTS MeshFile();
+
+  /// Maps the file and checks its header, returns false for invalid files.
+  RAYTRACER_EXPORTS bool open(const std::string &filePath);
+  /// Uses a mesh file stored in memory, e.g. embedded in a larger mapped
+  /// file. The memory is not copied and has to stay valid while in use.
+  RAYTRACER_EXPORTS bool open(const char *data, size_t size);
+  RAYTRACER_EXPORTS void close();
+
+  /// Number of elements in a section, 0 if it is not present.
+  RAYTRACER_EXPORTS size_t count(SectionType type) const { return mSections[type].count; }
+  /// Size of one element in bytes.
+  RAYTRACER_EXPORTS size_t elementSize(SectionType type) const { return mSections[type].elementSize; }
+  /// Pointer to the first element, null if the section is not present.
+  RAYTRACER_EXPORTS const void* data(SectionType type) const { return mSections[type].data; }
+
+  /// True if the vertex attributes are stored as float triples.
+  RAYTRACER_EXPORTS bool singlePrecision() const { return mSections[Positions].elementSize == sizeof(Vec3f); }
+
+  /// Copies an attribute section into a double precision array.
+  RAYTRACER_EXPORTS void copyAttribute(SectionType type, std::vector<Vec3d> &values) const;
+  /// Copies an attribute section into a single precision array.
+  RAYTRACER_EXPORTS void copyAttribute(SectionType type, std::vector<Vec3f> &values) const;
+
+  /// Writes a mesh file. Normals and texture coordinates are optional and
+  /// must otherwise have one entry per position. With singlePrecision the
+  /// attributes are rounded to float. The hierarchy is stored as an opaque
+  /// array of numNodes records of nodeSize bytes.
+  RAYTRACER_EXPORTS static bool write(const std::string &filePath,
+                                      const std::vector<Vec3d> &positions,
+                                      const std::vector<Vec3d> &normals,
+                                      const std::vector<Vec3d> &textureCoordinates,
+                                      const std::vector<int> &indices,
+                                      bool singlePrecision,
+                                      const void *nodes=0, size_t numNodes=0, size_t nodeSize=0);
+  /// Writes a mesh file at the current position of the stream. Offsets are
+  /// relative to that position, which therefore has to be aligned to 64 bytes
+  /// for the sections to be aligned when the data is used in place.
+  RAYTRACER_EXPORTS static bool write(std::ostream &out,
+                                      const std::vector<Vec3d> &positions,
+                                      const std::vector<Vec3d> &normals,
+                                      const std::vector<Vec3d> &textureCoordinates,
+                                      const std::vector<int> &indices,
+                                      bool singlePrecision,
+                                      const void *nodes=0, size_t numNodes=0, size_t nodeSize=0);
+
+private:
+  // Validates the header and section table of data and sets up the sections,
+  // name is used in error messages.
+  bool parse(const char *data, size_t size, const std::string &name);
+
+  struct Section
+  {
+    Section() : data(0), count(0), elementSize(0) {}
+    const void* data;
+    size_t      count;
+    size_t      elementSize;
+  };
+
+  MappedFile mFile;
+  Section    mSections[NumSectionTypes];
+};
+
+} //namespace rt
+
+#endif //MESHFILE_HPP_INCLUDE_ONCE
@@ -2,8 +2,12 @@
 #include <memory>
 #include <opengl/IndexedTriangleIO.hpp>
 #include <opengl/TriangleGeometry.hpp>
+#include <opengl/MeshOptimizer.hpp>
 #include <opengl/ShaderProgram.hpp>
 #include <opengl/Camera.hpp>
+#include <raytracer/MeshFile.hpp>
+#include <fstream>
+#include <sys/stat.h>
 //#include <raytracer/Math.hpp>
 
 
@@ -149,8 +153,60 @@ void displayCB()
   glUseProgram(0);
 }
 
+// Returns the modification time of a file, 0 if it does not exist
+time_t modificationTime(const std::string& path)
+{
+  struct stat status;
+  if(stat(path.c_str(),&status) != 0)
+    return 0;
+  return status.st_mtime;
+}
+
+// Initialize a die from its binary mesh file assets/<name>.mesh, which is mapped
+// and uploaded without parsing or processing. It is written from assets/<name>.obj,
+// reordered by the MeshOptimizer, on the first start and whenever the OBJ file has
+// changed since. A missing die is left empty
+bool initDie(std::shared_ptr<ogl::TriangleGeometry> die, const std::string& name)
+{
+  const std::string objPath=gDataPath+"assets/"+name+".obj";
+  const std::string meshPath=gDataPath+"assets/"+name+".mesh";
+  const time_t objTime=modificationTime(objPath), meshTime=modificationTime(meshPath);
+  rt::MeshFile file;
+  if(meshTime != 0 && meshTime >= objTime && file.open(meshPath))
+    return die->init(file);
+
+  if(objTime == 0)
+  {
+    std::cerr<<"Warning: "<<objPath<<" not found, the die stays empty"<<std::endl;
+    die->init(std::vector<ogl::Vec3f>(),std::vector<ogl::Vec3f>(),std::vector<unsigned int>());
+    return true;
+  }
+
+  ogl::IndexedTriangleIO io;
+  if(!io.loadFromOBJ(objPath))
+    return false;
+  if(io.vertexNormals().empty())
+  {
+    std::cerr<<"OBJ model needs vertex normals!"<<std::endl;
+    return false;
+  }
+
+  std::vector<ogl::Vec3f> p(io.vertexPositions()), n(io.vertexNormals());
+  std::vector<unsigned int> t(io.triangleIndices());
+  ogl::MeshOptimizer::optimize(p,n,t);
+
+  // A failed write only costs the faster loading on the next start
+  if(rt::MeshFile::write(meshPath,std::vector<rt::Vec3d>(p.begin(),p.end()),std::vector<rt::Vec3d>(n.begin(),n.end()),
+                         std::vector<rt::Vec3d>(),std::vector<int>(t.begin(),t.end()),true) &&
+     file.open(meshPath))
+    return die->init(file);
+
+  die->init(io.vertexPositions(),io.vertexNormals(),io.triangleIndices());
+  return true;
+}
+
 // Initialize the dice geometry
-// Load the OBJ files, apply materials and transformations
+// Load the mesh files, apply materials and transformations
 bool initDice()
 {
   //ogl::IndexedTriangleIO io;
@@ -170,24 +226,10 @@ bool initDice()
   for (int i=0;i<6;i++)
 	gDice[i] = std::make_shared<ogl::TriangleGeometry>();
   
-  ogl::IndexedTriangleIO io0;
-  io0.loadFromOBJ(gDataPath + "assets/4.obj");
-  gDice[0]->init(io0.vertexPositions(), io0.vertexNormals(), io0.triangleIndices());
-  ogl::IndexedTriangleIO io1;
-  io1.loadFromOBJ(gDataPath + "assets/die.obj");
-  gDice[1]->init(io1.vertexPositions(), io1.vertexNormals(), io1.triangleIndices());
-  ogl::IndexedTriangleIO io2;
-  io2.loadFromOBJ(gDataPath + "assets/8.obj");
-  gDice[2]->init(io2.vertexPositions(), io2.vertexNormals(), io2.triangleIndices());
-  ogl::IndexedTriangleIO io3;
-  io3.loadFromOBJ(gDataPath + "assets/12.obj");
-  gDice[3]->init(io3.vertexPositions(), io3.vertexNormals(), io3.triangleIndices());
-  ogl::IndexedTriangleIO io4;
-  io4.loadFromOBJ(gDataPath + "assets/20.obj");
-  gDice[4]->init(io4.vertexPositions(), io4.vertexNormals(), io4.triangleIndices());
-  ogl::IndexedTriangleIO io5;
-  io5.loadFromOBJ(gDataPath + "assets/smooth_dragon.obj");
-  gDice[5]->init(io5.vertexPositions(), io5.vertexNormals(), io5.triangleIndices());
+  const char* names[6]={"4","die","8","12","20","smooth_dragon"};
+  for (int i=0;i<6;i++)
+    if(!initDie(gDice[i],names[i]))
+      return false;
   
   for (int i=0;i<6;i++)
 	  gDice[i]->setMaterial(100.f, ogl::Vec3f(0.2f, 0.5f, 1.0f));
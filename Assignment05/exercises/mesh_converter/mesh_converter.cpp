@@ -0,0 +1,54 @@
+#include <raytracer/BVHIndexedTriangleMesh.hpp>
+#include <raytracer/BrickedTriangleMesh.hpp>
+#include <raytracer/Math.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Converts a Wavefront OBJ or PLY file into the binary mesh format (see rt::MeshFile).
+// The mesh is stored in BVH leaf order together with its hierarchy, so that
+// BVHIndexedTriangleMesh::loadFromBinary() needs neither parsing nor a build.
+// With --float the attributes are stored in single precision for the OpenGL
+// viewers, these files contain no hierarchy. An output name ending in .cmesh
+// writes the quantized format of rt::CompressedMeshFile instead, in the
+// triangle order of the hierarchy for good compression. An output name ending
+// in .bricks writes the out-of-core format of rt::BrickedTriangleMesh.
+int main(int argc, char** argv)
+{
+  if(argc < 3 || (argc == 4 && strcmp(argv[3],"--float") != 0) || argc > 4)
+  {
+    std::cerr<<"Usage: "<<argv[0]<<" input.obj|input.ply output.mesh|output.cmesh|output.bricks [--float]"<<std::endl;
+    return -1;
+  }
+  const bool singlePrecision = argc == 4;
+
+  rt::Chrono before = std::chrono::high_resolution_clock::now();
+
+  std::shared_ptr<rt::BVHIndexedTriangleMesh> mesh = std::make_shared<rt::BVHIndexedTriangleMesh>();
+  const std::string input = argv[1];
+  const bool ply = input.size() > 4 && input.compare(input.size()-4,4,".ply") == 0;
+  if(ply ? !mesh->loadFromPLY(input) : !mesh->loadFromOBJ(input))
+    return -1;
+
+  //the bricks get hierarchies of their own, the whole mesh needs none
+  const std::string output = argv[2];
+  const bool bricks = output.size() > 7 && output.compare(output.size()-7,7,".bricks") == 0;
+  if(bricks)
+  {
+    if(!rt::BrickedTriangleMesh::writeBricks(*mesh,output))
+      return -1;
+  }
+  else
+  {
+    mesh->initialize();
+    const bool compressed = output.size() > 6 && output.compare(output.size()-6,6,".cmesh") == 0;
+    if(compressed ? !mesh->saveToCompressed(output) : !mesh->saveToBinary(output,singlePrecision))
+      return -1;
+  }
+
+  rt::ChronoDuration timeToConvert = std::chrono::duration_cast<rt::ChronoDuration>(std::chrono::high_resolution_clock::now()-before);
+  std::cout<<"Converted "<<mesh->triangleIndices().size()/3<<" triangles and "<<mesh->numVertices()
+           <<" vertices in "<<timeToConvert.count()<<" seconds"<<std::endl;
+  return 0;
+}
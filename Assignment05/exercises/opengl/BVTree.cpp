@@ -53,6 +53,47 @@ const std::vector<int>& BVTree::intersectBoundingBoxes(const Ray &ray, const flo
   return tempCandidates;
 }
 
+void BVTree::computeLeafOrder()
+{
+  mLeafOrder.clear();
+  if(mNodes.empty())
+    return;
+
+  //children are always stored behind their parent, so the triangle counts
+  //can be accumulated backwards and the ranges assigned forwards
+  for(size_t i=mNodes.size();i-->0;)
+  {
+    Node &node = mNodes[i];
+    if(node.right == -1)
+      node.count = 1;
+    else
+      node.count = mNodes[node.left].count + mNodes[node.right].count;
+  }
+
+  mLeafOrder.resize(mNodes[0].count);
+  mNodes[0].first = 0;
+  for(size_t i=0;i<mNodes.size();++i)
+  {
+    const Node &node = mNodes[i];
+    if(node.right == -1)
+      mLeafOrder[node.first] = -node.left;
+    else
+    {
+      mNodes[node.left].first  = node.first;
+      mNodes[node.right].first = node.first + mNodes[node.left].count;
+    }
+  }
+}
+
+void BVTree::applyLeafOrder()
+{
+  for(size_t i=0;i<mNodes.size();++i)
+    if(mNodes[i].right == -1)
+      mNodes[i].left = -int(mNodes[i].first);
+  for(size_t i=0;i<mLeafOrder.size();++i)
+    mLeafOrder[i] = int(i);
+}
+
 void BVTree::createNodes(const std::vector<Vec3f> &vertexPositions,
     const std::vector<Vec3i> &triangleIndices)
 {
@@ -106,6 +147,9 @@ void BVTree::sortTriangles()
 
 void BVTree::build(const std::vector<Vec3f> &vertexPositions,const std::vector<Vec3i> &triangleIndices)
 {
+  //discard a previously built hierarchy
+  mNodes.clear();
+
   //create bounding boxes for all triangles
   this->createNodes(vertexPositions,triangleIndices);
   size_t n = triangleIndices.size();
@@ -129,6 +173,7 @@ void BVTree::build(const std::vector<Vec3f> &vertexPositions,const std::vector<V
   }
 
   this->buildHierarchy(0,0,n);
+  this->computeLeafOrder();
 
   //clear temporary storage
   std::vector<bool>().swap(mTempMarker);
@@ -22,13 +22,22 @@ public:
   OPENGL_EXPORTS const std::vector<int>& intersectBoundingBoxes(const Ray &ray, const float maxLambda) const;
 
   OPENGL_EXPORTS size_t numNodes() const { return mNodes.size();}
+
+  //triangle indices in the order in which the leaves of the hierarchy are stored
+  OPENGL_EXPORTS const std::vector<int>& leafOrder() const { return mLeafOrder; }
+
+  //renumbers the leaves after the caller has permuted its triangles into leafOrder(),
+  //afterwards leafOrder() is the identity
+  OPENGL_EXPORTS void applyLeafOrder();
 private:
 
   struct Node
   {
-    Node() {left=0;right=0;}
+    Node() {left=0;right=0;first=0;count=0;}
     int left;
     int right;
+    unsigned int first; //first position of the subtree in mLeafOrder
+    unsigned int count; //number of triangles in the subtree
     BoundingBox bbox;
   };
   void sortTriangles();
@@ -40,7 +49,10 @@ private:
 
   void computeBoundingBoxAreas(size_t offset, size_t numTriangles);
 
+  void computeLeafOrder();
+
   std::vector<Node> mNodes;
+  std::vector<int>  mLeafOrder;
 
   std::vector<bool>        mTempMarker;
   std::vector<BoundingBox> mTempTriangleBoxes;
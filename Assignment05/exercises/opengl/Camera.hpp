@@ -1,5 +1,5 @@
-#ifndef CAMERA_HPP_INCLUDE_ONCE
-#define CAMERA_HPP_INCLUDE_ONCE
+#ifndef OPENGL_CAMERA_HPP_INCLUDE_ONCE
+#define OPENGL_CAMERA_HPP_INCLUDE_ONCE
 #include "openglConfig.hpp"
 
 #include "OpenGL.hpp"
@@ -33,6 +33,18 @@ public:
   // eyePosition - target
   OPENGL_EXPORTS void setUp(const Vec3f &up) {mUp=up; mUp.normalize(); this->updateUniforms();}
 
+  // Returns the camera position, the target point and the up vector
+  OPENGL_EXPORTS const Vec3f& position() const {return mEye;}
+  OPENGL_EXPORTS const Vec3f& target() const {return mTarget;}
+  OPENGL_EXPORTS const Vec3f& up() const {return mUp;}
+
+  // Set and get the vertical field of view in degrees
+  OPENGL_EXPORTS void setFOVY(float fovy) {mFOVY=fovy; this->updateUniforms();}
+  OPENGL_EXPORTS float fovy() const {return mFOVY;}
+
+  // Returns width/height of the viewport
+  OPENGL_EXPORTS float aspectRatio() const {return (float)mWidth/(float)mHeight;}
+
   // Computes and returns the view matrix
   OPENGL_EXPORTS Mat4x4f getViewMatrix() { return getLookAt();}
 
@@ -76,4 +88,4 @@ private:
 };
 } //namespace ogl
 
-#endif //CAMERA_HPP_INCLUDE_ONCE
\ No newline at end of file
+#endif //OPENGL_CAMERA_HPP_INCLUDE_ONCE
\ No newline at end of file
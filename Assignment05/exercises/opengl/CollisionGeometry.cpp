@@ -37,24 +37,29 @@ void CollisionGeometry::init(const std::vector<Vec3f>& p, const std::vector<Vec3
 
   mCollisionTree.build(p,mCollisionIndices);
 
+  // Store triangles and vertices in leaf order of the tree, the GPU buffers
+  // receive the same order
+  this->reorderCollisionData();
+  mCollisionTree.applyLeafOrder();
+
   mNumIndices = GLsizei(t.size());
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mIndexBuffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * t.size(), &t[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Vec3i) * mCollisionIndices.size(), &mCollisionIndices[0], GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mPositionBuffer);
   glBindBuffer(GL_ARRAY_BUFFER, mPositionBuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * p.size(), &p[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * mCollisionPositions.size(), &mCollisionPositions[0], GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mNormalBuffer);
   glBindBuffer(GL_ARRAY_BUFFER, mNormalBuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * n.size(), &n[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * mCollisionNormals.size(), &mCollisionNormals[0], GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Generate a vertex array object
@@ -79,6 +84,52 @@ void CollisionGeometry::init(const std::vector<Vec3f>& p, const std::vector<Vec3
   mInitialized=true;
 }
 
+void CollisionGeometry::reorderCollisionData()
+{
+  const std::vector<int> &order = mCollisionTree.leafOrder();
+  if(order.size() != mCollisionIndices.size())
+    return;
+
+  //assign new vertex numbers in order of first use
+  const size_t n = mCollisionPositions.size();
+  std::vector<int> oldToNew(n,-1);
+  std::vector<int> newToOld;
+  newToOld.reserve(n);
+
+  std::vector<Vec3i> indices(mCollisionIndices.size());
+  for(size_t i=0;i<order.size();++i)
+  {
+    for(int k=0;k<3;++k)
+    {
+      const int oldVertex = mCollisionIndices[order[i]][k];
+      if(oldToNew[oldVertex] < 0)
+      {
+        oldToNew[oldVertex] = int(newToOld.size());
+        newToOld.push_back(oldVertex);
+      }
+      indices[i][k] = oldToNew[oldVertex];
+    }
+  }
+
+  //keep unreferenced vertices behind the referenced ones
+  for(size_t i=0;i<n;++i)
+    if(oldToNew[i] < 0)
+      newToOld.push_back(int(i));
+
+  mCollisionIndices.swap(indices);
+
+  std::vector<Vec3f>* attributes[2] = {&mCollisionPositions,&mCollisionNormals};
+  for(int a=0;a<2;++a)
+  {
+    if(attributes[a]->size() != n)
+      continue;
+    std::vector<Vec3f> permuted(n);
+    for(size_t i=0;i<n;++i)
+      permuted[i] = (*attributes[a])[newToOld[i]];
+    attributes[a]->swap(permuted);
+  }
+}
+
 void CollisionGeometry::initInstance(std::shared_ptr<CollisionGeometry> original)
 {
   // For instances, only create uniform buffer 
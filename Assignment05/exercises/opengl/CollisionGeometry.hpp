@@ -66,6 +66,10 @@ namespace ogl
       closestIntersectionModel(const Ray &ray, float maxLambda, RayIntersection& intersetion) const;
 
   private:
+    // Permutes the collision triangles into the leaf order of the collision tree
+    // and the vertices into the order of their first use.
+    void reorderCollisionData();
+
     bool   mInitialized;                          //< True if initialized
 
     //Transformation-related
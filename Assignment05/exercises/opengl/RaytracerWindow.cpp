@@ -1,7 +1,12 @@
 #include "RaytracerWindow.hpp"
+#include "ScenePreview.hpp"
+#include <raytracer/Camera.hpp>
 #include <fstream>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <sstream>
 
 namespace rt
 {
@@ -13,6 +18,18 @@ void glfwErrorCallback(int errorCode, const char* description)
 
 void RaytracerWindow::deinit()
 {
+  // The OpenGL functions are only loaded once the quad buffer exists
+  if(mGLFWWindow && mQuadBuffer)
+  {
+    glDeleteBuffers(2,mPixelBuffers);
+    glDeleteTextures(1,&mTexture);
+    glDeleteProgram(mShaderProgram);
+    glDeleteVertexArrays(1,&mQuadVAO);
+    glDeleteBuffers(1,&mQuadBuffer);
+    mPixelBuffers[0]=mPixelBuffers[1]=mTexture=mShaderProgram=mQuadVAO=mQuadBuffer=0;
+    mTextureWidth=mTextureHeight=0;
+  }
+  mGLFWWindow=nullptr;
   glfwTerminate();
 }
 
@@ -80,11 +97,17 @@ bool RaytracerWindow::init()
   // Set polygon mode to allow solid front and back-facing triangles
   glPolygonMode(GL_FRONT_AND_BACK,GL_FILL);
 
+  // The quad and the shaders are the same for every image
+  if(!this->createResources())
+  {
+    this->deinit();
+    return false;
+  }
 
   return true;
 }
 
-void RaytracerWindow::drawOnce(std::shared_ptr<Image> image)
+bool RaytracerWindow::createResources()
 {
   // Generate a vertex array object
   float tri[] = { -1.f, 1.f,0.f,
@@ -93,16 +116,14 @@ void RaytracerWindow::drawOnce(std::shared_ptr<Image> image)
                    1.f,-1.f,0.f,
                    1.f, 1.f,0.f,
                   -1.f, 1.f,0.f};
-  GLuint triangleDummy;
-  glGenBuffers(1,&triangleDummy);
-  glBindBuffer(GL_ARRAY_BUFFER, triangleDummy);
+  glGenBuffers(1,&mQuadBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mQuadBuffer);
   glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 18, &tri[0], GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
-  GLuint quadVAO;
-  glGenVertexArrays(1, &quadVAO);
-  glBindVertexArray(quadVAO);
-  glBindBuffer(GL_ARRAY_BUFFER, triangleDummy);
+  glGenVertexArrays(1, &mQuadVAO);
+  glBindVertexArray(mQuadVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, mQuadBuffer);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glEnableVertexAttribArray(0);
@@ -143,27 +164,140 @@ void RaytracerWindow::drawOnce(std::shared_ptr<Image> image)
     ogl::printOpenGLError();
   }
 
-  GLuint shaderProgram =glCreateProgram();
+  mShaderProgram =glCreateProgram();
   ogl::printOpenGLError();
 
-  // Add and link the shaders to a program
-  glAttachShader(shaderProgram,vertexShaderHandle);
-  glAttachShader(shaderProgram,fragmentShaderHandle);
-  glLinkProgram(shaderProgram);
-  ogl::printGLSLProgramError(shaderProgram);
+  // Add and link the shaders to a program, they are not needed afterwards
+  glAttachShader(mShaderProgram,vertexShaderHandle);
+  glAttachShader(mShaderProgram,fragmentShaderHandle);
+  glLinkProgram(mShaderProgram);
+  ogl::printGLSLProgramError(mShaderProgram);
   ogl::printOpenGLError();
+  glDeleteShader(vertexShaderHandle);
+  glDeleteShader(fragmentShaderHandle);
 
-  glUseProgram(shaderProgram);
-  ogl::printOpenGLError();
+  GLint linked = GL_FALSE;
+  glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE)
+  {
+    std::cerr<<"Error: Failed to link the raytracer window shaders"<<std::endl;
+    return false;
+  }
 
-  GLuint imageTexture;
-  glGenTextures(1, &imageTexture);
-  glBindTexture(GL_TEXTURE_2D, imageTexture);
+  glGenTextures(1, &mTexture);
+  glBindTexture(GL_TEXTURE_2D, mTexture);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
 
+  glGenBuffers(2, mPixelBuffers);
+  ogl::printOpenGLError();
+
+  return true;
+}
+
+static unsigned char quantize(double c)
+{
+  return (unsigned char) std::max(0.0,std::min(255.0,255.0*c));
+}
+
+void RaytracerWindow::resizeTexture(size_t width, size_t height)
+{
+  if(width == mTextureWidth && height == mTextureHeight)
+    return;
+
+  // Tiles that are not finished yet are shown black
+  std::vector<Texel> texels(width*height, Texel{0,0,0,255});
+  glBindTexture(GL_TEXTURE_2D, mTexture);
+  glTexImage2D(
+    GL_TEXTURE_2D, 0,           /* target, level of detail */
+    GL_RGBA8,                   /* internal format */
+    GLsizei(width), GLsizei(height), 0,           /* width, height, border */
+    GL_RGBA, GL_UNSIGNED_BYTE,  /* external format, type */
+    &(texels[0].r)                      /* pixels */
+    );
+  ogl::printOpenGLError();
+  mTextureWidth=width;
+  mTextureHeight=height;
+}
+
+void RaytracerWindow::uploadTiles(const Framebuffer &framebuffer, const std::vector<size_t> &tiles)
+{
+  if(tiles.empty())
+    return;
+
+  const size_t tileTexels = Framebuffer::TileSize*Framebuffer::TileSize;
+  const GLsizeiptr size = GLsizeiptr(tiles.size()*tileTexels*sizeof(Texel));
+
+  // Orphaning the buffer gives fresh memory instead of waiting for the last upload from it
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffers[mNextPixelBuffer]);
+  mNextPixelBuffer = (mNextPixelBuffer+1)%2;
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  Texel* texels = (Texel*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if(!texels)
+  {
+    ogl::printOpenGLError();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
+  }
+  for(size_t k=0;k<tiles.size();++k)
+    for(size_t y=0;y<Framebuffer::TileSize;++y)
+      for(size_t x=0;x<Framebuffer::TileSize;++x)
+      {
+        const Vec4d pixel=framebuffer.tilePixel(tiles[k],x,y);
+        Texel& texel=texels[k*tileTexels+y*Framebuffer::TileSize+x];
+        texel.r=quantize(pixel[0]);
+        texel.g=quantize(pixel[1]);
+        texel.b=quantize(pixel[2]);
+        texel.a=255;
+      }
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  // Each tile is a sub image of the texture, border tiles are cut off
+  glBindTexture(GL_TEXTURE_2D, mTexture);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(Framebuffer::TileSize));
+  for(size_t k=0;k<tiles.size();++k)
+  {
+    const size_t x0=framebuffer.tileOriginX(tiles[k]);
+    const size_t y0=framebuffer.tileOriginY(tiles[k]);
+    const size_t w=std::min(Framebuffer::TileSize,framebuffer.width()-x0);
+    const size_t h=std::min(Framebuffer::TileSize,framebuffer.height()-y0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, GLint(x0), GLint(y0), GLsizei(w), GLsizei(h),
+                    GL_RGBA, GL_UNSIGNED_BYTE, (const void*)(k*tileTexels*sizeof(Texel)));
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  ogl::printOpenGLError();
+}
+
+void RaytracerWindow::drawTexture()
+{
+  // Clear frame and depth buffers
+  glClearColor(0.f,1.f,0.f, 1.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  glUseProgram(mShaderProgram);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, mTexture);
+
+  glBindVertexArray(mQuadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+  glBindVertexArray(0);
+
+  // Hopefully there hasn't been any mistake?
+  ogl::printOpenGLError();
+
+  // Swap the rendering target with the frame buffer shown on the monitor
+  glfwSwapBuffers(mGLFWWindow);
+}
+
+void RaytracerWindow::drawOnce(std::shared_ptr<Image> image)
+{
+  if(!mGLFWWindow)
+    return;
+
   std::vector<Texel> texels(image->width()*image->height());
   for(size_t j=0;j<image->height();++j)
   {
@@ -171,44 +305,190 @@ void RaytracerWindow::drawOnce(std::shared_ptr<Image> image)
     {
       const Vec4d& pixel=image->pixel(i,j);
       Texel& texel=texels[i+image->width()*j];
-      texel.r=(unsigned char) std::max(0.0,std::min(255.0,255.0*pixel[0]));
-      texel.g=(unsigned char) std::max(0.0,std::min(255.0,255.0*pixel[1]));
-      texel.b=(unsigned char) std::max(0.0,std::min(255.0,255.0*pixel[2]));
+      texel.r=quantize(pixel[0]);
+      texel.g=quantize(pixel[1]);
+      texel.b=quantize(pixel[2]);
+      texel.a=255;
     }
   }
 
-  glTexImage2D(
-    GL_TEXTURE_2D, 0,           /* target, level of detail */
-    GL_RGB8,                    /* internal format */
-    GLsizei(image->width()), GLsizei(image->height()), 0,           /* width, height, border */
-    GL_RGB, GL_UNSIGNED_BYTE,   /* external format, type */
-    &(texels[0].r)                      /* pixels */
-    );
+  this->resizeTexture(image->width(),image->height());
+  glBindTexture(GL_TEXTURE_2D, mTexture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GLsizei(image->width()), GLsizei(image->height()),
+                  GL_RGBA, GL_UNSIGNED_BYTE, &(texels[0].r));
+  ogl::printOpenGLError();
 
   while( !glfwWindowShouldClose(mGLFWWindow) )
   {
-    // Clear frame and depth buffers
-    glClearColor(0.f,1.f,0.f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    this->drawTexture();
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, imageTexture);
-    // glUniform1i(g_resources.uniforms.textures[0], 0);
+    std::chrono::milliseconds timespan(50); // or whatever
 
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    std::this_thread::sleep_for(timespan);
 
-    // Hopefully there hasn't been any mistake?
-    ogl::printOpenGLError();
+    glfwPollEvents() ;
+  }
+}
 
-    // Swap the rendering target with the frame buffer shown on the monitor
-    glfwSwapBuffers(mGLFWWindow);
+bool RaytracerWindow::drawProgressive(std::shared_ptr<Raytracer> raytracer,
+                                      std::shared_ptr<Framebuffer> framebuffer)
+{
+  if(!mGLFWWindow)
+    return false;
 
-    std::chrono::milliseconds timespan(50); // or whatever
+  this->resizeTexture(framebuffer->width(),framebuffer->height());
+
+  // The render threads only append finished tiles, all OpenGL calls stay on this thread
+  std::mutex finishedMutex;
+  std::vector<size_t> finished, pending;
+  std::atomic<bool> cancel(false), done(false);
+  bool completed=false;
+  std::thread worker([&]()
+  {
+    completed=raytracer->renderToFramebuffer(framebuffer,[&](size_t tile)
+    {
+      std::lock_guard<std::mutex> lock(finishedMutex);
+      finished.push_back(tile);
+      return !cancel.load();
+    });
+    done=true;
+  });
+
+  size_t shownTiles=0;
+  bool finishedShown=false;
+  while( !glfwWindowShouldClose(mGLFWWindow) )
+  {
+    if(glfwGetKey(mGLFWWindow,GLFW_KEY_ESCAPE) == GLFW_PRESS)
+      glfwSetWindowShouldClose(mGLFWWindow,GL_TRUE);
+
+    // Read before taking the tiles, so the last ones are not missed
+    const bool renderDone=done.load();
+    {
+      std::lock_guard<std::mutex> lock(finishedMutex);
+      pending.swap(finished);
+    }
+    this->uploadTiles(*framebuffer,pending);
+    shownTiles+=pending.size();
+    pending.clear();
+
+    if(!finishedShown)
+    {
+      std::ostringstream title;
+      if(renderDone)
+        title<<"Raytracer: finished";
+      else
+        title<<"Raytracer: "<<shownTiles<<"/"<<framebuffer->numTiles()<<" tiles (Esc cancels)";
+      glfwSetWindowTitle(mGLFWWindow,title.str().c_str());
+      finishedShown=renderDone;
+    }
+
+    this->drawTexture();
+
+    // Refresh quickly while tiles arrive
+    std::chrono::milliseconds timespan(renderDone ? 50 : 16);
 
     std::this_thread::sleep_for(timespan);
 
     glfwPollEvents() ;
   }
+
+  cancel=true;
+  worker.join();
+  return completed;
+}
+
+// The preview camera is stored as user pointer of the window
+static ogl::Camera* previewCamera(GLFWwindow* window)
+{
+  return (ogl::Camera*)glfwGetWindowUserPointer(window);
+}
+
+static void previewResizeCB(GLFWwindow* window, int width, int height)
+{
+  previewCamera(window)->resize(width,height);
+}
+
+static void previewMotionCB(GLFWwindow* window, double x, double y)
+{
+  previewCamera(window)->mouseMoved(int(x),int(y));
+}
+
+static void previewMouseCB(GLFWwindow* window, int button, int state, int /*mods*/)
+{
+  previewCamera(window)->mouseButtonPressed(button,state);
+}
+
+static void previewWheelCB(GLFWwindow* window, double /*xOffset*/, double yOffset)
+{
+  previewCamera(window)->mouseWheelScrolled(int(yOffset));
+}
+
+bool RaytracerWindow::preview(std::shared_ptr<Scene> scene, const std::string &dataPath)
+{
+  if(!mGLFWWindow || !scene->camera())
+    return false;
+
+  ScenePreview scenePreview;
+  if(!scenePreview.init(scene,dataPath))
+    return false;
+
+  int width,height;
+  glfwGetFramebufferSize(mGLFWWindow,&width,&height);
+  ogl::Camera camera(width,height);
+  ScenePreview::toPreviewCamera(*scene->camera(),camera);
+
+  glfwSetWindowUserPointer(mGLFWWindow,&camera);
+  glfwSetFramebufferSizeCallback(mGLFWWindow,previewResizeCB);
+  glfwSetMouseButtonCallback(mGLFWWindow,previewMouseCB);
+  glfwSetScrollCallback(mGLFWWindow,previewWheelCB);
+  glfwSetCursorPosCallback(mGLFWWindow,previewMotionCB);
+  glfwSetWindowTitle(mGLFWWindow,"Scene preview: Enter renders, Esc cancels");
+
+  std::cerr<<"Use your mouse to rotate,pan and zoom the camera"<<std::endl;
+  std::cerr<<"left mouse button + drag -> rotate"<<std::endl;
+  std::cerr<<"middle mouse button + drag -> pan"<<std::endl;
+  std::cerr<<"scroll wheel -> zoom"<<std::endl;
+  std::cerr<<"Enter -> render with this camera"<<std::endl;
+
+  const Vec4d& background=scene->backgroundColor();
+  bool accepted=false;
+  while( !glfwWindowShouldClose(mGLFWWindow) )
+  {
+    if(glfwGetKey(mGLFWWindow,GLFW_KEY_ESCAPE) == GLFW_PRESS)
+      glfwSetWindowShouldClose(mGLFWWindow,GL_TRUE);
+    if(glfwGetKey(mGLFWWindow,GLFW_KEY_ENTER) == GLFW_PRESS || glfwGetKey(mGLFWWindow,GLFW_KEY_KP_ENTER) == GLFW_PRESS)
+    {
+      accepted=true;
+      break;
+    }
+
+    glClearColor(float(background[0]),float(background[1]),float(background[2]),1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scenePreview.draw(camera);
+
+    // Swapping waits for the vertical sync, so no sleep is needed
+    glfwSwapBuffers(mGLFWWindow);
+    glfwPollEvents();
+  }
+
+  // The camera goes out of scope, the image views do not need the callbacks
+  glfwSetFramebufferSizeCallback(mGLFWWindow,nullptr);
+  glfwSetMouseButtonCallback(mGLFWWindow,nullptr);
+  glfwSetScrollCallback(mGLFWWindow,nullptr);
+  glfwSetCursorPosCallback(mGLFWWindow,nullptr);
+  glfwSetWindowUserPointer(mGLFWWindow,nullptr);
+
+  if(!accepted)
+    return false;
+
+  Camera &sceneCamera=*scene->camera();
+  ScenePreview::fromPreviewCamera(camera,sceneCamera);
+  const Vec3d &position=sceneCamera.position(), &lookAt=sceneCamera.lookAt(), &up=sceneCamera.up();
+  std::cout<<"Chosen camera:"<<std::endl
+           <<"  camera->setPosition(rt::Vec3d("<<position[0]<<","<<position[1]<<","<<position[2]<<"));"<<std::endl
+           <<"  camera->setLookAt(rt::Vec3d("<<lookAt[0]<<","<<lookAt[1]<<","<<lookAt[2]<<"));"<<std::endl
+           <<"  camera->setUp(rt::Vec3d("<<up[0]<<","<<up[1]<<","<<up[2]<<"));"<<std::endl
+           <<"  camera->setFOV("<<sceneCamera.horizontalFOV()<<","<<sceneCamera.verticalFOV()<<");"<<std::endl;
+  return true;
 }
 }
@@ -4,13 +4,24 @@
 
 #include <opengl/OpenGL.hpp>
 #include <raytracer/Image.hpp>
+#include <raytracer/Framebuffer.hpp>
+#include <raytracer/Raytracer.hpp>
+#include <raytracer/Scene.hpp>
+
+#include <vector>
 
 namespace rt
 {
   class RaytracerWindow
   {
   public:
-    OPENGL_EXPORTS RaytracerWindow(int width=800, int height=600) {mWidth=width;mHeight=height;}
+    OPENGL_EXPORTS RaytracerWindow(int width=800, int height=600)
+      : mWidth(width), mHeight(height), mGLFWWindow(nullptr),
+        mQuadBuffer(0), mQuadVAO(0), mShaderProgram(0), mTexture(0),
+        mNextPixelBuffer(0), mTextureWidth(0), mTextureHeight(0)
+    {
+      mPixelBuffers[0]=mPixelBuffers[1]=0;
+    }
 
     OPENGL_EXPORTS virtual ~RaytracerWindow(){this->deinit();}
 
@@ -20,19 +31,52 @@ namespace rt
 
     OPENGL_EXPORTS void drawOnce(std::shared_ptr<Image> image);
 
+    // Renders the framebuffer on a worker thread and shows every tile as soon
+    // as it is finished. Escape or closing the window cancels the render,
+    // otherwise the final image stays visible until the window is closed.
+    // Returns true if all tiles were rendered.
+    OPENGL_EXPORTS bool drawProgressive(std::shared_ptr<Raytracer> raytracer,
+                                        std::shared_ptr<Framebuffer> framebuffer);
+
+    // Shows a rasterized preview of the scene (see ScenePreview) that can be
+    // orbited, panned and zoomed with the mouse. Enter hands the chosen view to
+    // the scene camera and prints it, Escape or closing the window keeps the
+    // camera unchanged. Returns true if a view was chosen
+    OPENGL_EXPORTS bool preview(std::shared_ptr<Scene> scene, const std::string &dataPath);
+
   private:
+    // Creates the quad, the shader program, the texture and the pixel buffers.
+    bool createResources();
+
+    // Reallocates the texture if the image size changed.
+    void resizeTexture(size_t width, size_t height);
+
+    // Copies finished tiles through the next pixel buffer into the texture.
+    void uploadTiles(const Framebuffer &framebuffer, const std::vector<size_t> &tiles);
+
+    void drawTexture();
 
     int mWidth;  ///< The width of the OpenGL window
     int mHeight; ///< The height of the OpenGL window
     GLFWwindow* mGLFWWindow;
 
+    GLuint mQuadBuffer;
+    GLuint mQuadVAO;
+    GLuint mShaderProgram;
+    GLuint mTexture;
+    GLuint mPixelBuffers[2];  ///< Used alternately, so the driver can still read the previous one
+    size_t mNextPixelBuffer;
+    size_t mTextureWidth;
+    size_t mTextureHeight;
+
     struct Texel
     {
       unsigned char r;
       unsigned char g;
       unsigned char b;
+      unsigned char a;
    };
   };
 }
 
-#endif //RAYTRACER_WINDOW_HPP_INCLUDE_ONCE
\ No newline at end of file
+#endif //RAYTRACER_WINDOW_HPP_INCLUDE_ONCE
@@ -0,0 +1,224 @@
+#include "ScenePreview.hpp"
+#include "Math.hpp"
+#include <raytracer/Sphere.hpp>
+#include <raytracer/Plane.hpp>
+#include <raytracer/IndexedTriangleMesh.hpp>
+#include <raytracer/LODTriangleMesh.hpp>
+#include <raytracer/PhongMaterial.hpp>
+#include <raytracer/Light.hpp>
+
+namespace rt
+{
+
+// Half side length of the square that stands in for an infinite plane
+static const float PlaneExtent=100.f;
+
+// Segments of the unit sphere around the z-axis and from pole to pole
+static const unsigned int SphereSlices=48;
+static const unsigned int SphereStacks=24;
+
+ScenePreview::ScenePreview()
+{
+}
+
+static void tessellateSphere(std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t)
+{
+  for(unsigned int i=0;i<=SphereStacks;++i)
+  {
+    const float theta=float(M_PI)*float(i)/float(SphereStacks);
+    for(unsigned int j=0;j<=SphereSlices;++j)
+    {
+      const float phi=2.f*float(M_PI)*float(j)/float(SphereSlices);
+      const Vec3f v(std::sin(theta)*std::cos(phi),std::sin(theta)*std::sin(phi),std::cos(theta));
+      p.push_back(v);
+      n.push_back(v);
+    }
+  }
+  for(unsigned int i=0;i<SphereStacks;++i)
+    for(unsigned int j=0;j<SphereSlices;++j)
+    {
+      const unsigned int k=i*(SphereSlices+1)+j;
+      const unsigned int below=k+SphereSlices+1;
+      t.push_back(k); t.push_back(below); t.push_back(k+1);
+      t.push_back(k+1); t.push_back(below); t.push_back(below+1);
+    }
+}
+
+static void tessellatePlane(const Vec3d& normal, std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t)
+{
+  Vec3f U,V,W;
+  ogl::Math::orthonormalBasis(Vec3f(float(normal[0]),float(normal[1]),float(normal[2])),U,V,W);
+  p.push_back((-U-V)*PlaneExtent);
+  p.push_back(( U-V)*PlaneExtent);
+  p.push_back(( U+V)*PlaneExtent);
+  p.push_back((-U+V)*PlaneExtent);
+  n.assign(4,W);
+  const unsigned int indices[6]={0,1,2,0,2,3};
+  t.assign(indices,indices+6);
+}
+
+static void copyMesh(const IndexedTriangleMesh& mesh, std::vector<Vec3f>& p, std::vector<Vec3f>& n, std::vector<unsigned int>& t)
+{
+  const std::vector<int>& indices=mesh.triangleIndices();
+  t.assign(indices.begin(),indices.end());
+
+  const size_t numVertices=mesh.numVertices();
+  p.resize(numVertices);
+  for(size_t i=0;i<numVertices;++i)
+  {
+    const Vec3d v=mesh.vertexPosition(int(i));
+    p[i]=Vec3f(float(v[0]),float(v[1]),float(v[2]));
+  }
+
+  // Meshes without normals get the average of the adjacent face normals
+  n.assign(numVertices,Vec3f(0,0,0));
+  if(mesh.hasVertexNormals())
+  {
+    for(size_t i=0;i<numVertices;++i)
+    {
+      const Vec3d v=mesh.vertexNormal(int(i));
+      n[i]=Vec3f(float(v[0]),float(v[1]),float(v[2]));
+    }
+    return;
+  }
+  for(size_t i=0;i+2<t.size();i+=3)
+  {
+    const Vec3f faceNormal=cross(p[t[i+1]]-p[t[i]],p[t[i+2]]-p[t[i]]);
+    for(size_t c=0;c<3;++c)
+      n[t[i+c]]+=faceNormal;
+  }
+  for(size_t i=0;i<numVertices;++i)
+    if(n[i].length() > 0.f)
+      n[i].normalize();
+}
+
+bool ScenePreview::init(std::shared_ptr<Scene> scene, const std::string &dataPath)
+{
+  mGeometries.clear();
+
+  mShaderProgram = std::make_shared<ogl::ShaderProgram>();
+  if(!mShaderProgram->init(
+      dataPath+"assets/SolidWirePhong.vs",
+      dataPath+"assets/SolidWirePhong.gs",
+      dataPath+"assets/SolidWirePhong.fs"))
+    return false;
+
+  // Tessellates Bezier patches and builds the hierarchies the raytracer uses anyway
+  scene->prepareScene();
+
+  // The shader has three lights, missing ones repeat the last or sit at the camera
+  Vec3f lightPositions[3];
+  for(size_t i=0;i<3;++i)
+  {
+    Vec3d position;
+    if(i < scene->lights().size())
+      position=scene->lights()[i]->position();
+    else if(!scene->lights().empty())
+      position=scene->lights().back()->position();
+    else if(scene->camera())
+      position=scene->camera()->position();
+    lightPositions[i]=Vec3f(float(position[0]),float(position[1]),float(position[2]));
+  }
+
+  for(size_t i=0;i<scene->renderables().size();++i)
+  {
+    const std::shared_ptr<const Renderable> renderable=scene->renderables()[i];
+    std::vector<Vec3f> p,n;
+    std::vector<unsigned int> t;
+
+    std::shared_ptr<const Plane> plane;
+    std::shared_ptr<const IndexedTriangleMesh> mesh;
+    std::shared_ptr<const LODTriangleMesh> lodMesh;
+    if(std::dynamic_pointer_cast<const Sphere>(renderable))
+      tessellateSphere(p,n,t);
+    else if((plane=std::dynamic_pointer_cast<const Plane>(renderable)))
+      tessellatePlane(plane->normal(),p,n,t);
+    else if((mesh=std::dynamic_pointer_cast<const IndexedTriangleMesh>(renderable)))
+      copyMesh(*mesh,p,n,t);
+    else if((lodMesh=std::dynamic_pointer_cast<const LODTriangleMesh>(renderable)) && lodMesh->numLevels() > 0)
+      copyMesh(*lodMesh->level(0),p,n,t);
+    else
+    {
+      std::cerr<<"Warning: Renderable "<<i<<" is not supported by the scene preview"<<std::endl;
+      continue;
+    }
+    if(t.empty())
+      continue;
+
+    std::shared_ptr<ogl::TriangleGeometry> geometry=std::make_shared<ogl::TriangleGeometry>();
+    geometry->init(p,n,t);
+    geometry->modelMatrix()=Mat4x4f(renderable->transform());
+
+    Vec3f color(0.5f,0.5f,0.5f);
+    float shininess=10.f;
+    if(renderable->material())
+    {
+      const Vec3d& c=renderable->material()->color();
+      color=Vec3f(float(c[0]),float(c[1]),float(c[2]));
+      std::shared_ptr<const PhongMaterial> phong=std::dynamic_pointer_cast<const PhongMaterial>(renderable->material());
+      if(phong)
+        shininess=float(phong->shininess());
+    }
+    geometry->setMaterial(shininess,color);
+    geometry->setLightPosition0(lightPositions[0]);
+    geometry->setLightPosition1(lightPositions[1]);
+    geometry->setLightPosition2(lightPositions[2]);
+
+    // Nothing moves in the preview, so the uniforms are uploaded once
+    geometry->updateUniforms();
+    mGeometries.push_back(geometry);
+  }
+  return true;
+}
+
+void ScenePreview::draw(ogl::Camera &camera) const
+{
+  // Set polygon mode to allow solid front and back-facing triangles
+  glPolygonMode(GL_FRONT_AND_BACK,GL_FILL);
+
+  // Use the Phong shader
+  glUseProgram(mShaderProgram->handle());
+
+  // Upload possibly changed camera setup (e.g. camera eye) to GPU
+  camera.updateUniforms();
+  camera.bind(mShaderProgram->handle(),0,"ub_Camera");
+
+  for(size_t i=0;i<mGeometries.size();++i)
+  {
+    mGeometries[i]->bind(mShaderProgram->handle(),1,"ub_Geometry");
+    glBindVertexArray(mGeometries[i]->handle());
+    glDrawElements(GL_TRIANGLES, mGeometries[i]->numIndices(),GL_UNSIGNED_INT, (void*)0);
+  }
+  glBindVertexArray(0);
+
+  // Unbind the Phong shader
+  glUseProgram(0);
+  ogl::printOpenGLError();
+}
+
+void ScenePreview::toPreviewCamera(const Camera &camera, ogl::Camera &preview)
+{
+  const Vec3d& position=camera.position();
+  const Vec3d& lookAt=camera.lookAt();
+  const Vec3d& up=camera.up();
+  preview.setPosition(Vec3f(float(position[0]),float(position[1]),float(position[2])));
+  preview.setTarget(Vec3f(float(lookAt[0]),float(lookAt[1]),float(lookAt[2])));
+  preview.setUp(Vec3f(float(up[0]),float(up[1]),float(up[2])));
+  preview.setFOVY(float(camera.verticalFOV()));
+}
+
+void ScenePreview::fromPreviewCamera(const ogl::Camera &preview, Camera &camera)
+{
+  const Vec3f& position=preview.position();
+  const Vec3f& target=preview.target();
+  const Vec3f& up=preview.up();
+  camera.setPosition(Vec3d(position[0],position[1],position[2]));
+  camera.setLookAt(Vec3d(target[0],target[1],target[2]));
+  camera.setUp(Vec3d(up[0],up[1],up[2]));
+
+  const double verticalFOV=preview.fovy();
+  const double horizontalFOV=360.0/M_PI*std::atan(std::tan(verticalFOV*M_PI/360.0)*preview.aspectRatio());
+  camera.setFOV(horizontalFOV,verticalFOV);
+}
+
+} //namespace rt
@@ -0,0 +1,49 @@
+#ifndef SCENEPREVIEW_HPP_INCLUDE_ONCE
+#define SCENEPREVIEW_HPP_INCLUDE_ONCE
+#include "openglConfig.hpp"
+
+#include "OpenGL.hpp"
+#include "Camera.hpp"
+#include "ShaderProgram.hpp"
+#include "TriangleGeometry.hpp"
+#include <raytracer/Scene.hpp>
+#include <raytracer/Camera.hpp>
+
+#include <vector>
+#include <memory>
+
+namespace rt
+{
+
+// This class rasterizes the renderables of a raytracer scene with the
+// SolidWirePhong shaders, which is fast enough to place the camera
+// interactively. Spheres, planes and indexed triangle meshes (including
+// hierarchies, Bezier patches and levels of detail) are supported, other
+// renderables are skipped with a warning
+class ScenePreview
+{
+public:
+  OPENGL_EXPORTS ScenePreview();
+
+  // Needs a current OpenGL context. Loads the shaders from the assets folder
+  // below dataPath, prepares the scene and uploads a triangle geometry for
+  // every supported renderable together with its transformation and color
+  OPENGL_EXPORTS bool init(std::shared_ptr<Scene> scene, const std::string &dataPath);
+
+  // Draws all geometries as seen by the camera
+  OPENGL_EXPORTS void draw(ogl::Camera &camera) const;
+
+  // Copies position, target, up vector and vertical field of view of a raytracer camera
+  OPENGL_EXPORTS static void toPreviewCamera(const Camera &camera, ogl::Camera &preview);
+
+  // Copies the preview camera back, the horizontal field of view follows from its aspect ratio
+  OPENGL_EXPORTS static void fromPreviewCamera(const ogl::Camera &preview, Camera &camera);
+
+private:
+  std::shared_ptr<ogl::ShaderProgram> mShaderProgram;                 //< SolidWirePhong shader program
+  std::vector<std::shared_ptr<ogl::TriangleGeometry>> mGeometries;    //< One geometry per shown renderable
+};
+
+} //namespace rt
+
+#endif //SCENEPREVIEW_HPP_INCLUDE_ONCE
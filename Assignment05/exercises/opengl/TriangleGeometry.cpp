@@ -23,29 +23,77 @@ TriangleGeometry::~TriangleGeometry()
 }
 
 void TriangleGeometry::init(const std::vector<Vec3f>& p, const std::vector<Vec3f>& n, const std::vector<unsigned int>& t)
+{
+  this->createBuffers(p.empty() ? 0 : &p[0], n.empty() ? 0 : &n[0], p.size(), t.empty() ? 0 : &t[0], t.size());
+}
+
+// Returns true if the indices form whole triangles that only reference existing vertices
+static bool validTriangleIndices(const unsigned int* t, size_t numTriangleIndices, size_t numVertices)
+{
+  if (numTriangleIndices % 3 != 0)
+    return false;
+  for (size_t i=0;i<numTriangleIndices;++i)
+    if (t[i] >= numVertices)
+      return false;
+  return true;
+}
+
+bool TriangleGeometry::init(const rt::MeshFile &file)
+{
+  const size_t numVertices = file.count(rt::MeshFile::Positions);
+  if (file.count(rt::MeshFile::Normals) != numVertices)
+  {
+    std::cerr<<"Error: Mesh file does not contain vertex normals"<<std::endl;
+    return false;
+  }
+  const unsigned int* t = (const unsigned int*)file.data(rt::MeshFile::Indices);
+
+  // The indices are uploaded unchecked otherwise, the GPU would read beyond the vertex buffers
+  if (!validTriangleIndices(t,file.count(rt::MeshFile::Indices),numVertices))
+  {
+    std::cerr<<"Error: Mesh file contains invalid triangle indices"<<std::endl;
+    return false;
+  }
+
+  //single precision files need no conversion
+  if (file.singlePrecision())
+  {
+    this->createBuffers((const Vec3f*)file.data(rt::MeshFile::Positions),(const Vec3f*)file.data(rt::MeshFile::Normals),
+                        numVertices,t,file.count(rt::MeshFile::Indices));
+    return true;
+  }
+
+  std::vector<Vec3f> p, n;
+  file.copyAttribute(rt::MeshFile::Positions,p);
+  file.copyAttribute(rt::MeshFile::Normals,n);
+  this->createBuffers(p.empty() ? 0 : &p[0],n.empty() ? 0 : &n[0],numVertices,t,file.count(rt::MeshFile::Indices));
+  return true;
+}
+
+void TriangleGeometry::createBuffers(const Vec3f* p, const Vec3f* n, size_t numVertices, const unsigned int* t, size_t numTriangleIndices)
 {
   //Create and copy buffer data for the indexed triangle set
 
   this->clear();
 
-  mNumIndices = GLsizei(t.size());
+  mNumIndices = GLsizei(numTriangleIndices);
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mIndexBuffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * t.size(), &t[0], GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * numTriangleIndices, t, GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mPositionBuffer);
   glBindBuffer(GL_ARRAY_BUFFER, mPositionBuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * p.size(), &p[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * numVertices, p, GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Create and copy index buffer on GPU
   glGenBuffers(1, &mNormalBuffer);
   glBindBuffer(GL_ARRAY_BUFFER, mNormalBuffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * n.size(), &n[0], GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vec3f) * numVertices, n, GL_STATIC_DRAW);
   ogl::printOpenGLError();
 
   // Generate a vertex array object
@@ -3,6 +3,7 @@
 #include "openglConfig.hpp"
 
 #include "OpenGL.hpp"
+#include <raytracer/MeshFile.hpp>
 #include <vector>
 #include <memory>
 
@@ -21,6 +22,9 @@ public:
   // Initialize by a set of vertex positions, vertex normals and triangle indices (starting from 0)
   OPENGL_EXPORTS void init(const std::vector<Vec3f>& p, const std::vector<Vec3f>& n, const std::vector<unsigned int>& t);
 
+  // Initialize from a binary mesh file, single precision sections are uploaded straight from the mapped file
+  OPENGL_EXPORTS bool init(const rt::MeshFile &file);
+
   // Initialize an instance by storing a shared pointer to the original triangle geometry
   OPENGL_EXPORTS void initInstance(std::shared_ptr<TriangleGeometry> original);
   OPENGL_EXPORTS void clear();
@@ -50,6 +54,9 @@ public:
   OPENGL_EXPORTS void bind(const GLuint shaderProgram,const GLuint bindingPoint=0, const std::string &blockName="ub_Geometry") const;
 
 private:
+  // Creates the buffers from raw arrays of numVertices positions and normals and numTriangleIndices indices
+  void createBuffers(const Vec3f* p, const Vec3f* n, size_t numVertices, const unsigned int* t, size_t numTriangleIndices);
+
   Mat4x4f   mModelMatrix;                          //< The model matrix.
   //<
   GLuint mIndexBuffer;                          //< Handle to the VBO storing triangle indices
@@ -0,0 +1,170 @@
+#include "BVHCache.hpp"
+#include "MappedFile.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace rt
+{
+
+static const char     BVHCacheMagic[8]  = {'C','G','B','V','H',0,0,0};
+static const uint32_t BVHCacheByteOrder = 0x01020304u;
+// Increment whenever BVTree::build() produces different trees
+static const uint32_t BVHBuilderVersion = 2;
+
+struct BVHCacheHeader
+{
+  char     magic[8];
+  uint32_t byteOrder;
+  uint32_t builderVersion;
+  uint64_t hash;
+  uint64_t numTriangles;
+  uint64_t numNodes;
+  uint64_t nodeSize;
+};
+
+// Mixes 8 bytes at a time, fast enough to be negligible next to the build
+static uint64_t hashBytes(const void *data, size_t size, uint64_t h)
+{
+  const unsigned char *p = (const unsigned char*)data;
+  for (;size >= 8;size-=8,p+=8)
+  {
+    uint64_t w;
+    memcpy(&w,p,8);
+    w *= 0xFF51AFD7ED558CCDull;
+    w ^= w >> 33;
+    h = (h ^ w)*0x9E3779B97F4A7C15ull;
+  }
+  for (;size > 0;--size,++p)
+    h = (h ^ *p)*0x100000001B3ull;
+  return h;
+}
+
+unsigned long long BVHCache::hash(const std::vector<Vec3d> &vertexPositions,
+                                  const std::vector<int> &triangleIndices)
+{
+  const uint64_t sizes[4] = { vertexPositions.size(), triangleIndices.size(), BVHBuilderVersion,
+                              sizeof(BVTree::PackedNode) };
+  uint64_t h = hashBytes(sizes,sizeof(sizes),0xCBF29CE484222325ull);
+  if (!vertexPositions.empty())
+    h = hashBytes(&vertexPositions[0],vertexPositions.size()*sizeof(Vec3d),h);
+  if (!triangleIndices.empty())
+    h = hashBytes(&triangleIndices[0],triangleIndices.size()*sizeof(int),h);
+  h ^= h >> 29;
+  return h;
+}
+
+std::string BVHCache::entryPath(unsigned long long hash) const
+{
+  char name[32];
+  snprintf(name,sizeof(name),"%016llx.bvh",hash);
+  return mDirectory + "/" + name;
+}
+
+bool BVHCache::load(unsigned long long hash, size_t numTriangles,
+                    std::vector<int> &leafOrder, BVTree &tree) const
+{
+  if (!this->enabled())
+    return false;
+
+  //a missing entry is the regular cache miss, no message
+  MappedFile file;
+  if (!file.open(this->entryPath(hash)) || file.size() < sizeof(BVHCacheHeader))
+    return false;
+
+  BVHCacheHeader header;
+  memcpy(&header,file.data(),sizeof(header));
+  const uint64_t orderBytes = (header.numTriangles*sizeof(int32_t)+7)/8*8;
+  const bool valid = memcmp(header.magic,BVHCacheMagic,sizeof(BVHCacheMagic)) == 0 &&
+                     header.byteOrder == BVHCacheByteOrder &&
+                     header.builderVersion == BVHBuilderVersion &&
+                     header.hash == hash &&
+                     header.numTriangles == numTriangles &&
+                     header.nodeSize == sizeof(BVTree::PackedNode) &&
+                     file.size() == sizeof(header) + orderBytes + header.numNodes*header.nodeSize;
+  if (!valid)
+  {
+    std::cerr<<"Warning: Ignoring invalid BVH cache entry "<<this->entryPath(hash)<<std::endl;
+    return false;
+  }
+
+  //the leaf order has to be a permutation of the triangles
+  const int32_t *order = (const int32_t*)(file.data()+sizeof(header));
+  std::vector<bool> used(numTriangles,false);
+  for (size_t i=0;i<numTriangles;++i)
+  {
+    if (order[i] < 0 || size_t(order[i]) >= numTriangles || used[order[i]])
+    {
+      std::cerr<<"Warning: Ignoring invalid BVH cache entry "<<this->entryPath(hash)<<std::endl;
+      return false;
+    }
+    used[order[i]] = true;
+  }
+
+  const BVTree::PackedNode *nodes = (const BVTree::PackedNode*)(file.data()+sizeof(header)+orderBytes);
+  if (!tree.unpackNodes(nodes,size_t(header.numNodes),numTriangles))
+  {
+    std::cerr<<"Warning: Ignoring invalid BVH cache entry "<<this->entryPath(hash)<<std::endl;
+    return false;
+  }
+  leafOrder.assign(order,order+numTriangles);
+  return true;
+}
+
+bool BVHCache::store(unsigned long long hash, const std::vector<int> &leafOrder, const BVTree &tree) const
+{
+  if (!this->enabled())
+    return false;
+
+  std::vector<BVTree::PackedNode> nodes;
+  tree.packNodes(nodes);
+
+  BVHCacheHeader header;
+  memcpy(header.magic,BVHCacheMagic,sizeof(BVHCacheMagic));
+  header.byteOrder      = BVHCacheByteOrder;
+  header.builderVersion = BVHBuilderVersion;
+  header.hash           = hash;
+  header.numTriangles   = leafOrder.size();
+  header.numNodes       = nodes.size();
+  header.nodeSize       = sizeof(BVTree::PackedNode);
+
+  const std::string path = this->entryPath(hash);
+  const std::string temporaryPath = path + "." +
+    std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+  {
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::out);
+    if (!out.is_open())
+    {
+      std::cerr<<"Warning: Could not write BVH cache entry "<<path<<std::endl;
+      return false;
+    }
+    const char padding[8] = {0};
+    out.write((const char*)&header,sizeof(header));
+    if (!leafOrder.empty())
+      out.write((const char*)&leafOrder[0],std::streamsize(leafOrder.size()*sizeof(int32_t)));
+    out.write(padding,std::streamsize((8-(leafOrder.size()*sizeof(int32_t))%8)%8));
+    if (!nodes.empty())
+      out.write((const char*)&nodes[0],std::streamsize(nodes.size()*sizeof(BVTree::PackedNode)));
+    if (!out)
+    {
+      out.close();
+      std::remove(temporaryPath.c_str());
+      std::cerr<<"Warning: Could not write BVH cache entry "<<path<<std::endl;
+      return false;
+    }
+  }
+
+  //another process may have stored the same entry in the meantime, both are identical
+  if (std::rename(temporaryPath.c_str(),path.c_str()) != 0)
+  {
+    std::remove(temporaryPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+} //namespace rt
@@ -0,0 +1,49 @@
+#ifndef BVHCACHE_HPP_INCLUDE_ONCE
+#define BVHCACHE_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <string>
+#include <vector>
+#include "Math.hpp"
+#include "BVTree.hpp"
+
+namespace rt
+{
+
+/// Persistent cache of built hierarchies in a directory. Every entry is a
+/// file named after a 64 bit hash of the vertex positions, the triangle
+/// indices and the builder version. It stores the leaf order of the
+/// triangles and the nodes after BVTree::applyLeafOrder(). Entries are
+/// memory-mapped when loaded and validated against the mesh.
+class BVHCache
+{
+public:
+  /// Uses the given directory, which has to exist. An empty path disables the cache.
+  RAYTRACER_EXPORTS explicit BVHCache(const std::string &directory) : mDirectory(directory) {}
+
+  RAYTRACER_EXPORTS bool enabled() const { return !mDirectory.empty(); }
+
+  /// Hash identifying the hierarchy built for the given mesh.
+  RAYTRACER_EXPORTS static unsigned long long hash(const std::vector<Vec3d> &vertexPositions,
+                                                   const std::vector<int> &triangleIndices);
+
+  /// Looks up the hierarchy for a mesh with the given hash and number of triangles.
+  /// On success leafOrder receives the triangle order and tree the hierarchy.
+  RAYTRACER_EXPORTS bool load(unsigned long long hash, size_t numTriangles,
+                              std::vector<int> &leafOrder, BVTree &tree) const;
+
+  /// Stores a hierarchy, leafOrder is the order before the tree's leaf order was applied.
+  /// The entry is written to a temporary file first, so concurrent readers never see partial entries.
+  RAYTRACER_EXPORTS bool store(unsigned long long hash, const std::vector<int> &leafOrder,
+                               const BVTree &tree) const;
+
+private:
+  std::string entryPath(unsigned long long hash) const;
+
+  std::string mDirectory;
+};
+
+} //namespace rt
+
+#endif //BVHCACHE_HPP_INCLUDE_ONCE
@@ -1,49 +1,149 @@
 #include "BVHIndexedTriangleMesh.hpp"
 #include "BVTree.hpp"
+#include "BVHCache.hpp"
 #include "Helper.hpp"
 
 namespace rt
 {
 
-BVHIndexedTriangleMesh::BVHIndexedTriangleMesh() : IndexedTriangleMesh()
+BVHIndexedTriangleMesh::BVHIndexedTriangleMesh() : IndexedTriangleMesh(), mTreeVersion(0)
 {
 
 }
 
+static std::string& cacheDirectory()
+{
+  static std::string directory;
+  return directory;
+}
+
+void BVHIndexedTriangleMesh::setHierarchyCacheDirectory(const std::string &directory)
+{
+  cacheDirectory() = directory;
+}
+
+const std::string& BVHIndexedTriangleMesh::hierarchyCacheDirectory()
+{
+  return cacheDirectory();
+}
+
 void BVHIndexedTriangleMesh::initialize()
 {
-  mTree.build(this->vertexPositions(),*((const std::vector<Vec3i>*)(&this->triangleIndices())));
+  const std::vector<Vec3i> &triangles = *((const std::vector<Vec3i>*)(&this->triangleIndices()));
+  std::vector<Vec3d> buffer;
+
+  //the hierarchy is up to date, e.g. it was loaded with the mesh or built before
+  //by a MeshLoader, so only the packets may be missing
+  if(mTreeVersion == this->dataVersion() && mTree.leafOrder().size() == triangles.size())
+  {
+    if(!this->hasTrianglePackets())
+      this->buildTrianglePackets();
+    return;
+  }
+
+  //compact storage, the tree is built from temporarily decoded positions
+  const std::vector<Vec3d> &positions = this->fullPrecisionPositions(buffer);
+
+  //reuse a hierarchy built for the same mesh in an earlier run
+  const BVHCache cache(cacheDirectory());
+  unsigned long long hash = 0;
+  std::vector<int> leafOrder;
+  if(cache.enabled())
+  {
+    hash = BVHCache::hash(positions,this->triangleIndices());
+    if(cache.load(hash,triangles.size(),leafOrder,mTree))
+    {
+      this->reorderTriangles(leafOrder);
+      this->buildTrianglePackets();
+      mTreeVersion = this->dataVersion();
+      return;
+    }
+  }
+
+  mTree.build(positions,triangles);
+
+  //permute triangles and vertices into leaf order, so that spatially adjacent
+  //leaves are also adjacent in memory
+  this->reorderTriangles(mTree.leafOrder());
+  if(cache.enabled())
+    leafOrder = mTree.leafOrder();
+  mTree.applyLeafOrder();
+  if(cache.enabled())
+    cache.store(hash,leafOrder,mTree);
+
+  //the subtrees of the hierarchy are now contiguous ranges of triangles
+  this->buildTrianglePackets();
+  mTreeVersion = this->dataVersion();
+}
+
+bool BVHIndexedTriangleMesh::loadFromMeshFile(const MeshFile &file)
+{
+  mTreeVersion = 0;
+  if(!IndexedTriangleMesh::loadFromMeshFile(file))
+    return false;
+
+  //the hierarchy is only valid for the positions exactly as stored
+  if(file.count(MeshFile::HierarchyNodes) == 0 || this->vertexStorage() != FullPrecision)
+    return true;
+  if(file.elementSize(MeshFile::HierarchyNodes) != sizeof(BVTree::PackedNode) ||
+     !mTree.unpackNodes((const BVTree::PackedNode*)file.data(MeshFile::HierarchyNodes),
+                        file.count(MeshFile::HierarchyNodes),this->triangleIndices().size()/3))
+  {
+    std::cerr<<"Warning: Ignoring invalid hierarchy in mesh file"<<std::endl;
+    return true;
+  }
+  mTreeVersion = this->dataVersion();
+  return true;
+}
+
+bool BVHIndexedTriangleMesh::saveToBinary(std::ostream &out, bool singlePrecision) const
+{
+  std::vector<BVTree::PackedNode> nodes;
+  if(!singlePrecision && mTree.leafOrder().size() == this->triangleIndices().size()/3)
+    mTree.packNodes(nodes);
+  return this->writeMeshFile(out,singlePrecision,nodes.empty() ? 0 : &nodes[0],
+                             nodes.size(),sizeof(BVTree::PackedNode));
+}
+
+size_t BVHIndexedTriangleMesh::memoryUsage() const
+{
+  return IndexedTriangleMesh::memoryUsage() + mTree.memoryUsage();
 }
 
 bool
   BVHIndexedTriangleMesh::closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const
 {
-  const std::vector<int> &intersectionCandidates = mTree.intersectBoundingBoxes(ray,maxLambda);
+  //without packets (compact storage) every triangle is tested on its own, so the boxes of all leaves are tested
+  const bool packed = this->hasTrianglePackets();
+  const std::vector<Vec2i> &ranges = mTree.intersectLeafRanges(ray,maxLambda,packed ? TrianglePacketArray::lanes() : 1);
+  const TrianglePacketArray &packets = this->trianglePackets();
+  const std::vector<int> &indices = this->triangleIndices();
 
   double closestLambda = maxLambda;
   Vec3d closestbary;
   int  closestTri = -1;
 
+  size_t slot;
   Vec3d bary;
   double lambda;
-
-  for(size_t i=0;i<intersectionCandidates.size();++i)
+  for(size_t i=0;i<ranges.size();++i)
   {
-    const int triangleIndex = intersectionCandidates[i];
-    const int idx0 = this->triangleIndices()[3*triangleIndex+0];
-    const int idx1 = this->triangleIndices()[3*triangleIndex+1];
-    const int idx2 = this->triangleIndices()[3*triangleIndex+2];
-
-    const Vec3d &p0 = this->vertexPositions()[idx0];
-    const Vec3d &p1 = this->vertexPositions()[idx1];
-    const Vec3d &p2 = this->vertexPositions()[idx2];
-
-	if (Helper::Helper2(ray, p0, p1, p2, bary, lambda) &&
-      lambda > 0 && lambda < closestLambda)
+    if(packed)
     {
-      closestLambda = lambda;
-      closestbary = bary;
-      closestTri = triangleIndex;
+      if(packets.closestIntersection(ray,ranges[i][0],ranges[i][1],closestLambda,closestbary,slot))
+        closestTri = packets.triangle(slot);
+      continue;
+    }
+    for(int tri=ranges[i][0];tri<ranges[i][0]+ranges[i][1];++tri)
+    {
+      if(Helper::Helper2(ray,this->vertexPosition(indices[3*tri+0]),this->vertexPosition(indices[3*tri+1]),
+                         this->vertexPosition(indices[3*tri+2]),bary,lambda) &&
+         lambda > 0 && lambda < closestLambda)
+      {
+        closestLambda = lambda;
+        closestbary = bary;
+        closestTri = tri;
+      }
     }
   }
 
@@ -53,23 +153,23 @@ bool
     const int i1 = this->triangleIndices()[3*closestTri+1];
     const int i2 = this->triangleIndices()[3*closestTri+2];
 
-    const Vec3d &p0 = this->vertexPositions()[i0];
-    const Vec3d &p1 = this->vertexPositions()[i1];
-    const Vec3d &p2 = this->vertexPositions()[i2];
+    const Vec3d p0 = this->vertexPosition(i0);
+    const Vec3d p1 = this->vertexPosition(i1);
+    const Vec3d p2 = this->vertexPosition(i2);
 
     Vec3d n;
-    if(this->vertexNormals().empty())
+    if(!this->hasVertexNormals())
       n = cross(p1-p0,p2-p0).normalize();
     else
-      n = this->vertexNormals()[i0]*closestbary[0]+
-          this->vertexNormals()[i1]*closestbary[1]+
-          this->vertexNormals()[i2]*closestbary[2];
+      n = this->vertexNormal(i0)*closestbary[0]+
+          this->vertexNormal(i1)*closestbary[1]+
+          this->vertexNormal(i2)*closestbary[2];
 
     Vec3d uvw(0,0,0);
-    if(!this->vertexTextureCoordinates().empty())
-      uvw = this->vertexTextureCoordinates()[i0]*closestbary[0]+
-            this->vertexTextureCoordinates()[i1]*closestbary[1]+
-            this->vertexTextureCoordinates()[i2]*closestbary[2];
+    if(this->hasVertexTextureCoordinates())
+      uvw = this->vertexTextureCoordinate(i0)*closestbary[0]+
+            this->vertexTextureCoordinate(i1)*closestbary[1]+
+            this->vertexTextureCoordinate(i2)*closestbary[2];
 
     intersection=RayIntersection(ray,shared_from_this(),closestLambda,n,uvw);
     return true;
@@ -81,25 +181,26 @@ bool
 
 bool BVHIndexedTriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda) const
 {
-  std::vector<int> intersectionCandidates = mTree.intersectBoundingBoxes(ray,maxLambda);
-
+  const bool packed = this->hasTrianglePackets();
+  const std::vector<Vec2i> &ranges = mTree.intersectLeafRanges(ray,maxLambda,packed ? TrianglePacketArray::lanes() : 1);
+  const TrianglePacketArray &packets = this->trianglePackets();
+  const std::vector<int> &indices = this->triangleIndices();
 
   Vec3d bary;
   double lambda;
-  for(size_t i=0;i<intersectionCandidates.size();++i)
+  for(size_t i=0;i<ranges.size();++i)
   {
-    const int triangleIndex = intersectionCandidates[i];
-    const int idx0 = this->triangleIndices()[3*triangleIndex+0];
-    const int idx1 = this->triangleIndices()[3*triangleIndex+1];
-    const int idx2 = this->triangleIndices()[3*triangleIndex+2];
-
-    const Vec3d &p0 = this->vertexPositions()[idx0];
-    const Vec3d &p1 = this->vertexPositions()[idx1];
-    const Vec3d &p2 = this->vertexPositions()[idx2];
-
-	if (Helper::Helper2(ray, p0, p1, p2, bary, lambda) &&
-      lambda > 0 && lambda < maxLambda)
-      return true;
+    if(packed)
+    {
+      if(packets.anyIntersection(ray,ranges[i][0],ranges[i][1],maxLambda))
+        return true;
+      continue;
+    }
+    for(int tri=ranges[i][0];tri<ranges[i][0]+ranges[i][1];++tri)
+      if(Helper::Helper2(ray,this->vertexPosition(indices[3*tri+0]),this->vertexPosition(indices[3*tri+1]),
+                         this->vertexPosition(indices[3*tri+2]),bary,lambda) &&
+         lambda > 0 && lambda < maxLambda)
+        return true;
   }
 
   return false;
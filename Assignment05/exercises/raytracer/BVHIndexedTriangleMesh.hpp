@@ -13,14 +13,35 @@ class BVHIndexedTriangleMesh : public IndexedTriangleMesh
 public:
   RAYTRACER_EXPORTS BVHIndexedTriangleMesh();
 
+  /// Builds the hierarchy and permutes triangles and vertices into its leaf order.
+  /// After loadFromBinary() the stored hierarchy is used instead of a new build,
+  /// and nothing is rebuilt as long as the mesh data did not change.
   RAYTRACER_EXPORTS void initialize() override;
 
+  /// Writes the mesh in leaf order together with the hierarchy, call initialize() first.
+  /// Single precision files are written without hierarchy, because it was built from
+  /// the double precision positions.
+  RAYTRACER_EXPORTS bool saveToBinary(std::ostream &out, bool singlePrecision=false) const override;
+  using IndexedTriangleMesh::saveToBinary;
+
+  /// Uses the hierarchy stored in the file if it is valid for the mesh.
+  RAYTRACER_EXPORTS bool loadFromMeshFile(const MeshFile &file) override;
+
+  /// Includes the hierarchy.
+  RAYTRACER_EXPORTS size_t memoryUsage() const override;
+
+  /// Directory of a persistent BVHCache shared by all meshes, initialize() then reuses
+  /// hierarchies built for identical meshes in earlier runs. Empty (the default) disables it.
+  RAYTRACER_EXPORTS static void setHierarchyCacheDirectory(const std::string &directory);
+  RAYTRACER_EXPORTS static const std::string& hierarchyCacheDirectory();
+
   RAYTRACER_EXPORTS bool closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const override;
 
   RAYTRACER_EXPORTS bool anyIntersectionModel(const Ray &ray, double maxLambda) const override;
 
 private:
   BVTree mTree;
+  unsigned long long mTreeVersion;  //!< data version mTree was built or loaded for, 0 if none
 };
 } //namespace rt
 
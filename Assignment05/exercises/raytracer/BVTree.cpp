@@ -12,9 +12,11 @@ BVTree::BVTree()
 #if defined(_OPENMP)
   mTempCandidates.resize(omp_get_max_threads());
   mTempTraversalJobs.resize(omp_get_max_threads());
+  mTempRanges.resize(omp_get_max_threads());
 #else
   mTempCandidates.resize(1);
   mTempTraversalJobs.resize(1);
+  mTempRanges.resize(1);
 #endif
 }
 
@@ -54,13 +56,165 @@ const std::vector<int>& BVTree::intersectBoundingBoxes(const Ray &ray, const dou
   return tempCandidates;
 }
 
+const std::vector<Vec2i>& BVTree::intersectLeafRanges(const Ray &ray, const double maxLambda,
+                                                      unsigned int maxRangeSize) const
+{
+#if defined(_OPENMP)
+  std::vector<Vec2i>& tempRanges=mTempRanges[omp_get_thread_num()];
+  std::stack<int>& tempTraversalJobs = mTempTraversalJobs[omp_get_thread_num()];
+#else
+  std::vector<Vec2i>& tempRanges=mTempRanges[0];
+  std::stack<int>& tempTraversalJobs = mTempTraversalJobs[0];
+#endif
+
+  tempRanges.clear();
+  if(mNodes.empty())
+    return tempRanges;
+  tempTraversalJobs.push(0);
+
+  while(!tempTraversalJobs.empty())
+  {
+    //take current job
+    int node = tempTraversalJobs.top();
+    tempTraversalJobs.pop();
+
+    //test ray vs. bounding box of node
+    if(mNodes[node].bbox.anyIntersection(ray,maxLambda))
+    {
+      //small subtrees and leaves are handed out as a contiguous range
+      if(mNodes[node].count <= maxRangeSize || mNodes[node].right == -1)
+        tempRanges.push_back(Vec2i(int(mNodes[node].first),int(mNodes[node].count)));
+      else
+      {
+        tempTraversalJobs.push(mNodes[node].left);
+        tempTraversalJobs.push(mNodes[node].right);
+      }
+    }
+  }
+  return tempRanges;
+}
+
+void BVTree::computeLeafOrder()
+{
+  mLeafOrder.clear();
+  if(mNodes.empty())
+    return;
+
+  //children are always stored behind their parent, so the triangle counts
+  //can be accumulated backwards and the ranges assigned forwards
+  for(size_t i=mNodes.size();i-->0;)
+  {
+    Node &node = mNodes[i];
+    if(node.right == -1)
+      node.count = 1;
+    else
+      node.count = mNodes[node.left].count + mNodes[node.right].count;
+  }
+
+  mLeafOrder.resize(mNodes[0].count);
+  mNodes[0].first = 0;
+  for(size_t i=0;i<mNodes.size();++i)
+  {
+    const Node &node = mNodes[i];
+    if(node.right == -1)
+      mLeafOrder[node.first] = -node.left;
+    else
+    {
+      mNodes[node.left].first  = node.first;
+      mNodes[node.right].first = node.first + mNodes[node.left].count;
+    }
+  }
+}
+
+void BVTree::applyLeafOrder()
+{
+  for(size_t i=0;i<mNodes.size();++i)
+    if(mNodes[i].right == -1)
+      mNodes[i].left = -int(mNodes[i].first);
+  for(size_t i=0;i<mLeafOrder.size();++i)
+    mLeafOrder[i] = int(i);
+}
+
+void BVTree::packNodes(std::vector<PackedNode> &nodes) const
+{
+  nodes.resize(mNodes.size());
+  for(size_t i=0;i<mNodes.size();++i)
+  {
+    nodes[i].left  = mNodes[i].left;
+    nodes[i].right = mNodes[i].right;
+    nodes[i].first = mNodes[i].first;
+    nodes[i].count = mNodes[i].count;
+    for(unsigned int d=0;d<3;++d)
+    {
+      nodes[i].min[d] = mNodes[i].bbox.min()[d];
+      nodes[i].max[d] = mNodes[i].bbox.max()[d];
+    }
+  }
+}
+
+bool BVTree::unpackNodes(const PackedNode *nodes, size_t numNodes, size_t numTriangles)
+{
+  mNodes.clear();
+  mLeafOrder.clear();
+  if(numNodes == 0 || numNodes != 2*numTriangles-1)
+    return false;
+
+  mNodes.resize(numNodes);
+  //the parents come first, so when a node is reached in this loop all its
+  //references are known and the nodes form a tree iff each has exactly one
+  std::vector<unsigned char> referenced(numNodes,0);
+  referenced[0] = 1;
+  bool valid = true;
+  for(size_t i=0;valid && i<numNodes;++i)
+  {
+    const PackedNode &packed = nodes[i];
+
+    //children have to be stored behind their parent
+    if(packed.right == -1)
+      valid = packed.left <= 0 && size_t(-packed.left) < numTriangles;
+    else
+      valid = packed.left > int(i) && packed.right > int(i) && packed.left != packed.right &&
+              size_t(packed.left) < numNodes && size_t(packed.right) < numNodes &&
+              !referenced[packed.left] && !referenced[packed.right];
+    valid = valid && referenced[i];
+    if(valid && packed.right != -1)
+      referenced[packed.left] = referenced[packed.right] = 1;
+
+    mNodes[i].left  = packed.left;
+    mNodes[i].right = packed.right;
+    mNodes[i].bbox  = BoundingBox(Vec3d(packed.min[0],packed.min[1],packed.min[2]),
+                                  Vec3d(packed.max[0],packed.max[1],packed.max[2]));
+  }
+
+  //every triangle has to be stored exactly once, in leaf order
+  if(valid)
+  {
+    this->computeLeafOrder();
+    valid = mLeafOrder.size() == numTriangles;
+    for(size_t i=0;valid && i<mLeafOrder.size();++i)
+      valid = mLeafOrder[i] == int(i);
+  }
+  if(!valid)
+  {
+    mNodes.clear();
+    mLeafOrder.clear();
+  }
+  return valid;
+}
+
+size_t BVTree::memoryUsage() const
+{
+  return mNodes.size()*sizeof(Node) + mLeafOrder.size()*sizeof(int);
+}
+
 void BVTree::createNodes(const std::vector<Vec3d> &vertexPositions,
     const std::vector<Vec3i> &triangleIndices)
 {
-  size_t n=triangleIndices.size();
+  int n=int(triangleIndices.size());
   mTempTriangleBoxes.resize(n);
 
-  for(unsigned int i=0;i<n;++i)
+#pragma omp parallel for
+  for(int i=0;i<n;++i)
   {
     const Vec3d &v0 = vertexPositions[triangleIndices[i][0]];
     const Vec3d &v1 = vertexPositions[triangleIndices[i][1]];
@@ -84,19 +238,23 @@ void BVTree::sortTriangles()
 
   mTempSortedTriangleIndices.resize(n);
 
-  std::vector<int> permutation(n);
+  //the three orderings are independent, ties are broken by the triangle index
+  //so that the result does not depend on the initial order
+#pragma omp parallel for
+  for(int dim=0;dim<3;++dim)
+  {
+    std::vector<int> permutation(n);
 
-  //init permutation
-  for(unsigned int i=0;i<n;++i)
-    permutation[i]=int(i);
+    //init permutation
+    for(unsigned int i=0;i<n;++i)
+      permutation[i]=int(i);
 
-  for(unsigned int dim=0;dim<3;++dim)
-  {
     //sort according to dim-coordinate of bounding box centers
     std::sort(permutation.begin(), permutation.end(), [&triangleNodes,dim](int a, int b) -> bool
     {
-      return (triangleNodes[a].max()[dim]+triangleNodes[a].min()[dim]) <
-             (triangleNodes[b].max()[dim]+triangleNodes[b].min()[dim]);
+      const double centerA = triangleNodes[a].max()[dim]+triangleNodes[a].min()[dim];
+      const double centerB = triangleNodes[b].max()[dim]+triangleNodes[b].min()[dim];
+      return centerA < centerB || (centerA == centerB && a < b);
     });
 
     //copy permutation indices to result
@@ -107,9 +265,24 @@ void BVTree::sortTriangles()
 
 void BVTree::build(const std::vector<Vec3d> &vertexPositions,const std::vector<Vec3i> &triangleIndices)
 {
+  //discard a previously built hierarchy
+  mNodes.clear();
+
   //create bounding boxes for all triangles
   this->createNodes(vertexPositions,triangleIndices);
-  unsigned n = unsigned(triangleIndices.size());
+  this->buildFromTriangleBoxes();
+}
+
+void BVTree::build(const std::vector<BoundingBox> &boxes)
+{
+  mNodes.clear();
+  mTempTriangleBoxes = boxes;
+  this->buildFromTriangleBoxes();
+}
+
+void BVTree::buildFromTriangleBoxes()
+{
+  unsigned n = unsigned(mTempTriangleBoxes.size());
   //sort triangles by x,y and z
   //sortedTriangles now holds sorting permutations for orderings w.r.t x,y,z in the three components
   this->sortTriangles();
@@ -129,7 +302,17 @@ void BVTree::build(const std::vector<Vec3d> &vertexPositions,const std::vector<V
     mNodes.push_back(root);
   }
 
-  this->buildHierarchy(0,0,n);
+  //a single triangle is stored in the root, which cannot be split
+  if(n == 1)
+  {
+    mNodes[0].left  = 0;
+    mNodes[0].right = -1;
+  }
+  else if(n > 1)
+    this->buildHierarchy(0,0,n);
+  else
+    mNodes.clear();
+  this->computeLeafOrder();
 
   //clear temporary storage
   std::vector<bool>().swap(mTempMarker);
@@ -20,15 +20,54 @@ public:
   //build from indexed triangle set
   RAYTRACER_EXPORTS void build(const std::vector<Vec3d> &vertexPositions,const std::vector<Vec3i> &triangleIndices);
 
+  //build from arbitrary boxes, the leaves then refer to indices into boxes
+  RAYTRACER_EXPORTS void build(const std::vector<BoundingBox> &boxes);
+
   //returns a set of triangle indices as candidates for ray-triangle intersection
   RAYTRACER_EXPORTS const std::vector<int>& intersectBoundingBoxes(const Ray &ray, const double maxLambda) const;
+
+  //triangle indices in the order in which the leaves of the hierarchy are stored,
+  //the triangles of every subtree form a contiguous range
+  RAYTRACER_EXPORTS const std::vector<int>& leafOrder() const { return mLeafOrder; }
+
+  //renumbers the leaves after the caller has permuted its triangles into leafOrder(),
+  //afterwards leafOrder() is the identity
+  RAYTRACER_EXPORTS void applyLeafOrder();
+
+  //returns ranges (first,count) into leafOrder() as candidates for ray-triangle intersection,
+  //subtrees with at most maxRangeSize triangles are returned as a whole without further box tests
+  RAYTRACER_EXPORTS const std::vector<Vec2i>& intersectLeafRanges(const Ray &ray, const double maxLambda,
+                                                                  unsigned int maxRangeSize) const;
+
+  //flat node record for storing a hierarchy in a file
+  struct PackedNode
+  {
+    int left;
+    int right;
+    unsigned int first;
+    unsigned int count;
+    double min[3];
+    double max[3];
+  };
+
+  //copies the nodes into flat records
+  RAYTRACER_EXPORTS void packNodes(std::vector<PackedNode> &nodes) const;
+
+  //replaces the hierarchy by stored nodes whose leaf order has been applied,
+  //returns false if they do not form a valid tree over numTriangles triangles
+  RAYTRACER_EXPORTS bool unpackNodes(const PackedNode *nodes, size_t numNodes, size_t numTriangles);
+
+  //number of bytes occupied by the nodes and the leaf order
+  RAYTRACER_EXPORTS size_t memoryUsage() const;
 private:
 
   struct Node
   {
-    Node() {left=0;right=0;}
+    Node() {left=0;right=0;first=0;count=0;}
     int left;
     int right;
+    unsigned int first; //first position of the subtree in mLeafOrder
+    unsigned int count; //number of triangles in the subtree
     BoundingBox bbox;
   };
   void sortTriangles();
@@ -40,7 +79,12 @@ private:
 
   void computeBoundingBoxAreas(unsigned int offset, unsigned int numTriangles);
 
+  void buildFromTriangleBoxes();
+
+  void computeLeafOrder();
+
   std::vector<Node> mNodes;
+  std::vector<int>  mLeafOrder;
 
   std::vector<bool>        mTempMarker;
   std::vector<BoundingBox> mTempTriangleBoxes;
@@ -50,6 +94,7 @@ private:
   std::vector<Vec3d>        mTempAreasRight;
   mutable std::vector<std::vector<int>>         mTempCandidates;   
   mutable std::vector<std::stack<int>>          mTempTraversalJobs;
+  mutable std::vector<std::vector<Vec2i>>       mTempRanges;
 
 };
 }
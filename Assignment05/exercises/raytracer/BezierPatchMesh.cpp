@@ -1,4 +1,5 @@
 #include "BezierPatchMesh.hpp"
+#include "Camera.hpp"
 #include <functional>
 
 namespace rt
@@ -6,7 +7,8 @@ namespace rt
 
   BezierPatchMesh::BezierPatchMesh(size_t m,    size_t n,
     size_t resu, size_t resv) : BVHIndexedTriangleMesh(),
-  mM(m), mN(n), mResU(resu), mResV(resv)
+  mM(m), mN(n), mResU(resu), mResV(resv), mBasisResU(0), mBasisResV(0),
+  mSamplesPerSecond(0), mPixelTolerance(0.5)
   {
     // Allocate memory for Bezier points
     mControlPoints.resize(m*n);
@@ -16,75 +18,239 @@ namespace rt
   {
     //this function samples the underlying continuous patch and tessellates it
     //regularly with triangles
+    size_t resu, resv;
+    this->adaptiveResolution(resu, resv);
 
-    //sample at triangle vertices at uniform uv parameters
-    std::vector<BezierPatchSample> samples; samples.reserve(mResU*mResV);
+    Chrono before = std::chrono::high_resolution_clock::now();
+    this->tessellate(resu, resv);
+    ChronoDuration timeToTessellate = std::chrono::duration_cast<ChronoDuration>(std::chrono::high_resolution_clock::now()-before);
+
+    const double numSamples = double(resu*resv);
+    mSamplesPerSecond = timeToTessellate.count() > 0 ? numSamples/timeToTessellate.count() : 0;
+
+    BVHIndexedTriangleMesh::initialize();
+  }
+
+  void BezierPatchMesh::adaptiveResolution(size_t &resu, size_t &resv) const
+  {
+    resu = mResU;
+    resv = mResV;
+    if(!mCamera)
+      return;
 
-    for(size_t j=0; j<mResV; ++j)
-      for(size_t i=0; i<mResU; ++i)
-        samples.push_back(this->sample(double(i) / (mResU-1), double(j) / (mResV-1)));
+    std::vector<Vec3d> points(mControlPoints.size());
+    for(size_t i=0; i<points.size(); ++i)
+      points[i] = this->transform()*mControlPoints[i];
 
-    //construct triangle strips based on the computed samples
-    for(size_t j=0; j<mResV-1; ++j)
+    //the patch lies in the convex hull of its control points, so the closest
+    //control point bounds the largest pixel footprint on the patch
+    const Vec3d eye = mCamera->position();
+    const Vec3d viewDirection = (mCamera->lookAt()-eye).normalize();
+    double depth = std::numeric_limits<double>::max();
+    for(size_t i=0; i<points.size(); ++i)
+      depth = std::min(depth, dot(points[i]-eye, viewDirection));
+
+    //patches reaching behind the camera keep the full resolution
+    if(depth <= Math::safetyEps())
+      return;
+
+    //world-space size of a pixel and of the tolerated error at that depth
+    const double pixelSize = depth*2.0*tan(mCamera->horizontalFOV()*M_PI/360.0)/
+                             double(mCamera->xResolution());
+    const double tolerance = mPixelTolerance*pixelSize;
+
+    //number of grid samples along the curves of count points with the given
+    //stride, for all numCurves curves starting curveStride apart
+    auto resolution = [&](size_t count, size_t stride, size_t numCurves, size_t curveStride, size_t maxRes) -> size_t
     {
-      for(size_t i=0; i<mResU-1; ++i)
+      double length = 0, flatness = 0;
+      for(size_t c=0; c<numCurves; ++c)
       {
-        const size_t i00 = mResU* j    +  i,
-          i10 = mResU* j    + (i+1),
-          i01 = mResU*(j+1) +  i,
-          i11 = mResU*(j+1) + (i+1);
+        const Vec3d *curve = &points[c*curveStride];
+        double curveLength = 0;
+        for(size_t i=0; i+1<count; ++i)
+          curveLength += (curve[(i+1)*stride]-curve[i*stride]).length();
+        for(size_t i=1; i+1<count; ++i)
+          flatness = std::max(flatness,
+            (curve[(i-1)*stride] - 2.0*curve[i*stride] + curve[(i+1)*stride]).length());
+        length = std::max(length, curveLength);
+      }
+
+      //a degree d curve deviates from its N-segment polygon by at most
+      //d(d-1)/(8N^2) times the largest second difference of its control points
+      const double degree = double(count-1);
+      const double flatSegments = std::ceil(std::sqrt(degree*(degree-1)*flatness/(8.0*tolerance)));
+      //segments much shorter than a pixel do not add visible detail
+      const double sizeSegments = std::ceil(length/pixelSize);
 
+      const double segments = std::max(1.0, std::min(flatSegments, sizeSegments));
+      return std::max(size_t(2), std::min(maxRes, size_t(segments)+1));
+    };
+
+    resu = resolution(mM, 1,  mN, mM, mResU);
+    resv = resolution(mN, mM, mM, 1,  mResV);
+  }
+
+  void BezierPatchMesh::computeBasis(size_t numPoints, size_t res,
+                                     std::vector<double> &basis, std::vector<double> &derivative)
+  {
+    basis.assign(numPoints*res, 0.0);
+    derivative.assign(numPoints*res, 0.0);
+
+    const size_t degree = numPoints-1;
+    std::vector<double> b(numPoints);
+
+    for(size_t k=0; k<res; ++k)
+    {
+      const double t = double(k) / (res-1);
+
+      //raise the degree step by step: B_i^r = (1-t) B_i^(r-1) + t B_(i-1)^(r-1)
+      std::fill(b.begin(), b.end(), 0.0);
+      b[0] = 1.0;
+      for(size_t r=1; r<=degree; ++r)
+      {
+        //the derivative of B_i^n is n (B_(i-1)^(n-1) - B_i^(n-1))
+        if(r == degree)
+          for(size_t i=0; i<numPoints; ++i)
+            derivative[k*numPoints+i] = double(degree) *
+              ((i > 0 ? b[i-1] : 0.0) - (i < degree ? b[i] : 0.0));
+
+        for(size_t i=r; i>0; --i)
+          b[i] = (1-t)*b[i] + t*b[i-1];
+        b[0] *= (1-t);
+      }
+
+      for(size_t i=0; i<numPoints; ++i)
+        basis[k*numPoints+i] = b[i];
+    }
+  }
+
+  void BezierPatchMesh::tessellate(size_t resu, size_t resv)
+  {
+    //the basis tables only change with the grid resolution
+    if(mBasisResU != resu)
+    {
+      computeBasis(mM, resu, mBasisU, mBasisDerivativeU);
+      mBasisResU = resu;
+    }
+    if(mBasisResV != resv)
+    {
+      computeBasis(mN, resv, mBasisV, mBasisDerivativeV);
+      mBasisResV = resv;
+    }
+
+    const int resU = int(resu), resV = int(resv);
+    const size_t numVertices = resu*resv;
+
+    std::vector<Vec3d> positions(numVertices), normals(numVertices), uvws(numVertices);
+    std::vector<int> indices(6*(resu-1)*(resv-1));
+
+    //sample at triangle vertices at uniform uv parameters
+#pragma omp parallel
+    {
+      // points and v derivatives of the u curve at the current v parameter
+      std::vector<Vec3d> curvePoints(mM), curveDerivatives(mM);
+
+#pragma omp for schedule(static)
+      for(int j=0; j<resV; ++j)
+      {
+        const double *bv  = &mBasisV[j*mN];
+        const double *dbv = &mBasisDerivativeV[j*mN];
+
+        //collapse the v direction once per grid row
+        for(size_t i=0; i<mM; ++i)
         {
-          //construct lower triangle
-          const Vec3d &v0 = samples[i00].position,
-            &v1 = samples[i10].position,
-            &v2 = samples[i01].position;
-          const Vec2d &p0 = samples[i00].uv,
-            &p1 = samples[i10].uv,
-            &p2 = samples[i01].uv;
-          Vec3d  n0 = samples[i00].normal,
-            n1 = samples[i10].normal,
-            n2 = samples[i01].normal;
-
-          if(!n0.lengthSquared() || !n1.lengthSquared() || !n2.lengthSquared())
+          Vec3d p, dp;
+          for(size_t k=0; k<mN; ++k)
           {
-            //fall back to triangle normals if normals are not defined
-            const Vec3d normal = cross((v1-v0),(v2-v0)).normalize();
-            n0 = normal; n1 = normal; n2 = normal;
+            const Vec3d &c = this->controlPoint(i,k);
+            p  += c*bv[k];
+            dp += c*dbv[k];
           }
-
-          int i0=this->addVertex(v0,n0,Vec3d(p0,0));
-          int i1=this->addVertex(v1,n1,Vec3d(p1,0));
-          int i2=this->addVertex(v2,n2,Vec3d(p2,0));
-          this->addTriangle(i0,i1,i2);
+          curvePoints[i] = p;
+          curveDerivatives[i] = dp;
         }
 
+        for(int i=0; i<resU; ++i)
         {
-          //construct upper triangle
-          const Vec3d &v0 = samples[i10].position,
-            &v1 = samples[i11].position,
-            &v2 = samples[i01].position;
-          const Vec2d &p0 = samples[i10].uv,
-            &p1 = samples[i11].uv,
-            &p2 = samples[i01].uv;
-          Vec3d n0 = samples[i10].normal,
-            n1 = samples[i11].normal,
-            n2 = samples[i01].normal;
-
-          if(!n0.lengthSquared() || !n1.lengthSquared() || !n2.lengthSquared())
+          const double *bu  = &mBasisU[i*mM];
+          const double *dbu = &mBasisDerivativeU[i*mM];
+
+          Vec3d p, utangent, vtangent;
+          for(size_t k=0; k<mM; ++k)
           {
-            //fall back to triangle normals if normals are not defined
-            const Vec3d normal = cross((v1-v0),(v2-v0)).normalize();
-            n0 = normal; n1 = normal; n2 = normal;
+            p        += curvePoints[k]*bu[k];
+            utangent += curvePoints[k]*dbu[k];
+            vtangent += curveDerivatives[k]*bu[k];
           }
-          int i0=this->addVertex(v0,n0,Vec3d(p0,0));
-          int i1=this->addVertex(v1,n1,Vec3d(p1,0));
-          int i2=this->addVertex(v2,n2,Vec3d(p2,0));
-          this->addTriangle(i0,i1,i2);
+
+          const size_t idx = resu*j + i;
+          positions[idx] = p;
+          normals[idx]   = cross(utangent,vtangent).normalize();
+          uvws[idx]      = Vec3d(double(i) / (resu-1), double(j) / (resv-1), 0);
+        }
+      }
+
+      //construct two triangles per grid cell on the shared vertices
+#pragma omp for schedule(static)
+      for(int j=0; j<resV-1; ++j)
+      {
+        for(int i=0; i<resU-1; ++i)
+        {
+          const int i00 = resU* j    +  i,
+            i10 = resU* j    + (i+1),
+            i01 = resU*(j+1) +  i,
+            i11 = resU*(j+1) + (i+1);
+
+          int *tri = &indices[6*(size_t(resU-1)*j + i)];
+          //lower triangle
+          tri[0] = i00; tri[1] = i10; tri[2] = i01;
+          //upper triangle
+          tri[3] = i10; tri[4] = i11; tri[5] = i01;
         }
       }
     }
-    BVHIndexedTriangleMesh::initialize();
+
+    //surface normals are undefined where the patch degenerates (e.g. collapsed
+    //edges); fall back to the average of the adjacent triangle normals there
+    std::vector<bool> undefinedNormal(numVertices);
+    bool anyUndefined = false;
+    for(size_t i=0; i<numVertices; ++i)
+    {
+      undefinedNormal[i] = !normals[i].lengthSquared();
+      anyUndefined = anyUndefined || undefinedNormal[i];
+    }
+    if(anyUndefined)
+    {
+      for(size_t t=0; t<indices.size(); t+=3)
+      {
+        const int i0 = indices[t], i1 = indices[t+1], i2 = indices[t+2];
+        const Vec3d normal = cross((positions[i1]-positions[i0]),(positions[i2]-positions[i0])).normalize();
+        if(undefinedNormal[i0]) normals[i0] += normal;
+        if(undefinedNormal[i1]) normals[i1] += normal;
+        if(undefinedNormal[i2]) normals[i2] += normal;
+      }
+      for(size_t i=0; i<numVertices; ++i)
+        if(undefinedNormal[i])
+          normals[i].normalize();
+
+      //corners of collapsed edges only touch degenerate triangles,
+      //borrow the normal of the next grid row or column instead
+      for(int j=0; j<resV; ++j)
+        for(int i=0; i<resU; ++i)
+        {
+          Vec3d &n = normals[size_t(resU)*j + i];
+          if(n.lengthSquared())
+            continue;
+          const int jn = j < resV-1 ? j+1 : j-1;
+          const int in = i < resU-1 ? i+1 : i-1;
+          n = normals[size_t(resU)*jn + i];
+          if(!n.lengthSquared())
+            n = normals[size_t(resU)*j + in];
+        }
+    }
+
+    this->setMeshData(std::move(positions), std::move(normals), std::move(uvws), std::move(indices));
   }
 
   BoundingBox BezierPatchMesh::computeBoundingBox() const
@@ -7,6 +7,7 @@
 
 namespace rt
 {
+class Camera;
 
 // Bezier surface stores the set of control points and allows
 // creation of a triangle mesh by sampling the parametric surface
@@ -27,6 +28,25 @@ public:
   // Creates the set of triangles.
   RAYTRACER_EXPORTS void initialize();
 
+  // Number of surface samples evaluated per second by the last initialize().
+  RAYTRACER_EXPORTS double tessellationThroughput() const { return mSamplesPerSecond; }
+
+  /**
+   * @brief Enables screen-space adaptive tessellation
+   * The triangle resolution is chosen in initialize() from the projected
+   * size and the flatness of the patch as seen by the camera, such that the
+   * triangles deviate at most pixelTolerance pixels from the surface.
+   * resu and resv given to the constructor remain the upper bound.
+   * @param camera         camera the scene is rendered with, nullptr disables
+   * @param pixelTolerance maximal screen-space deviation in pixels
+   */
+  RAYTRACER_EXPORTS void setAdaptiveTessellation(std::shared_ptr<const Camera> camera,
+                                                 double pixelTolerance=0.5)
+  {
+    mCamera = camera;
+    mPixelTolerance = pixelTolerance;
+  }
+
   RAYTRACER_EXPORTS void setControlPoint(size_t i, size_t j, const Vec3d& p)
   {
     mControlPoints[mM*j + i] = p;
@@ -60,10 +80,31 @@ private:
   std::pair<Vec3d,Vec3d> deCasteljau(const std::vector<Vec3d> &curvePoints, double t) const;
   void deCasteljauRec(std::vector<Vec3d> &points, double t) const;
 
+  // Tabulates the Bernstein polynomials of the given number of control points
+  // and their derivatives at res uniform parameters in [0,1].
+  // Entry [k*numPoints+i] holds B_i(t_k).
+  static void computeBasis(size_t numPoints, size_t res,
+                           std::vector<double> &basis, std::vector<double> &derivative);
+
+  // Evaluates the surface on the whole resu x resv parameter grid and
+  // creates a shared vertex grid with two indexed triangles per grid cell.
+  void tessellate(size_t resu, size_t resv);
+
+  // Computes the grid resolution required by the adaptive tessellation.
+  void adaptiveResolution(size_t &resu, size_t &resv) const;
+
   size_t mM, mN;                    //!< patch control point dimensions
   size_t mResU, mResV;              //!< triangle resolution in both parameter directions
   std::vector<Vec3d> mControlPoints; //!< patch control points
 
+  std::vector<double> mBasisU, mBasisDerivativeU; //!< Bernstein tables in u direction
+  std::vector<double> mBasisV, mBasisDerivativeV; //!< Bernstein tables in v direction
+  size_t mBasisResU, mBasisResV;                   //!< resolution of the Bernstein tables
+  double mSamplesPerSecond;                        //!< throughput of the last tessellation
+
+  std::shared_ptr<const Camera> mCamera;           //!< camera for adaptive tessellation
+  double mPixelTolerance;                          //!< screen-space error bound in pixels
+
 };
 } //namespace rt
 
@@ -49,6 +49,29 @@ bool BoundingBox::anyIntersection(const Ray &ray, double maxLambda) const
   return true;
 }
 
+double BoundingBox::entryDistance(const Ray &ray) const
+{
+  double tnear = 0;
+  double tfar = std::numeric_limits<double>::max();
+  for (int i=0; i<3; i++)
+  {
+    if (ray.direction()[i])
+    {
+      double t1 = (mMin[i]-ray.origin()[i])/ray.direction()[i];
+      double t2 = (mMax[i]-ray.origin()[i])/ray.direction()[i];
+      if (t1 > t2)
+        std::swap(t1,t2);
+      tnear = std::max(tnear,t1);
+      tfar = std::min(tfar,t2);
+      if (tnear > tfar)
+        return std::numeric_limits<double>::infinity();
+    }
+    else if (ray.origin()[i]<mMin[i] || ray.origin()[i]>mMax[i])
+      return std::numeric_limits<double>::infinity();
+  }
+  return tnear;
+}
+
 void BoundingBox::expandByPoint(const Vec3d& p)
 {
   for (int i=0;i<3;++i)
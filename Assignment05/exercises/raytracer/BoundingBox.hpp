@@ -24,6 +24,9 @@ public:
   // Returns true in case of any intersection
   RAYTRACER_EXPORTS bool anyIntersection(const Ray &ray, double maxLambda) const;
 
+  // Distance at which the ray enters the box, 0 if it starts inside and infinity if it misses
+  RAYTRACER_EXPORTS double entryDistance(const Ray &ray) const;
+
   RAYTRACER_EXPORTS void merge(const BoundingBox& box); // merge with a given bounding box
         
   RAYTRACER_EXPORTS const Vec3d& min() const { return mMin; }
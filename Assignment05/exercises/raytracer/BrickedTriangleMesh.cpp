@@ -0,0 +1,442 @@
+#include "BrickedTriangleMesh.hpp"
+#include "MeshFile.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace rt
+{
+
+static const char     BrickFileMagic[8]  = {'C','G','B','R','I','C','K',0};
+static const uint32_t BrickFileByteOrder = 0x01020304u;
+static const uint32_t BrickFileVersion   = 1;
+static const uint64_t BrickAlignment     = 4096;  // bricks start on their own pages
+
+struct BrickFileHeader
+{
+  char     magic[8];
+  uint32_t byteOrder;
+  uint32_t version;
+  uint64_t numBricks;
+};
+
+struct BrickFileEntry
+{
+  double   min[3];
+  double   max[3];
+  uint64_t offset;        // of the brick's MeshFile, multiple of BrickAlignment
+  uint64_t size;
+  uint64_t numTriangles;
+};
+
+// Splits triangles[first,first+count) at the median center along the longest
+// axis of the centers until the parts are small enough.
+static void splitBricks(const std::vector<Vec3d> &centers, std::vector<int> &triangles,
+                        size_t first, size_t count, size_t maxCount,
+                        std::vector<std::pair<size_t,size_t>> &bricks)
+{
+  if(count <= maxCount)
+  {
+    bricks.push_back(std::make_pair(first,count));
+    return;
+  }
+
+  BoundingBox box;
+  for(size_t i=first;i<first+count;++i)
+    box.expandByPoint(centers[triangles[i]]);
+  const Vec3d extent = box.max()-box.min();
+  unsigned int dim = 0;
+  if(extent[1] > extent[dim]) dim = 1;
+  if(extent[2] > extent[dim]) dim = 2;
+
+  const size_t half = count/2;
+  std::nth_element(triangles.begin()+first,triangles.begin()+first+half,triangles.begin()+first+count,
+                   [&centers,dim](int a, int b) -> bool
+  {
+    return centers[a][dim] < centers[b][dim] || (centers[a][dim] == centers[b][dim] && a < b);
+  });
+
+  splitBricks(centers,triangles,first,half,maxCount,bricks);
+  splitBricks(centers,triangles,first+half,count-half,maxCount,bricks);
+}
+
+BrickedTriangleMesh::BrickedTriangleMesh() :
+  mNumTriangles(0), mMemoryLimit(0), mResidentMemory(0), mBrickLoads(0)
+{
+#if defined(_OPENMP)
+  mTempHits.resize(omp_get_max_threads());
+#else
+  mTempHits.resize(1);
+#endif
+}
+
+bool BrickedTriangleMesh::writeBricks(const IndexedTriangleMesh &mesh, const std::string &filePath,
+                                      size_t trianglesPerBrick)
+{
+  const std::vector<int> &indices = mesh.triangleIndices();
+  const size_t numTriangles = indices.size()/3;
+  const size_t numVertices = mesh.numVertices();
+  if(numTriangles == 0)
+  {
+    std::cerr<<"Error: Cannot write an empty mesh as bricks"<<std::endl;
+    return false;
+  }
+  trianglesPerBrick = std::max(trianglesPerBrick,size_t(2));
+
+  //partition the triangles by their centers
+  std::vector<Vec3d> centers(numTriangles);
+  std::vector<int> triangles(numTriangles);
+  for(size_t i=0;i<numTriangles;++i)
+  {
+    centers[i] = mesh.vertexPosition(indices[3*i+0])+
+                 mesh.vertexPosition(indices[3*i+1])+
+                 mesh.vertexPosition(indices[3*i+2]);
+    triangles[i] = int(i);
+  }
+  std::vector<std::pair<size_t,size_t>> ranges;
+  splitBricks(centers,triangles,0,numTriangles,trianglesPerBrick,ranges);
+  std::vector<Vec3d>().swap(centers);
+
+  std::ofstream out(filePath, std::ios::binary | std::ios::out);
+  if(!out.is_open())
+  {
+    std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+
+  //the table is written again once the bricks are placed
+  BrickFileHeader header;
+  memcpy(header.magic,BrickFileMagic,sizeof(BrickFileMagic));
+  header.byteOrder = BrickFileByteOrder;
+  header.version   = BrickFileVersion;
+  header.numBricks = ranges.size();
+  std::vector<BrickFileEntry> entries(ranges.size());
+  memset(&entries[0],0,entries.size()*sizeof(BrickFileEntry));
+  out.write((const char*)&header,sizeof(header));
+  out.write((const char*)&entries[0],std::streamsize(entries.size()*sizeof(BrickFileEntry)));
+
+  const bool normals = mesh.hasVertexNormals();
+  const bool textureCoordinates = mesh.hasVertexTextureCoordinates();
+  std::vector<int> localIndex(numVertices,-1);
+  const char padding[BrickAlignment] = {0};
+  bool written = true;
+  for(size_t b=0;b<ranges.size() && written;++b)
+  {
+    //copy the triangles with the vertices they use
+    std::vector<Vec3d> brickPositions, brickNormals, brickTextureCoordinates;
+    std::vector<int> brickIndices, usedVertices;
+    brickIndices.reserve(3*ranges[b].second);
+    for(size_t i=ranges[b].first;i<ranges[b].first+ranges[b].second;++i)
+    {
+      for(unsigned int c=0;c<3;++c)
+      {
+        const int v = indices[3*triangles[i]+c];
+        if(localIndex[v] < 0)
+        {
+          localIndex[v] = int(brickPositions.size());
+          usedVertices.push_back(v);
+          brickPositions.push_back(mesh.vertexPosition(v));
+          if(normals)
+            brickNormals.push_back(mesh.vertexNormal(v));
+          if(textureCoordinates)
+            brickTextureCoordinates.push_back(mesh.vertexTextureCoordinate(v));
+        }
+        brickIndices.push_back(localIndex[v]);
+      }
+    }
+    for(size_t i=0;i<usedVertices.size();++i)
+      localIndex[usedVertices[i]] = -1;
+
+    BoundingBox box;
+    for(size_t i=0;i<brickPositions.size();++i)
+      box.expandByPoint(brickPositions[i]);
+
+    BVHIndexedTriangleMesh brick;
+    brick.setMeshData(std::move(brickPositions),std::move(brickNormals),
+                      std::move(brickTextureCoordinates),std::move(brickIndices));
+    brick.initialize();
+
+    uint64_t offset = uint64_t(out.tellp());
+    const uint64_t aligned = (offset+BrickAlignment-1)/BrickAlignment*BrickAlignment;
+    out.write(padding,std::streamsize(aligned-offset));
+    written = brick.saveToBinary(out);
+
+    BrickFileEntry &entry = entries[b];
+    for(unsigned int d=0;d<3;++d)
+    {
+      entry.min[d] = box.min()[d];
+      entry.max[d] = box.max()[d];
+    }
+    entry.offset       = aligned;
+    entry.size         = uint64_t(out.tellp())-aligned;
+    entry.numTriangles = ranges[b].second;
+  }
+
+  out.seekp(0);
+  out.write((const char*)&header,sizeof(header));
+  out.write((const char*)&entries[0],std::streamsize(entries.size()*sizeof(BrickFileEntry)));
+  if(!written || !out)
+  {
+    std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+void BrickedTriangleMesh::close()
+{
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  mCache.clear();
+  mLeastRecentlyUsed.clear();
+  mResidentMemory = 0;
+  mBricks.clear();
+  mBrickTree = BVTree();
+  mNumTriangles = 0;
+  mFile.close();
+}
+
+bool BrickedTriangleMesh::open(const std::string &filePath)
+{
+  this->close();
+  if(!mFile.open(filePath))
+  {
+    std::cerr<<"Error: Could not open file "<<filePath<<std::endl;
+    return false;
+  }
+
+  const char *data = mFile.data();
+  const uint64_t size = mFile.size();
+
+  BrickFileHeader header;
+  if(size < sizeof(BrickFileHeader))
+  {
+    std::cerr<<"Error: "<<filePath<<" is not a brick file"<<std::endl;
+    this->close();
+    return false;
+  }
+  memcpy(&header,data,sizeof(BrickFileHeader));
+  if(memcmp(header.magic,BrickFileMagic,sizeof(BrickFileMagic)) != 0 || header.byteOrder != BrickFileByteOrder)
+  {
+    std::cerr<<"Error: "<<filePath<<" is not a brick file"<<std::endl;
+    this->close();
+    return false;
+  }
+  if(header.version != BrickFileVersion)
+  {
+    std::cerr<<"Error: Unsupported brick file version "<<header.version<<std::endl;
+    this->close();
+    return false;
+  }
+  if(header.numBricks == 0 || header.numBricks > (size-sizeof(BrickFileHeader))/sizeof(BrickFileEntry))
+  {
+    std::cerr<<"Error: Corrupt brick table in "<<filePath<<std::endl;
+    this->close();
+    return false;
+  }
+
+  mBricks.resize(size_t(header.numBricks));
+  std::vector<BoundingBox> boxes(mBricks.size());
+  for(size_t i=0;i<mBricks.size();++i)
+  {
+    BrickFileEntry entry;
+    memcpy(&entry,data+sizeof(BrickFileHeader)+i*sizeof(BrickFileEntry),sizeof(BrickFileEntry));
+
+    //the brick has to lie inside the file, the meshes are validated when they are loaded
+    bool valid = entry.offset % BrickAlignment == 0 && entry.offset <= size &&
+                 entry.size <= size-entry.offset && entry.numTriangles > 0;
+    for(unsigned int d=0;valid && d<3;++d)
+      valid = entry.min[d] <= entry.max[d];
+    if(!valid)
+    {
+      std::cerr<<"Error: Corrupt brick table in "<<filePath<<std::endl;
+      this->close();
+      return false;
+    }
+
+    mBricks[i].bbox         = BoundingBox(Vec3d(entry.min[0],entry.min[1],entry.min[2]),
+                                          Vec3d(entry.max[0],entry.max[1],entry.max[2]));
+    mBricks[i].offset       = size_t(entry.offset);
+    mBricks[i].size         = size_t(entry.size);
+    mBricks[i].numTriangles = size_t(entry.numTriangles);
+    mNumTriangles += mBricks[i].numTriangles;
+    boxes[i] = mBricks[i].bbox;
+  }
+
+  mBrickTree.build(boxes);
+  mCache.resize(mBricks.size());
+  return true;
+}
+
+void BrickedTriangleMesh::setMemoryLimit(size_t bytes)
+{
+  std::vector<std::shared_ptr<const BVHIndexedTriangleMesh>> released;
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  mMemoryLimit = bytes;
+  this->evictBricks(released);
+}
+
+size_t BrickedTriangleMesh::residentMemory() const
+{
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  return mResidentMemory;
+}
+
+size_t BrickedTriangleMesh::residentBricks() const
+{
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  return mLeastRecentlyUsed.size();
+}
+
+size_t BrickedTriangleMesh::brickLoads() const
+{
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  return mBrickLoads;
+}
+
+void BrickedTriangleMesh::evictBricks(std::vector<std::shared_ptr<const BVHIndexedTriangleMesh>> &released) const
+{
+  while(mMemoryLimit != 0 && mResidentMemory > mMemoryLimit && mLeastRecentlyUsed.size() > 1)
+  {
+    CacheEntry &entry = mCache[mLeastRecentlyUsed.back()];
+    mLeastRecentlyUsed.pop_back();
+    mResidentMemory -= entry.memory;
+    entry.memory = 0;
+    released.push_back(entry.mesh);
+    entry.mesh.reset();
+  }
+}
+
+std::shared_ptr<const BVHIndexedTriangleMesh> BrickedTriangleMesh::acquireBrick(size_t index) const
+{
+  {
+    std::unique_lock<std::mutex> lock(mCacheMutex);
+    CacheEntry &entry = mCache[index];
+
+    //a brick is only loaded once, other threads wait for it
+    while(entry.loading)
+      mBrickLoaded.wait(lock);
+    if(entry.mesh)
+    {
+      mLeastRecentlyUsed.splice(mLeastRecentlyUsed.begin(),mLeastRecentlyUsed,entry.lruPosition);
+      return entry.mesh;
+    }
+    if(entry.failed)
+      return std::shared_ptr<const BVHIndexedTriangleMesh>();
+    entry.loading = true;
+  }
+
+  //load without holding the lock, so that other threads keep rendering
+  const Brick &brick = mBricks[index];
+  std::shared_ptr<BVHIndexedTriangleMesh> mesh = std::make_shared<BVHIndexedTriangleMesh>();
+  MeshFile file;
+  bool loaded = file.open(mFile.data()+brick.offset,brick.size) && mesh->loadFromMeshFile(file);
+  if(loaded)
+  {
+    mesh->initialize();
+    loaded = mesh->triangleIndices().size()/3 == brick.numTriangles;
+  }
+
+  std::vector<std::shared_ptr<const BVHIndexedTriangleMesh>> released;
+  std::lock_guard<std::mutex> lock(mCacheMutex);
+  CacheEntry &entry = mCache[index];
+  entry.loading = false;
+  mBrickLoaded.notify_all();
+  if(!loaded)
+  {
+    std::cerr<<"Error: Could not load brick "<<index<<std::endl;
+    entry.failed = true;
+    return std::shared_ptr<const BVHIndexedTriangleMesh>();
+  }
+
+  ++mBrickLoads;
+  entry.mesh = mesh;
+  entry.memory = mesh->memoryUsage();
+  mLeastRecentlyUsed.push_front(index);
+  entry.lruPosition = mLeastRecentlyUsed.begin();
+  mResidentMemory += entry.memory;
+  this->evictBricks(released);
+  return entry.mesh;
+}
+
+void BrickedTriangleMesh::collectBricks(const Ray &ray, double maxLambda,
+                                        std::vector<std::pair<double,size_t>> &hits) const
+{
+  hits.clear();
+  if(mBricks.empty())
+    return;
+
+  const std::vector<Vec2i> &ranges = mBrickTree.intersectLeafRanges(ray,maxLambda,1);
+  for(size_t i=0;i<ranges.size();++i)
+  {
+    const size_t index = size_t(mBrickTree.leafOrder()[ranges[i][0]]);
+    const double lambda = mBricks[index].bbox.entryDistance(ray);
+    if(lambda <= maxLambda)
+      hits.push_back(std::make_pair(lambda,index));
+  }
+  std::sort(hits.begin(),hits.end());
+}
+
+bool BrickedTriangleMesh::closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const
+{
+#if defined(_OPENMP)
+  std::vector<std::pair<double,size_t>> &hits = mTempHits[omp_get_thread_num()];
+#else
+  std::vector<std::pair<double,size_t>> &hits = mTempHits[0];
+#endif
+  this->collectBricks(ray,maxLambda,hits);
+
+  //front to back, bricks entered behind the closest hit cannot contain a closer one
+  double closestLambda = maxLambda;
+  RayIntersection closest;
+  bool found = false;
+  for(size_t i=0;i<hits.size() && hits[i].first <= closestLambda;++i)
+  {
+    std::shared_ptr<const BVHIndexedTriangleMesh> brick = this->acquireBrick(hits[i].second);
+    RayIntersection hit;
+    if(brick && brick->closestIntersectionModel(ray,closestLambda,hit))
+    {
+      closest = hit;
+      closestLambda = hit.lambda();
+      found = true;
+    }
+  }
+
+  if(!found)
+    return false;
+  intersection = RayIntersection(ray,shared_from_this(),closest.lambda(),closest.normal(),closest.uvw());
+  return true;
+}
+
+bool BrickedTriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda) const
+{
+#if defined(_OPENMP)
+  std::vector<std::pair<double,size_t>> &hits = mTempHits[omp_get_thread_num()];
+#else
+  std::vector<std::pair<double,size_t>> &hits = mTempHits[0];
+#endif
+  this->collectBricks(ray,maxLambda,hits);
+
+  for(size_t i=0;i<hits.size();++i)
+  {
+    std::shared_ptr<const BVHIndexedTriangleMesh> brick = this->acquireBrick(hits[i].second);
+    if(brick && brick->anyIntersectionModel(ray,maxLambda))
+      return true;
+  }
+  return false;
+}
+
+BoundingBox BrickedTriangleMesh::computeBoundingBox() const
+{
+  BoundingBox bbox;
+  for(size_t i=0;i<mBricks.size();++i)
+    bbox.merge(mBricks[i].bbox);
+  return bbox;
+}
+
+} //namespace rt
@@ -0,0 +1,118 @@
+#ifndef BRICKEDTRIANGLEMESH_HPP_INCLUDE_ONCE
+#define BRICKEDTRIANGLEMESH_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Renderable.hpp"
+#include "BVTree.hpp"
+#include "MappedFile.hpp"
+#include "BVHIndexedTriangleMesh.hpp"
+
+namespace rt
+{
+
+/// Out-of-core triangle mesh for meshes which do not fit into memory.
+/// writeBricks() partitions a mesh spatially into bricks and stores every
+/// brick as a MeshFile together with its hierarchy in one brick file.
+/// open() only maps that file and builds a top-level hierarchy over the
+/// brick bounding boxes. Bricks are paged in from the mapping when a ray
+/// first reaches them and kept in an LRU cache, the least recently used
+/// bricks are released whenever the cache exceeds its memory limit.
+/// Rays visit the bricks front to back and stop at the first brick behind
+/// the closest hit, so hidden bricks are usually never loaded.
+class BrickedTriangleMesh : public Renderable
+{
+public:
+  static const size_t DefaultTrianglesPerBrick = 65536;
+
+  RAYTRACER_EXPORTS BrickedTriangleMesh();
+
+  /// Splits the mesh at the median of the triangle centers along the longest
+  /// axis until no part has more than trianglesPerBrick triangles, builds a
+  /// hierarchy for every part and writes them into a brick file.
+  RAYTRACER_EXPORTS static bool writeBricks(const IndexedTriangleMesh &mesh, const std::string &filePath,
+                                            size_t trianglesPerBrick=DefaultTrianglesPerBrick);
+
+  /// Maps a file written by writeBricks(), no brick is loaded yet.
+  RAYTRACER_EXPORTS bool open(const std::string &filePath);
+  RAYTRACER_EXPORTS void close();
+
+  /// Maximum number of bytes of the bricks held by the cache, 0 means no
+  /// limit. At least one brick is always kept, and an evicted brick which is
+  /// still used by a ray is released when the ray is done with it.
+  RAYTRACER_EXPORTS void setMemoryLimit(size_t bytes);
+  RAYTRACER_EXPORTS size_t memoryLimit() const { return mMemoryLimit; }
+
+  /// Number of bytes of the bricks currently held by the cache.
+  RAYTRACER_EXPORTS size_t residentMemory() const;
+  /// Number of bricks currently held by the cache.
+  RAYTRACER_EXPORTS size_t residentBricks() const;
+  /// Number of bricks loaded from the file so far, including reloads of evicted bricks.
+  RAYTRACER_EXPORTS size_t brickLoads() const;
+
+  RAYTRACER_EXPORTS size_t numBricks() const { return mBricks.size(); }
+  RAYTRACER_EXPORTS size_t numTriangles() const { return mNumTriangles; }
+
+  RAYTRACER_EXPORTS bool
+    closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const override;
+
+  RAYTRACER_EXPORTS bool anyIntersectionModel(const Ray &ray, double maxLambda) const override;
+
+protected:
+  RAYTRACER_EXPORTS BoundingBox computeBoundingBox() const override;
+
+private:
+  struct Brick
+  {
+    BoundingBox bbox;
+    size_t      offset;        //!< position of the brick's MeshFile in the mapped file
+    size_t      size;
+    size_t      numTriangles;
+  };
+
+  struct CacheEntry
+  {
+    CacheEntry() : memory(0), loading(false), failed(false) {}
+    std::shared_ptr<const BVHIndexedTriangleMesh> mesh;  //!< null if not resident
+    std::list<size_t>::iterator                   lruPosition;
+    size_t                                        memory;
+    bool                                          loading; //!< another thread is loading the brick
+    bool                                          failed;  //!< not retried after a load error
+  };
+
+  // Returns the brick, loading it from the file if it is not resident.
+  std::shared_ptr<const BVHIndexedTriangleMesh> acquireBrick(size_t index) const;
+
+  // Releases least recently used bricks until the limit is met, the lock has to be held.
+  // The bricks are handed to released, so they can be freed after unlocking.
+  void evictBricks(std::vector<std::shared_ptr<const BVHIndexedTriangleMesh>> &released) const;
+
+  // Fills hits with the bricks whose boxes the ray enters before maxLambda,
+  // sorted by entry distance.
+  void collectBricks(const Ray &ray, double maxLambda, std::vector<std::pair<double,size_t>> &hits) const;
+
+  MappedFile         mFile;
+  std::vector<Brick> mBricks;
+  BVTree             mBrickTree;   //!< over the brick boxes, always resident
+  size_t             mNumTriangles;
+  size_t             mMemoryLimit;
+
+  mutable std::mutex              mCacheMutex;
+  mutable std::condition_variable mBrickLoaded;
+  mutable std::vector<CacheEntry> mCache;
+  mutable std::list<size_t>       mLeastRecentlyUsed;  //!< resident bricks, most recently used first
+  mutable size_t                  mResidentMemory;
+  mutable size_t                  mBrickLoads;
+
+  mutable std::vector<std::vector<std::pair<double,size_t>>> mTempHits;  //!< per thread
+};
+
+} //namespace rt
+
+#endif //BRICKEDTRIANGLEMESH_HPP_INCLUDE_ONCE
@@ -7,6 +7,28 @@
 
 namespace rt {
 
+/// Sub-rectangle of a frame of frameWidth x frameHeight pixels, x and y are
+/// the first column and row in the pixel coordinates of Camera::ray(). A
+/// window of zero size (the default) stands for the whole frame.
+struct CropWindow
+{
+  CropWindow() : frameWidth(0), frameHeight(0), x(0), y(0), width(0), height(0) {}
+  CropWindow(size_t frameWidth, size_t frameHeight, size_t x, size_t y, size_t width, size_t height) :
+    frameWidth(frameWidth), frameHeight(frameHeight), x(x), y(y), width(width), height(height) {}
+
+  bool empty() const { return width == 0 || height == 0; }
+
+  /// True if the window is not empty and lies inside the frame.
+  bool valid() const { return !empty() && x+width <= frameWidth && y+height <= frameHeight; }
+
+  size_t frameWidth;
+  size_t frameHeight;
+  size_t x;
+  size_t y;
+  size_t width;
+  size_t height;
+};
+
 /// Abstract base class for camera.
 class Camera
 {
@@ -10,8 +10,7 @@ CheckerMaterial::CheckerMaterial(std::shared_ptr<Material> material1,
   Material(), mMaterial1(material1), mMaterial2(material2), mTiles(tiles)
 {}
 
-Vec4d CheckerMaterial::shade(const RayIntersection& intersection, 
-           const Light& light) const
+const Material& CheckerMaterial::select(const RayIntersection& intersection) const
 {
   const Vec3d &uvw = intersection.uvw();
 
@@ -23,9 +22,20 @@ Vec4d CheckerMaterial::shade(const RayIntersection& intersection,
     ^ (uvw[1] < double(0));
 
   if(left ^ lower)
-    return mMaterial1->shade(intersection, light);
+    return *mMaterial1;
   else
-    return mMaterial2->shade(intersection, light);
+    return *mMaterial2;
+}
+
+Vec4d CheckerMaterial::shade(const RayIntersection& intersection, 
+           const Light& light) const
+{
+  return this->select(intersection).shade(intersection, light);
+}
+
+Vec3d CheckerMaterial::albedo(const RayIntersection& intersection) const
+{
+  return this->select(intersection).albedo(intersection);
 }
 
 } //namespace rt
\ No newline at end of file
@@ -21,7 +21,12 @@ public:
   RAYTRACER_EXPORTS Vec4d shade(const RayIntersection& intersection, 
     const Light& light) const override;
 
+  RAYTRACER_EXPORTS Vec3d albedo(const RayIntersection& intersection) const override;
+
 private:
+  /// Returns the material of the tile containing the intersection point.
+  const Material& select(const RayIntersection& intersection) const;
+
   std::shared_ptr<Material> mMaterial1;
   std::shared_ptr<Material> mMaterial2;
   Vec2d mTiles; ///< number of tiles per uv in [0,1]x[0,1]
@@ -0,0 +1,183 @@
+#include "CompactVertexArray.hpp"
+#include "BoundingBox.hpp"
+#include "HalfFloat.hpp"
+
+namespace rt
+{
+
+CompactVertexArray::CompactVertexArray() : mSize(0), mQuantized(false), mTextureComponents(0)
+{
+}
+
+void CompactVertexArray::clear()
+{
+  mSize = 0;
+  std::vector<Vec3f>().swap(mFloatPositions);
+  std::vector<vl::usvec3>().swap(mQuantizedPositions);
+  std::vector<vl::svec2>().swap(mNormals);
+  std::vector<unsigned short>().swap(mTextureCoordinates);
+  mTextureComponents = 0;
+}
+
+void CompactVertexArray::permute(const std::vector<int> &newToOld)
+{
+  if (mQuantized)
+  {
+    std::vector<vl::usvec3> positions(newToOld.size());
+    for (size_t i=0;i<newToOld.size();++i)
+      positions[i] = mQuantizedPositions[newToOld[i]];
+    mQuantizedPositions.swap(positions);
+  }
+  else
+  {
+    std::vector<Vec3f> positions(newToOld.size());
+    for (size_t i=0;i<newToOld.size();++i)
+      positions[i] = mFloatPositions[newToOld[i]];
+    mFloatPositions.swap(positions);
+  }
+
+  if (!mNormals.empty())
+  {
+    std::vector<vl::svec2> normals(newToOld.size());
+    for (size_t i=0;i<newToOld.size();++i)
+      normals[i] = mNormals[newToOld[i]];
+    mNormals.swap(normals);
+  }
+
+  if (!mTextureCoordinates.empty())
+  {
+    std::vector<unsigned short> textureCoordinates(mTextureComponents*newToOld.size());
+    for (size_t i=0;i<newToOld.size();++i)
+      for (size_t c=0;c<mTextureComponents;++c)
+        textureCoordinates[mTextureComponents*i+c] = mTextureCoordinates[mTextureComponents*newToOld[i]+c];
+    mTextureCoordinates.swap(textureCoordinates);
+  }
+  mSize = newToOld.size();
+}
+
+void CompactVertexArray::encode(const std::vector<Vec3d> &positions,
+                                const std::vector<Vec3d> &normals,
+                                const std::vector<Vec3d> &textureCoordinates,
+                                bool quantizePositions)
+{
+  this->clear();
+  mSize = positions.size();
+  mQuantized = quantizePositions;
+
+  //positions
+  if (mQuantized)
+  {
+    //16 bit fixed point positions relative to the bounding box
+    BoundingBox bbox;
+    for (size_t i=0;i<mSize;++i)
+      bbox.expandByPoint(positions[i]);
+
+    mOffset = bbox.min();
+    for (int d=0;d<3;++d)
+      mScale[d] = mSize ? (bbox.max()[d]-bbox.min()[d])/65535.0 : 0.0;
+
+    mQuantizedPositions.resize(mSize);
+    for (size_t i=0;i<mSize;++i)
+      for (int d=0;d<3;++d)
+        mQuantizedPositions[i][d] = mScale[d] > 0 ?
+          (unsigned short)(Math::clamp((positions[i][d]-mOffset[d])/mScale[d],0.0,65535.0)+0.5) : 0;
+  }
+  else
+  {
+    mFloatPositions.resize(mSize);
+    for (size_t i=0;i<mSize;++i)
+      mFloatPositions[i] = Vec3f(float(positions[i][0]),float(positions[i][1]),float(positions[i][2]));
+  }
+
+  //normals, projected onto the octahedron and unfolded into the unit square
+  mNormals.resize(normals.size());
+  for (size_t i=0;i<normals.size();++i)
+    mNormals[i] = encodeNormal(normals[i]);
+
+  //texture coordinates, the w component is dropped if it is zero everywhere
+  if (!textureCoordinates.empty())
+  {
+    mTextureComponents = 2;
+    for (size_t i=0;i<textureCoordinates.size();++i)
+      if (textureCoordinates[i][2] != 0)
+      {
+        mTextureComponents = 3;
+        break;
+      }
+
+    mTextureCoordinates.resize(mTextureComponents*textureCoordinates.size());
+    for (size_t i=0;i<textureCoordinates.size();++i)
+      for (size_t c=0;c<mTextureComponents;++c)
+        mTextureCoordinates[mTextureComponents*i+c] = HalfFloat::fromFloat(float(textureCoordinates[i][int(c)]));
+  }
+}
+
+void CompactVertexArray::decode(std::vector<Vec3d> &positions,
+                                std::vector<Vec3d> &normals,
+                                std::vector<Vec3d> &textureCoordinates) const
+{
+  positions.resize(mSize);
+  for (size_t i=0;i<mSize;++i)
+    positions[i] = this->position(i);
+
+  normals.resize(mNormals.size());
+  for (size_t i=0;i<mNormals.size();++i)
+    normals[i] = this->normal(i);
+
+  textureCoordinates.resize(mTextureComponents ? mTextureCoordinates.size()/mTextureComponents : 0);
+  for (size_t i=0;i<textureCoordinates.size();++i)
+    textureCoordinates[i] = this->textureCoordinate(i);
+}
+
+size_t CompactVertexArray::memoryUsage() const
+{
+  return mFloatPositions.size()*sizeof(Vec3f) +
+         mQuantizedPositions.size()*sizeof(vl::usvec3) +
+         mNormals.size()*sizeof(vl::svec2) +
+         mTextureCoordinates.size()*sizeof(unsigned short);
+}
+
+Vec3d CompactVertexArray::normal(size_t i) const
+{
+  return decodeNormal(mNormals[i][0],mNormals[i][1]);
+}
+
+vl::svec2 CompactVertexArray::encodeNormal(const Vec3d &n)
+{
+  const double l1 = std::abs(n[0])+std::abs(n[1])+std::abs(n[2]);
+  double x = l1 > 0 ? n[0]/l1 : 0.0;
+  double y = l1 > 0 ? n[1]/l1 : 0.0;
+  if (n[2] < 0)
+  {
+    const double ox = (1-std::abs(y)) * (x >= 0 ? 1.0 : -1.0);
+    const double oy = (1-std::abs(x)) * (y >= 0 ? 1.0 : -1.0);
+    x = ox;
+    y = oy;
+  }
+  return vl::svec2((short)std::floor(Math::clamp(x,-1.0,1.0)*32767.0+0.5),
+                   (short)std::floor(Math::clamp(y,-1.0,1.0)*32767.0+0.5));
+}
+
+Vec3d CompactVertexArray::decodeNormal(short qx, short qy)
+{
+  double x = qx/32767.0;
+  double y = qy/32767.0;
+  const double z = 1-std::abs(x)-std::abs(y);
+  if (z < 0)
+  {
+    const double ox = (1-std::abs(y)) * (x >= 0 ? 1.0 : -1.0);
+    const double oy = (1-std::abs(x)) * (y >= 0 ? 1.0 : -1.0);
+    x = ox;
+    y = oy;
+  }
+  return Vec3d(x,y,z).normalize();
+}
+
+Vec3d CompactVertexArray::textureCoordinate(size_t i) const
+{
+  const unsigned short *t = &mTextureCoordinates[mTextureComponents*i];
+  return Vec3d(HalfFloat::toFloat(t[0]),HalfFloat::toFloat(t[1]),
+               mTextureComponents > 2 ? HalfFloat::toFloat(t[2]) : 0.0);
+}
+
+} //namespace rt
@@ -0,0 +1,81 @@
+#ifndef COMPACTVERTEXARRAY_HPP_INCLUDE_ONCE
+#define COMPACTVERTEXARRAY_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <vector>
+#include "Math.hpp"
+
+namespace rt
+{
+
+/// Memory-saving storage for vertex attributes.
+/// Positions are stored as floats or as 16 bit integers relative to the
+/// bounding box of all positions, normals are octahedral-encoded in two
+/// 16 bit integers and texture coordinates are stored as half floats.
+/// A vertex occupies 14 bytes when quantized instead of 72 bytes for
+/// three Vec3d attributes.
+class CompactVertexArray
+{
+public:
+  RAYTRACER_EXPORTS CompactVertexArray();
+
+  /// Encodes the given attributes. Normals and texture coordinates may be
+  /// empty, otherwise they must have as many entries as positions.
+  RAYTRACER_EXPORTS void encode(const std::vector<Vec3d> &positions,
+                                const std::vector<Vec3d> &normals,
+                                const std::vector<Vec3d> &textureCoordinates,
+                                bool quantizePositions);
+
+  /// Decodes all attributes back to full precision.
+  RAYTRACER_EXPORTS void decode(std::vector<Vec3d> &positions,
+                                std::vector<Vec3d> &normals,
+                                std::vector<Vec3d> &textureCoordinates) const;
+
+  RAYTRACER_EXPORTS void clear();
+
+  /// Reorders the vertices, vertex i afterwards holds the former vertex newToOld[i].
+  RAYTRACER_EXPORTS void permute(const std::vector<int> &newToOld);
+
+  RAYTRACER_EXPORTS size_t size() const { return mSize; }
+  RAYTRACER_EXPORTS bool hasNormals() const { return !mNormals.empty(); }
+  RAYTRACER_EXPORTS bool hasTextureCoordinates() const { return !mTextureCoordinates.empty(); }
+
+  /// Number of bytes occupied by the encoded attributes.
+  RAYTRACER_EXPORTS size_t memoryUsage() const;
+
+  RAYTRACER_EXPORTS Vec3d position(size_t i) const
+  {
+    if (mQuantized)
+    {
+      const vl::usvec3 &q = mQuantizedPositions[i];
+      return Vec3d(mOffset[0] + mScale[0]*q[0],
+                   mOffset[1] + mScale[1]*q[1],
+                   mOffset[2] + mScale[2]*q[2]);
+    }
+    const Vec3f &p = mFloatPositions[i];
+    return Vec3d(p[0],p[1],p[2]);
+  }
+
+  RAYTRACER_EXPORTS Vec3d normal(size_t i) const;
+  RAYTRACER_EXPORTS Vec3d textureCoordinate(size_t i) const;
+
+  /// Octahedral encoding of a normal in two 16 bit integers and its inverse.
+  RAYTRACER_EXPORTS static vl::svec2 encodeNormal(const Vec3d &n);
+  RAYTRACER_EXPORTS static Vec3d decodeNormal(short x, short y);
+
+private:
+  size_t mSize;                                //!< number of vertices
+  bool   mQuantized;                           //!< positions are 16 bit quantized
+  Vec3d  mOffset;                              //!< minimum corner of quantized positions
+  Vec3d  mScale;                               //!< extent per quantization step
+  std::vector<Vec3f>          mFloatPositions;
+  std::vector<vl::usvec3>     mQuantizedPositions;
+  std::vector<vl::svec2>      mNormals;            //!< octahedral encoding
+  std::vector<unsigned short> mTextureCoordinates; //!< half floats, mTextureComponents per vertex
+  size_t mTextureComponents;                   //!< 2 if all w coordinates vanish, otherwise 3
+};
+
+} //namespace rt
+
+#endif //COMPACTVERTEXARRAY_HPP_INCLUDE_ONCE
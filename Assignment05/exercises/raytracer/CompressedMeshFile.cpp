@@ -0,0 +1,418 @@
+#include "CompressedMeshFile.hpp"
+#include "BoundingBox.hpp"
+#include "CompactVertexArray.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace rt
+{
+
+static const char     CompressedMeshMagic[8]  = {'C','G','C','M','E','S','H',0};
+static const uint32_t CompressedMeshByteOrder = 0x01020304u;
+static const uint32_t CompressedMeshVersion   = 1;
+static const uint32_t HasNormals              = 1;
+static const uint32_t HasTextureCoordinates   = 2;
+static const int      MaxVertexComponents     = 8;
+
+struct CompressedMeshHeader
+{
+  char     magic[8];
+  uint32_t byteOrder;
+  uint32_t version;
+  uint64_t numVertices;
+  uint64_t numTriangles;
+  uint32_t numChunks;
+  uint32_t flags;
+  double   positionOffset[3];  // minimum corner and extent per quantization step
+  double   positionScale[3];
+  double   textureOffset[3];
+  double   textureScale[3];
+};
+
+struct CompressedMeshChunk
+{
+  uint64_t offset;             // from the start of the file
+  uint64_t size;
+  uint32_t firstTriangle;
+  uint32_t numTriangles;
+  uint32_t firstVertex;        // vertices used first by the triangles of this chunk
+  uint32_t numVertices;
+};
+
+static inline void writeVarint(std::vector<unsigned char> &out, uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back((unsigned char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((unsigned char)value);
+}
+
+static inline bool readVarint(const unsigned char *&p, const unsigned char *end, uint32_t &value)
+{
+  //single byte values are by far the most frequent
+  if (p < end && *p < 0x80)
+  {
+    value = *p++;
+    return true;
+  }
+  uint32_t v = 0;
+  for (int shift=0;shift<35 && p<end;shift+=7)
+  {
+    const unsigned char b = *p++;
+    v |= uint32_t(b & 0x7f) << shift;
+    if (!(b & 0x80))
+    {
+      value = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Maps differences 0,-1,1,-2,... to 0,1,2,3,...
+static inline uint32_t zigzag(int32_t v)
+{
+  return (uint32_t(v) << 1) ^ uint32_t(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+  return int32_t(v >> 1) ^ -int32_t(v & 1);
+}
+
+static void quantizationRange(const std::vector<Vec3d> &values, double offset[3], double scale[3])
+{
+  BoundingBox bbox;
+  for (size_t i=0;i<values.size();++i)
+    bbox.expandByPoint(values[i]);
+  for (int d=0;d<3;++d)
+  {
+    offset[d] = values.empty() ? 0.0 : bbox.min()[d];
+    scale[d] = values.empty() ? 0.0 : (bbox.max()[d]-bbox.min()[d])/65535.0;
+  }
+}
+
+static inline int32_t quantize(double value, double offset, double scale)
+{
+  return scale > 0 ? int32_t(Math::clamp((value-offset)/scale,0.0,65535.0)+0.5) : 0;
+}
+
+static void encodeChunk(const CompressedMeshChunk &chunk, const CompressedMeshHeader &header,
+                        const std::vector<int> &indices, const std::vector<int> &oldToNew,
+                        const std::vector<int> &newToOld, const std::vector<Vec3d> &positions,
+                        const std::vector<Vec3d> &normals, const std::vector<Vec3d> &textureCoordinates,
+                        std::vector<unsigned char> &out)
+{
+  out.reserve(3*chunk.numTriangles + 8*chunk.numVertices);
+
+  //vertices are numbered by first use, so a vertex is either the next one or an earlier one
+  uint32_t next = chunk.firstVertex;
+  for (size_t i=3*size_t(chunk.firstTriangle);i<3*size_t(chunk.firstTriangle+chunk.numTriangles);++i)
+  {
+    const uint32_t v = uint32_t(oldToNew[indices[i]]);
+    if (v == next)
+    {
+      writeVarint(out,0);
+      ++next;
+    }
+    else
+      writeVarint(out,next-v);
+  }
+
+  int32_t previous[MaxVertexComponents] = {0};
+  for (uint32_t v=chunk.firstVertex;v<chunk.firstVertex+chunk.numVertices;++v)
+  {
+    const int old = newToOld[v];
+    int32_t q[MaxVertexComponents];
+    int n = 0;
+    for (int d=0;d<3;++d)
+      q[n++] = quantize(positions[old][d],header.positionOffset[d],header.positionScale[d]);
+    if (header.flags & HasNormals)
+    {
+      const vl::svec2 e = CompactVertexArray::encodeNormal(normals[old]);
+      q[n++] = e[0];
+      q[n++] = e[1];
+    }
+    if (header.flags & HasTextureCoordinates)
+      for (int d=0;d<3;++d)
+        q[n++] = quantize(textureCoordinates[old][d],header.textureOffset[d],header.textureScale[d]);
+
+    for (int k=0;k<n;++k)
+    {
+      writeVarint(out,zigzag(q[k]-previous[k]));
+      previous[k] = q[k];
+    }
+  }
+}
+
+// Decodes a chunk into the preallocated arrays, returns false for corrupt data
+static bool decodeChunk(const unsigned char *p, const unsigned char *end,
+                        const CompressedMeshChunk &chunk, const CompressedMeshHeader &header,
+                        Vec3d *positions, Vec3d *normals, Vec3d *textureCoordinates, int *indices)
+{
+  const uint32_t last = chunk.firstVertex+chunk.numVertices;
+  uint32_t next = chunk.firstVertex;
+  for (size_t i=0;i<3*size_t(chunk.numTriangles);++i)
+  {
+    uint32_t code;
+    if (!readVarint(p,end,code))
+      return false;
+    if (code == 0)
+    {
+      if (next >= last)
+        return false;
+      indices[i] = int(next++);
+    }
+    else
+    {
+      if (code > next)
+        return false;
+      indices[i] = int(next-code);
+    }
+  }
+  //the chunk without triangles holds the unused vertices
+  if (chunk.numTriangles > 0 && next != last)
+    return false;
+
+  const bool hasNormals = (header.flags & HasNormals) != 0;
+  const bool hasTextureCoordinates = (header.flags & HasTextureCoordinates) != 0;
+  const int n = 3 + (hasNormals ? 2 : 0) + (hasTextureCoordinates ? 3 : 0);
+  int32_t q[MaxVertexComponents] = {0};
+  for (uint32_t v=chunk.firstVertex;v<last;++v)
+  {
+    for (int k=0;k<n;++k)
+    {
+      uint32_t code;
+      if (!readVarint(p,end,code))
+        return false;
+      q[k] = int32_t(uint32_t(q[k]) + uint32_t(unzigzag(code)));
+    }
+
+    positions[v] = Vec3d(header.positionOffset[0]+header.positionScale[0]*q[0],
+                         header.positionOffset[1]+header.positionScale[1]*q[1],
+                         header.positionOffset[2]+header.positionScale[2]*q[2]);
+    int k = 3;
+    if (hasNormals)
+    {
+      normals[v] = CompactVertexArray::decodeNormal(short(q[k]),short(q[k+1]));
+      k += 2;
+    }
+    if (hasTextureCoordinates)
+      textureCoordinates[v] = Vec3d(header.textureOffset[0]+header.textureScale[0]*q[k+0],
+                                    header.textureOffset[1]+header.textureScale[1]*q[k+1],
+                                    header.textureOffset[2]+header.textureScale[2]*q[k+2]);
+  }
+  return p == end;
+}
+
+bool CompressedMeshFile::write(const std::string &filePath,
+                               const std::vector<Vec3d> &positions,
+                               const std::vector<Vec3d> &normals,
+                               const std::vector<Vec3d> &textureCoordinates,
+                               const std::vector<int> &indices)
+{
+  const size_t numVertices = positions.size();
+  const size_t numTriangles = indices.size()/3;
+  if ((!normals.empty() && normals.size() != numVertices) ||
+      (!textureCoordinates.empty() && textureCoordinates.size() != numVertices))
+  {
+    std::cerr<<"Error: Vertex attributes differ in size"<<std::endl;
+    return false;
+  }
+  if (indices.size()%3 != 0 || numVertices > size_t(INT_MAX) || numTriangles > size_t(INT_MAX))
+  {
+    std::cerr<<"Error: Invalid triangle indices"<<std::endl;
+    return false;
+  }
+  for (size_t i=0;i<indices.size();++i)
+  {
+    if (indices[i] < 0 || size_t(indices[i]) >= numVertices)
+    {
+      std::cerr<<"Error: Invalid triangle indices"<<std::endl;
+      return false;
+    }
+  }
+
+  //number the vertices in order of first use, chunk by chunk
+  std::vector<int> oldToNew(numVertices,-1);
+  std::vector<int> newToOld;
+  newToOld.reserve(numVertices);
+  std::vector<CompressedMeshChunk> chunks;
+  for (size_t first=0;first<numTriangles;first+=ChunkTriangles)
+  {
+    CompressedMeshChunk chunk;
+    chunk.firstTriangle = uint32_t(first);
+    chunk.numTriangles = uint32_t(std::min<size_t>(ChunkTriangles,numTriangles-first));
+    chunk.firstVertex = uint32_t(newToOld.size());
+    for (size_t i=3*first;i<3*(first+chunk.numTriangles);++i)
+    {
+      if (oldToNew[indices[i]] < 0)
+      {
+        oldToNew[indices[i]] = int(newToOld.size());
+        newToOld.push_back(indices[i]);
+      }
+    }
+    chunk.numVertices = uint32_t(newToOld.size()-chunk.firstVertex);
+    chunks.push_back(chunk);
+  }
+  if (newToOld.size() < numVertices)
+  {
+    CompressedMeshChunk chunk;
+    chunk.firstTriangle = uint32_t(numTriangles);
+    chunk.numTriangles = 0;
+    chunk.firstVertex = uint32_t(newToOld.size());
+    for (size_t i=0;i<numVertices;++i)
+    {
+      if (oldToNew[i] < 0)
+      {
+        oldToNew[i] = int(newToOld.size());
+        newToOld.push_back(int(i));
+      }
+    }
+    chunk.numVertices = uint32_t(newToOld.size()-chunk.firstVertex);
+    chunks.push_back(chunk);
+  }
+
+  CompressedMeshHeader header;
+  memcpy(header.magic,CompressedMeshMagic,sizeof(CompressedMeshMagic));
+  header.byteOrder    = CompressedMeshByteOrder;
+  header.version      = CompressedMeshVersion;
+  header.numVertices  = numVertices;
+  header.numTriangles = numTriangles;
+  header.numChunks    = uint32_t(chunks.size());
+  header.flags        = (normals.empty() ? 0 : HasNormals) | (textureCoordinates.empty() ? 0 : HasTextureCoordinates);
+  quantizationRange(positions,header.positionOffset,header.positionScale);
+  quantizationRange(textureCoordinates,header.textureOffset,header.textureScale);
+
+  std::vector<std::vector<unsigned char> > data(chunks.size());
+  const int numChunks = int(chunks.size());
+#pragma omp parallel for schedule(dynamic,1)
+  for (int c=0;c<numChunks;++c)
+    encodeChunk(chunks[c],header,indices,oldToNew,newToOld,positions,normals,textureCoordinates,data[c]);
+
+  uint64_t offset = sizeof(CompressedMeshHeader) + chunks.size()*sizeof(CompressedMeshChunk);
+  for (size_t c=0;c<chunks.size();++c)
+  {
+    chunks[c].offset = offset;
+    chunks[c].size = data[c].size();
+    offset += data[c].size();
+  }
+
+  std::ofstream out(filePath, std::ios::binary | std::ios::out);
+  if (!out.is_open())
+  {
+    std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  out.write((const char*)&header,sizeof(header));
+  if (!chunks.empty())
+    out.write((const char*)&chunks[0],std::streamsize(chunks.size()*sizeof(CompressedMeshChunk)));
+  for (size_t c=0;c<data.size();++c)
+    if (!data[c].empty())
+      out.write((const char*)&data[c][0],std::streamsize(data[c].size()));
+  if (!out)
+  {
+    std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool CompressedMeshFile::read(const std::string &filePath,
+                              std::vector<Vec3d> &positions,
+                              std::vector<Vec3d> &normals,
+                              std::vector<Vec3d> &textureCoordinates,
+                              std::vector<int> &indices)
+{
+  MappedFile file;
+  if (!file.open(filePath))
+  {
+    std::cerr<<"Error: Could not open file "<<filePath<<std::endl;
+    return false;
+  }
+  const char *data = file.data();
+  const uint64_t size = file.size();
+
+  CompressedMeshHeader header;
+  if (size >= sizeof(header))
+    memcpy(&header,data,sizeof(header));
+  if (size < sizeof(header) || memcmp(header.magic,CompressedMeshMagic,sizeof(CompressedMeshMagic)) != 0 ||
+      header.byteOrder != CompressedMeshByteOrder)
+  {
+    std::cerr<<"Error: "<<filePath<<" is not a compressed mesh file"<<std::endl;
+    return false;
+  }
+  if (header.version != CompressedMeshVersion)
+  {
+    std::cerr<<"Error: Unsupported compressed mesh file version "<<header.version<<std::endl;
+    return false;
+  }
+
+  //the chunks have to cover all triangles and vertices in order, the table is
+  //only allocated once it is known to fit into the file
+  bool valid = header.numVertices <= uint64_t(INT_MAX) && header.numTriangles <= uint64_t(INT_MAX) &&
+               header.numChunks <= (size-sizeof(header))/sizeof(CompressedMeshChunk);
+  std::vector<CompressedMeshChunk> chunks(valid ? header.numChunks : 0);
+  uint64_t numTriangles = 0, numVertices = 0;
+  for (size_t c=0;c<chunks.size() && valid;++c)
+  {
+    memcpy(&chunks[c],data+sizeof(header)+c*sizeof(CompressedMeshChunk),sizeof(CompressedMeshChunk));
+    //every corner and vertex component takes at least one byte, which bounds the arrays
+    valid = chunks[c].offset <= size && chunks[c].size <= size-chunks[c].offset &&
+            3*uint64_t(chunks[c].numTriangles)+3*uint64_t(chunks[c].numVertices) <= chunks[c].size &&
+            chunks[c].firstTriangle == numTriangles && chunks[c].firstVertex == numVertices;
+    numTriangles += chunks[c].numTriangles;
+    numVertices += chunks[c].numVertices;
+  }
+  if (!valid || numTriangles != header.numTriangles || numVertices != header.numVertices)
+  {
+    std::cerr<<"Error: Corrupt chunk table in "<<filePath<<std::endl;
+    return false;
+  }
+
+  positions.resize(size_t(header.numVertices));
+  normals.resize((header.flags & HasNormals) ? size_t(header.numVertices) : 0);
+  textureCoordinates.resize((header.flags & HasTextureCoordinates) ? size_t(header.numVertices) : 0);
+  indices.resize(3*size_t(header.numTriangles));
+
+  Vec3d *positionData = positions.empty() ? 0 : &positions[0];
+  Vec3d *normalData = normals.empty() ? 0 : &normals[0];
+  Vec3d *textureData = textureCoordinates.empty() ? 0 : &textureCoordinates[0];
+  int *indexData = indices.empty() ? 0 : &indices[0];
+
+  bool success = true;
+  const int numChunks = int(chunks.size());
+#pragma omp parallel for schedule(dynamic,1)
+  for (int c=0;c<numChunks;++c)
+  {
+    const CompressedMeshChunk &chunk = chunks[c];
+    const unsigned char *begin = (const unsigned char*)data+chunk.offset;
+    if (!decodeChunk(begin,begin+chunk.size,chunk,header,positionData,normalData,textureData,
+                     indexData ? indexData+3*size_t(chunk.firstTriangle) : 0))
+    {
+#pragma omp critical
+      success = false;
+    }
+  }
+
+  if (!success)
+  {
+    std::cerr<<"Error: Corrupt data in "<<filePath<<std::endl;
+    positions.clear();
+    normals.clear();
+    textureCoordinates.clear();
+    indices.clear();
+    return false;
+  }
+  return true;
+}
+
+} //namespace rt
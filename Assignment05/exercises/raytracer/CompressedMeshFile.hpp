@@ -0,0 +1,46 @@
+#ifndef COMPRESSEDMESHFILE_HPP_INCLUDE_ONCE
+#define COMPRESSEDMESHFILE_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <string>
+#include <vector>
+#include "Math.hpp"
+
+namespace rt
+{
+
+/// Compact mesh format for storage and transfer. Positions and texture
+/// coordinates are quantized to 16 bits relative to their bounding box and
+/// normals are octahedral-encoded as in CompactVertexArray.
+/// Vertices are numbered in order of their first use by the triangles, so
+/// every triangle corner is coded either as the next new vertex or as its
+/// distance to it, and the attributes as differences to the previous
+/// vertex, both as variable-length integers.
+/// The triangles are split into chunks of ChunkTriangles together with the
+/// vertices they use first, chunks are encoded and decoded independently
+/// in parallel.
+class CompressedMeshFile
+{
+public:
+  static const unsigned int ChunkTriangles = 8192;
+
+  /// Writes the mesh, normals and texture coordinates may be empty.
+  /// Vertices which are not used by any triangle are stored at the end.
+  RAYTRACER_EXPORTS static bool write(const std::string &filePath,
+                                      const std::vector<Vec3d> &positions,
+                                      const std::vector<Vec3d> &normals,
+                                      const std::vector<Vec3d> &textureCoordinates,
+                                      const std::vector<int> &indices);
+
+  /// Reads a mesh written by write(), the vertices are in order of first use.
+  RAYTRACER_EXPORTS static bool read(const std::string &filePath,
+                                     std::vector<Vec3d> &positions,
+                                     std::vector<Vec3d> &normals,
+                                     std::vector<Vec3d> &textureCoordinates,
+                                     std::vector<int> &indices);
+};
+
+} //namespace rt
+
+#endif //COMPRESSEDMESHFILE_HPP_INCLUDE_ONCE
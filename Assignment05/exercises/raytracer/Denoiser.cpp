@@ -0,0 +1,170 @@
+#include "Denoiser.hpp"
+#include "Image.hpp"
+#include "FeatureBuffer.hpp"
+
+#include <iostream>
+#include <vector>
+
+namespace rt {
+
+// Albedo components below this value are not divided out
+static const float MinAlbedo=0.01f;
+
+Denoiser::Denoiser() : mIterations(5), mColorSigma(4), mNormalExponent(64), mDepthSigma(1), mAlbedoSigma(0.1)
+{
+}
+
+bool Denoiser::apply(const Image &source, const FeatureBuffer &features, Image &target) const
+{
+  const int width=int(source.width()), height=int(source.height());
+  if (features.width() != source.width() || features.height() != source.height())
+  {
+    std::cerr<<"Error: Feature buffer ("<<features.width()<<","<<features.height()
+             <<") does not match the image ("<<width<<","<<height<<")"<<std::endl;
+    return false;
+  }
+
+  //lighting without the surface color, its luminance and the expected depth change per pixel
+  const size_t numPixels=size_t(width)*height;
+  std::vector<Vec3f> lighting(numPixels), filtered(numPixels);
+  std::vector<float> luminance(numPixels), variance(numPixels), filteredVariance(numPixels);
+  std::vector<float> depthGradient(numPixels,0.f);
+#pragma omp parallel for schedule(dynamic,16)
+  for (int y=0;y<height;++y)
+    for (int x=0;x<width;++x)
+    {
+      const size_t k=size_t(y)*width+x;
+      const Vec4d &color=source.pixel(x,y);
+      const Vec3f &albedo=features.albedo(x,y);
+      for (int c=0;c<3;++c)
+        lighting[k][c]=float(albedo[c] > MinAlbedo ? color[c]/albedo[c] : color[c]);
+      luminance[k]=0.2126f*lighting[k][0]+0.7152f*lighting[k][1]+0.0722f*lighting[k][2];
+
+      if (features.isBackground(x,y))
+        continue;
+      const float z=features.depth(x,y);
+      float gradient=0.f;
+      if (x > 0 && !features.isBackground(x-1,y))
+        gradient=std::max(gradient,std::abs(z-features.depth(x-1,y)));
+      if (x+1 < width && !features.isBackground(x+1,y))
+        gradient=std::max(gradient,std::abs(z-features.depth(x+1,y)));
+      if (y > 0 && !features.isBackground(x,y-1))
+        gradient=std::max(gradient,std::abs(z-features.depth(x,y-1)));
+      if (y+1 < height && !features.isBackground(x,y+1))
+        gradient=std::max(gradient,std::abs(z-features.depth(x,y+1)));
+      depthGradient[k]=gradient;
+    }
+
+  //the noise level is estimated by the luminance variance of the 3x3 neighborhood
+#pragma omp parallel for schedule(dynamic,16)
+  for (int y=0;y<height;++y)
+    for (int x=0;x<width;++x)
+    {
+      const bool background=features.isBackground(x,y);
+      float sum=0.f, sumSquares=0.f;
+      int count=0;
+      for (int qy=std::max(0,y-1);qy<=std::min(height-1,y+1);++qy)
+        for (int qx=std::max(0,x-1);qx<=std::min(width-1,x+1);++qx)
+        {
+          if (features.isBackground(qx,qy) != background)
+            continue;
+          const float l=luminance[size_t(qy)*width+qx];
+          sum+=l;
+          sumSquares+=l*l;
+          ++count;
+        }
+      const float mean=sum/float(count);
+      variance[size_t(y)*width+x]=std::max(0.f,sumSquares/float(count)-mean*mean);
+    }
+
+  static const float kernel[5]={1.f/16,1.f/4,3.f/8,1.f/4,1.f/16};
+  const float albedoScale=float(1.0/(mAlbedoSigma*mAlbedoSigma));
+  const float normalExponent=float(mNormalExponent);
+  for (size_t iteration=0;iteration<mIterations;++iteration)
+  {
+    const int step=1<<iteration;
+
+#pragma omp parallel for schedule(dynamic,16)
+    for (int y=0;y<height;++y)
+      for (int x=0;x<width;++x)
+      {
+        const size_t k=size_t(y)*width+x;
+        const bool background=features.isBackground(x,y);
+        const Vec3f &n0=features.normal(x,y);
+        const Vec3f &a0=features.albedo(x,y);
+        const float z0=features.depth(x,y);
+        const float l0=luminance[k];
+        const float colorScale=1.f/(float(mColorSigma)*std::sqrt(variance[k])+1e-6f);
+        const float depthScale=float(mDepthSigma)*depthGradient[k]*float(step);
+
+        Vec3f sum(0,0,0);
+        float weightSum=0.f, varianceSum=0.f;
+        for (int dy=-2;dy<=2;++dy)
+        {
+          const int qy=y+dy*step;
+          if (qy < 0 || qy >= height)
+            continue;
+          for (int dx=-2;dx<=2;++dx)
+          {
+            const int qx=x+dx*step;
+            if (qx < 0 || qx >= width || features.isBackground(qx,qy) != background)
+              continue;
+
+            const size_t q=size_t(qy)*width+qx;
+            float exponent=-std::abs(luminance[q]-l0)*colorScale;
+            if (!background)
+            {
+              //all feature weights are combined into a single exponential
+              const float cosine=dot(features.normal(qx,qy),n0);
+              if (cosine <= 0.f)
+                continue;
+              const Vec3f da=features.albedo(qx,qy)-a0;
+              const float distance=float(std::sqrt(double(dx*dx+dy*dy)));
+              exponent+=normalExponent*std::log(std::min(1.f,cosine))-dot(da,da)*albedoScale
+                       -std::abs(features.depth(qx,qy)-z0)/(depthScale*distance+1e-6f);
+            }
+            const float weight=kernel[dx+2]*kernel[dy+2]*std::exp(exponent);
+            sum+=lighting[q]*weight;
+            varianceSum+=weight*weight*variance[q];
+            weightSum+=weight;
+          }
+        }
+        //only a pixel without a valid normal has no weight, not even for itself
+        if (weightSum > 0.f)
+        {
+          filtered[k]=sum/weightSum;
+          filteredVariance[k]=varianceSum/(weightSum*weightSum);
+        }
+        else
+        {
+          filtered[k]=lighting[k];
+          filteredVariance[k]=variance[k];
+        }
+      }
+
+    //the luminance and variance of the filtered lighting guide the next pass
+    lighting.swap(filtered);
+    variance.swap(filteredVariance);
+#pragma omp parallel for schedule(static)
+    for (int k=0;k<(int)numPixels;++k)
+      luminance[k]=0.2126f*lighting[k][0]+0.7152f*lighting[k][1]+0.0722f*lighting[k][2];
+  }
+
+  if (&target != &source && (target.width() != source.width() || target.height() != source.height()))
+    target.init(source.width(),source.height());
+
+#pragma omp parallel for schedule(dynamic,16)
+  for (int y=0;y<height;++y)
+    for (int x=0;x<width;++x)
+    {
+      const Vec3f &l=lighting[size_t(y)*width+x];
+      const Vec3f &albedo=features.albedo(x,y);
+      Vec4d color(0,0,0,source.pixel(x,y)[3]);
+      for (int c=0;c<3;++c)
+        color[c]=albedo[c] > MinAlbedo ? double(l[c])*albedo[c] : double(l[c]);
+      target.setPixel(color,x,y);
+    }
+  return true;
+}
+
+} //namespace rt
@@ -0,0 +1,59 @@
+#ifndef DENOISER_HPP_INCLUDE_ONCE
+#define DENOISER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include "Math.hpp"
+
+namespace rt {
+
+class Image;
+class FeatureBuffer;
+
+/// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010). A 5x5
+/// B3-spline kernel is applied several times with doubling gaps between its
+/// taps, so the filter reaches far with few taps. Every tap is weighted by
+/// the similarity of luminance, normal, depth and albedo to the center pixel,
+/// which keeps geometric and texture edges sharp. As in SVGF (Schied et al.
+/// 2017), luminance differences are relative to the standard deviation of
+/// the noise, estimated from the neighborhood and filtered along, so no
+/// tuning for the image brightness is needed. The colors are divided by the
+/// albedo before filtering and multiplied afterwards, so only the lighting
+/// is smoothed. Background pixels are only mixed with background.
+class Denoiser
+{
+public:
+  RAYTRACER_EXPORTS Denoiser();
+
+  /// Number of filter passes, the kernel covers 4*2^iterations pixels.
+  RAYTRACER_EXPORTS void setIterations(size_t iterations) { mIterations=iterations; }
+  RAYTRACER_EXPORTS size_t iterations() const { return mIterations; }
+
+  /// Luminance differences are compared to sigma times the standard
+  /// deviation of the noise. Larger values smooth more, the default is 4.
+  RAYTRACER_EXPORTS void setColorSigma(double sigma) { mColorSigma=sigma; }
+
+  /// Normals are weighted by max(0,dot)^exponent.
+  RAYTRACER_EXPORTS void setNormalExponent(double exponent) { mNormalExponent=exponent; }
+
+  /// Depth differences are compared to sigma times the change expected from
+  /// the local depth gradient.
+  RAYTRACER_EXPORTS void setDepthSigma(double sigma) { mDepthSigma=sigma; }
+
+  RAYTRACER_EXPORTS void setAlbedoSigma(double sigma) { mAlbedoSigma=sigma; }
+
+  /// Writes the filtered source to target, which is resized if needed and may
+  /// be the source itself. The features must have the size of the source.
+  RAYTRACER_EXPORTS bool apply(const Image &source, const FeatureBuffer &features, Image &target) const;
+
+private:
+  size_t mIterations;
+  double mColorSigma;
+  double mNormalExponent;
+  double mDepthSigma;
+  double mAlbedoSigma;
+};
+
+} //namespace rt
+
+#endif //DENOISER_HPP_INCLUDE_ONCE
@@ -0,0 +1,24 @@
+#include "FeatureBuffer.hpp"
+
+namespace rt {
+
+FeatureBuffer::FeatureBuffer() : mWidth(0), mHeight(0)
+{
+}
+
+FeatureBuffer::FeatureBuffer(size_t width, size_t height)
+{
+  assert(width>0 && height>0);
+  this->init(width,height);
+}
+
+void FeatureBuffer::init(size_t width, size_t height)
+{
+  mWidth=width;
+  mHeight=height;
+  mNormals.assign(width*height,Vec3f(0,0,0));
+  mDepths.assign(width*height,std::numeric_limits<float>::infinity());
+  mAlbedos.assign(width*height,Vec3f(0,0,0));
+}
+
+} //namespace rt
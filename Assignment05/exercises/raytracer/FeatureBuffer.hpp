@@ -0,0 +1,64 @@
+#ifndef FEATUREBUFFER_HPP_INCLUDE_ONCE
+#define FEATUREBUFFER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include "Math.hpp"
+
+#include <limits>
+#include <vector>
+
+namespace rt {
+
+/// Per-pixel surface properties of the first hit of the camera rays: the
+/// normal, the distance along the ray and the albedo of the material (see
+/// Material::albedo()). Pixels without a hit have depth infinity and zero
+/// normal and albedo. Filled by Raytracer::renderToImage() and used by the
+/// Denoiser to find edges.
+class FeatureBuffer
+{
+public:
+  RAYTRACER_EXPORTS FeatureBuffer();
+  RAYTRACER_EXPORTS FeatureBuffer(size_t width, size_t height);
+
+  /// Valid values for width and height must be > 0. All pixels are set to background.
+  RAYTRACER_EXPORTS void init(size_t width, size_t height);
+
+  size_t width () const { return mWidth; }
+  size_t height() const { return mHeight; }
+
+  RAYTRACER_EXPORTS void setFeatures(size_t i, size_t j, const Vec3d &normal, double depth, const Vec3d &albedo)
+  {
+    const size_t k = i+mWidth*j;
+    mNormals[k] = Vec3f(float(normal[0]),float(normal[1]),float(normal[2]));
+    mDepths [k] = float(depth);
+    mAlbedos[k] = Vec3f(float(albedo[0]),float(albedo[1]),float(albedo[2]));
+  }
+
+  RAYTRACER_EXPORTS void setBackground(size_t i, size_t j)
+  {
+    const size_t k = i+mWidth*j;
+    mNormals[k] = Vec3f(0,0,0);
+    mDepths [k] = std::numeric_limits<float>::infinity();
+    mAlbedos[k] = Vec3f(0,0,0);
+  }
+
+  RAYTRACER_EXPORTS const Vec3f& normal(size_t i, size_t j) const { return mNormals[i+mWidth*j]; }
+  RAYTRACER_EXPORTS float        depth (size_t i, size_t j) const { return mDepths [i+mWidth*j]; }
+  RAYTRACER_EXPORTS const Vec3f& albedo(size_t i, size_t j) const { return mAlbedos[i+mWidth*j]; }
+  RAYTRACER_EXPORTS bool isBackground(size_t i, size_t j) const
+  {
+    return mDepths[i+mWidth*j] == std::numeric_limits<float>::infinity();
+  }
+
+private:
+  size_t mWidth;
+  size_t mHeight;
+  std::vector<Vec3f> mNormals;
+  std::vector<float> mDepths;
+  std::vector<Vec3f> mAlbedos;
+};
+
+} //namespace rt
+
+#endif //FEATUREBUFFER_HPP_INCLUDE_ONCE
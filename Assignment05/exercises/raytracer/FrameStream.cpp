@@ -0,0 +1,244 @@
+#include "FrameStream.hpp"
+#include "Image.hpp"
+#include "Framebuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <io.h>
+#endif
+
+namespace rt {
+
+FrameStream::FrameStream() : mFile(0), mOwnsFile(false), mFailed(false), mFormat(Y4M),
+                             mWidth(0), mHeight(0), mNumFrames(0), mHasPending(false), mStopWriter(false)
+{
+}
+
+FrameStream::~FrameStream()
+{
+  this->close();
+}
+
+bool FrameStream::open(const std::string &path, size_t width, size_t height, Format format,
+                       unsigned int rateNumerator, unsigned int rateDenominator)
+{
+  this->close();
+
+  if (path == "-")
+  {
+    mFile = stdout;
+    mOwnsFile = false;
+  }
+  else
+  {
+    mFile = std::fopen(path.c_str(),"wb");
+    mOwnsFile = true;
+  }
+  if (!mFile)
+  {
+    std::cerr<<"Error: Could not open frame stream "<<path<<std::endl;
+    return false;
+  }
+  return this->start(width,height,format,rateNumerator,rateDenominator);
+}
+
+bool FrameStream::open(int fileDescriptor, size_t width, size_t height, Format format,
+                       unsigned int rateNumerator, unsigned int rateDenominator)
+{
+  this->close();
+
+#if defined(_WIN32)
+  mFile = _fdopen(fileDescriptor,"wb");
+#else
+  mFile = fdopen(fileDescriptor,"wb");
+#endif
+  mOwnsFile = true;
+  if (!mFile)
+  {
+    std::cerr<<"Error: Could not open frame stream on file descriptor "<<fileDescriptor<<std::endl;
+    return false;
+  }
+  return this->start(width,height,format,rateNumerator,rateDenominator);
+}
+
+bool FrameStream::start(size_t width, size_t height, Format format,
+                        unsigned int rateNumerator, unsigned int rateDenominator)
+{
+  mFailed = false;
+  mFormat = format;
+  mWidth = width;
+  mHeight = height;
+  mNumFrames = 0;
+
+  if (width<1 || height<1)
+  {
+    std::cerr<<"Error: Invalid frame size ("<<width<<","<<height<<")"<<std::endl;
+    this->close();
+    return false;
+  }
+
+  if (format == Y4M)
+  {
+    std::ostringstream header;
+    header<<"YUV4MPEG2 W"<<width<<" H"<<height<<" F"<<rateNumerator<<":"<<rateDenominator
+          <<" Ip A1:1 C444 XCOLORRANGE=LIMITED\n";
+    const std::string s = header.str();
+    mFailed = std::fwrite(s.data(),1,s.size(),mFile) != s.size();
+  }
+  if (mFailed)
+    return false;
+
+  mHasPending = false;
+  mStopWriter = false;
+  mWriter = std::thread(&FrameStream::writePending,this);
+  return true;
+}
+
+void FrameStream::writePending()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;)
+  {
+    mCondition.wait(lock,[this]{ return mHasPending || mStopWriter; });
+    if (!mHasPending)
+      return;
+
+    //the frame is not touched by writeFrame() until mHasPending is reset
+    lock.unlock();
+    const bool written = std::fwrite(&mPending[0],1,mPending.size(),mFile) == mPending.size();
+    lock.lock();
+    if (!written)
+    {
+      std::cerr<<"Error: Writing frame "<<mNumFrames-1<<" failed"<<std::endl;
+      mFailed = true;
+    }
+    mHasPending = false;
+    mCondition.notify_all();
+  }
+}
+
+bool FrameStream::close()
+{
+  if (!mFile)
+    return false;
+
+  //the writer finishes the pending frame before it stops
+  if (mWriter.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStopWriter = true;
+    }
+    mCondition.notify_all();
+    mWriter.join();
+  }
+
+  bool good = !mFailed && std::fflush(mFile) == 0;
+  if (mOwnsFile)
+    good = std::fclose(mFile) == 0 && good;
+  mFile = 0;
+  std::vector<char>().swap(mBuffer);
+  return good;
+}
+
+static inline unsigned char quantize(double value)
+{
+  return (unsigned char)(Math::clamp(value)*255);
+}
+
+static inline unsigned char limitedRange(double value)
+{
+  return (unsigned char)(std::max(0.0,std::min(255.0,value+0.5)));
+}
+
+template<class T_Frame>
+bool FrameStream::write(const T_Frame &frame)
+{
+  if (!mFile)
+    return false;
+
+  if (frame.width() != mWidth || frame.height() != mHeight)
+  {
+    std::cerr<<"Error: Frame size ("<<frame.width()<<","<<frame.height()<<") does not match the stream ("
+             <<mWidth<<","<<mHeight<<")"<<std::endl;
+    return false;
+  }
+
+  const size_t numPixels = mWidth*mHeight;
+  static const char frameHeader[] = "FRAME\n";
+  const size_t headerSize = mFormat == Y4M ? sizeof(frameHeader)-1 : 0;
+  size_t pixelSize = 3;
+  if (mFormat == RGBA8)
+    pixelSize = 4;
+  else if (mFormat == RGBAFloat)
+    pixelSize = 4*sizeof(float);
+  mBuffer.resize(headerSize+pixelSize*numPixels);
+  std::memcpy(&mBuffer[0],frameHeader,headerSize);
+
+  //the top row, the last image row, is stored first
+  unsigned char *out = (unsigned char*)&mBuffer[headerSize];
+#pragma omp parallel for schedule(dynamic,16)
+  for (int row=0;row<(int)mHeight;++row)
+  {
+    const size_t y = mHeight-1-row;
+    for (size_t x=0;x<mWidth;++x)
+    {
+      const Vec4d rgba = frame.pixel(x,y);
+      const size_t i = size_t(row)*mWidth+x;
+      switch (mFormat)
+      {
+        case Y4M:
+        {
+          //BT.601 in limited range, stored as separate Y, Cb and Cr planes
+          const double r = Math::clamp(rgba[0]), g = Math::clamp(rgba[1]), b = Math::clamp(rgba[2]);
+          out[i]             = limitedRange( 16.0 +  65.481*r + 128.553*g +  24.966*b);
+          out[i+numPixels]   = limitedRange(128.0 -  37.797*r -  74.203*g + 112.000*b);
+          out[i+2*numPixels] = limitedRange(128.0 + 112.000*r -  93.786*g -  18.214*b);
+          break;
+        }
+        case RGB8:
+          for (int c=0;c<3;++c)
+            out[3*i+c] = quantize(rgba[c]);
+          break;
+        case RGBA8:
+          for (int c=0;c<4;++c)
+            out[4*i+c] = quantize(rgba[c]);
+          break;
+        case RGBAFloat:
+        {
+          const float value[4] = {float(rgba[0]),float(rgba[1]),float(rgba[2]),float(rgba[3])};
+          std::memcpy(out+sizeof(value)*i,value,sizeof(value));
+          break;
+        }
+      }
+    }
+  }
+
+  //wait until the writer has taken the previous frame, then swap buffers
+  std::unique_lock<std::mutex> lock(mMutex);
+  mCondition.wait(lock,[this]{ return !mHasPending; });
+  if (mFailed)
+    return false;
+  mPending.swap(mBuffer);
+  mHasPending = true;
+  ++mNumFrames;
+  lock.unlock();
+  mCondition.notify_all();
+  return true;
+}
+
+bool FrameStream::writeFrame(const Image &image)
+{
+  return this->write(image);
+}
+
+bool FrameStream::writeFrame(const Framebuffer &framebuffer)
+{
+  return this->write(framebuffer);
+}
+
+} //namespace rt
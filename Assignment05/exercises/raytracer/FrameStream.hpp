@@ -0,0 +1,96 @@
+#ifndef FRAMESTREAM_HPP_INCLUDE_ONCE
+#define FRAMESTREAM_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rt {
+
+class Image;
+class Framebuffer;
+
+/// Writes a sequence of frames into a single stream, e.g. a pipe to a video
+/// encoder, instead of one image file per frame. Every frame is converted on
+/// all threads and handed to a writer thread, so the next frame can be
+/// rendered while a slow reader still consumes the previous one. At most one
+/// frame waits for the writer, writeFrame() blocks until it has been taken.
+///
+/// Y4M streams are self-describing (4:4:4 YCbCr, BT.601 limited range) and
+/// can be read directly, e.g. by "ffmpeg -i frames.y4m". The raw formats
+/// carry no header, the reader has to be told the size and pixel format, e.g.
+/// "ffmpeg -f rawvideo -pix_fmt rgba -s 800x600 -r 25 -i pipe". Like the
+/// Netpbm files written by Image, frames start with the top row (the last
+/// image row).
+class FrameStream
+{
+public:
+  enum Format
+  {
+    Y4M,
+    RGB8,       ///< raw, pix_fmt rgb24
+    RGBA8,      ///< raw, pix_fmt rgba
+    RGBAFloat   ///< raw 32 bit floats in native byte order, unclamped
+  };
+
+  RAYTRACER_EXPORTS FrameStream();
+  RAYTRACER_EXPORTS ~FrameStream();
+
+  /// Opens a file or named pipe for writing, "-" denotes standard output.
+  /// The frame rate is only stored in Y4M headers.
+  RAYTRACER_EXPORTS bool open(const std::string &path, size_t width, size_t height, Format format,
+                              unsigned int rateNumerator=25, unsigned int rateDenominator=1);
+
+  /// Writes to an already opened file descriptor, which is closed by close().
+  RAYTRACER_EXPORTS bool open(int fileDescriptor, size_t width, size_t height, Format format,
+                              unsigned int rateNumerator=25, unsigned int rateDenominator=1);
+
+  /// Appends a frame, which must have the size of the stream. A failed write
+  /// is reported by the next call or by close().
+  RAYTRACER_EXPORTS bool writeFrame(const Image &image);
+  RAYTRACER_EXPORTS bool writeFrame(const Framebuffer &framebuffer);
+
+  /// Waits for the writer, flushes and closes the stream. Returns false if
+  /// any write failed.
+  RAYTRACER_EXPORTS bool close();
+
+  RAYTRACER_EXPORTS bool isOpen() const { return mFile != 0; }
+  RAYTRACER_EXPORTS size_t numFrames() const { return mNumFrames; }
+
+private:
+  bool start(size_t width, size_t height, Format format,
+             unsigned int rateNumerator, unsigned int rateDenominator);
+
+  template<class T_Frame>
+  bool write(const T_Frame &frame);
+
+  // Body of the writer thread, writes pending frames until the stream is closed.
+  void writePending();
+
+  FrameStream(const FrameStream&);
+  FrameStream& operator=(const FrameStream&);
+
+  std::FILE        *mFile;
+  bool              mOwnsFile;   //!< false for standard output
+  bool              mFailed;     //!< guarded by mMutex while the writer runs
+  Format            mFormat;
+  size_t            mWidth;
+  size_t            mHeight;
+  size_t            mNumFrames;
+  std::vector<char> mBuffer;     //!< converted frame, including the Y4M frame header
+  std::vector<char> mPending;    //!< frame handed to the writer thread
+  bool              mHasPending;
+  bool              mStopWriter;
+  std::thread             mWriter;
+  std::mutex              mMutex;
+  std::condition_variable mCondition;  //!< signals new pending frames and finished writes
+};
+
+} //namespace rt
+
+#endif //FRAMESTREAM_HPP_INCLUDE_ONCE
@@ -0,0 +1,103 @@
+#include "Framebuffer.hpp"
+#include "Image.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace rt {
+
+static_assert((Framebuffer::TileSize*Framebuffer::TileSize*4*sizeof(unsigned short))%Framebuffer::CacheLineSize == 0,
+              "A tile has to cover whole cache lines");
+
+Framebuffer::Framebuffer() : mWidth(0), mHeight(0), mTilesX(0), mTilesY(0), mFormat(Float4)
+{
+}
+
+Framebuffer::Framebuffer(size_t width, size_t height, Format format)
+{
+  assert(width>0 && height>0);
+  this->init(width,height,format);
+}
+
+Framebuffer::Framebuffer(const Framebuffer &other) : mWidth(0), mHeight(0), mTilesX(0), mTilesY(0), mFormat(Float4)
+{
+  *this = other;
+}
+
+Framebuffer& Framebuffer::operator=(const Framebuffer &other)
+{
+  if (this == &other)
+    return *this;
+  this->init(other.mWidth,other.mHeight,other.mFormat);
+  if (this->memoryUsage() > 0)
+    memcpy(this->data(),other.data(),this->memoryUsage());
+  return *this;
+}
+
+void Framebuffer::init(size_t width, size_t height, Format format)
+{
+  mWidth=width;
+  mHeight=height;
+  mTilesX=(width+TileSize-1)/TileSize;
+  mTilesY=(height+TileSize-1)/TileSize;
+  mFormat=format;
+
+  //all bits zero is 0 in both formats
+  std::vector<unsigned char>(this->memoryUsage()+CacheLineSize-1,0).swap(mStorage);
+}
+
+void Framebuffer::fromImage(const Image &image)
+{
+  this->init(image.width(),image.height(),mFormat);
+#pragma omp parallel for schedule(dynamic,1)
+  for (int tile=0;tile<(int)this->numTiles();++tile)
+  {
+    const size_t x0=this->tileOriginX(tile), y0=this->tileOriginY(tile);
+    for (size_t y=0;y<TileSize && y0+y<mHeight;++y)
+      for (size_t x=0;x<TileSize && x0+x<mWidth;++x)
+        this->setTilePixel(image.pixel(x0+x,y0+y),tile,x,y);
+  }
+}
+
+void Framebuffer::toImage(Image &image) const
+{
+  if (image.width() != mWidth || image.height() != mHeight)
+    image.init(mWidth,mHeight);
+#pragma omp parallel for schedule(dynamic,1)
+  for (int tile=0;tile<(int)this->numTiles();++tile)
+  {
+    const size_t x0=this->tileOriginX(tile), y0=this->tileOriginY(tile);
+    for (size_t y=0;y<TileSize && y0+y<mHeight;++y)
+      for (size_t x=0;x<TileSize && x0+x<mWidth;++x)
+      {
+        Vec4d rgba=this->tilePixel(tile,x,y);
+        image.setPixel(rgba,x0+x,y0+y);
+      }
+  }
+}
+
+void Framebuffer::copyTiles(const Framebuffer &source, const std::vector<unsigned char> &tiles)
+{
+  if (source.width() != mWidth || source.height() != mHeight || source.format() != mFormat ||
+      tiles.size() != this->numTiles())
+  {
+    std::cerr<<"Error: Tiles can only be copied between framebuffers of the same size and format"<<std::endl;
+    return;
+  }
+  if (tiles.empty())
+    return;
+
+  //the pixels of a tile are contiguous
+  const size_t tileBytes = this->memoryUsage()/this->numTiles();
+  for (size_t tile=0;tile<tiles.size();++tile)
+    if (tiles[tile])
+      memcpy((unsigned char*)this->data()+tile*tileBytes,(const unsigned char*)source.data()+tile*tileBytes,tileBytes);
+}
+
+size_t Framebuffer::memoryUsage() const
+{
+  const size_t componentSize = mFormat == Half4 ? sizeof(unsigned short) : sizeof(float);
+  return 4*this->numTiles()*TileSize*TileSize*componentSize;
+}
+
+} //namespace rt
@@ -0,0 +1,137 @@
+#ifndef FRAMEBUFFER_HPP_INCLUDE_ONCE
+#define FRAMEBUFFER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include "Math.hpp"
+#include "HalfFloat.hpp"
+
+#include <vector>
+
+namespace rt {
+
+class Image;
+
+/// Compact RGBA framebuffer in square tiles of TileSize x TileSize pixels.
+/// The pixels of a tile are contiguous and start at a cache line boundary,
+/// so a thread rendering a whole tile writes to its own cache lines only
+/// (see CacheLineSize). Components are stored as floats
+/// (16 bytes per pixel) or as half floats (8 bytes per pixel) instead of the
+/// 32 bytes of an Image pixel. The tiles at the right and bottom border
+/// extend beyond the image, pixels outside of it are stored but ignored.
+class Framebuffer
+{
+public:
+  enum Format
+  {
+    Float4,
+    Half4
+  };
+
+  static const size_t TileSize = 8;
+
+  /// Alignment of the pixel data. A tile of either format is a multiple of it.
+  static const size_t CacheLineSize = 64;
+
+  RAYTRACER_EXPORTS Framebuffer();
+  RAYTRACER_EXPORTS Framebuffer(size_t width, size_t height, Format format=Float4);
+
+  /// Copies keep the pixels aligned, which a plain copy of the storage would not.
+  RAYTRACER_EXPORTS Framebuffer(const Framebuffer &other);
+  RAYTRACER_EXPORTS Framebuffer& operator=(const Framebuffer &other);
+
+  /// Valid values for width and height must be > 0. All pixels are cleared to 0.
+  RAYTRACER_EXPORTS void init(size_t width, size_t height, Format format=Float4);
+
+  size_t width ()    const { return mWidth; }
+  size_t height()    const { return mHeight; }
+  Format format()    const { return mFormat; }
+  size_t numTilesX() const { return mTilesX; }
+  size_t numTilesY() const { return mTilesY; }
+  size_t numTiles()  const { return mTilesX*mTilesY; }
+
+  /// Tile index and position of the upper left pixel of a tile.
+  size_t tileIndex(size_t tileX, size_t tileY) const { return tileX+mTilesX*tileY; }
+  size_t tileOriginX(size_t tile) const { return (tile%mTilesX)*TileSize; }
+  size_t tileOriginY(size_t tile) const { return (tile/mTilesX)*TileSize; }
+
+  /// RGBA color at position x,y inside a tile, x and y must be < TileSize.
+  RAYTRACER_EXPORTS Vec4d tilePixel(size_t tile, size_t x, size_t y) const
+  {
+    const size_t k = this->offset(tile,x,y);
+    if (mFormat == Half4)
+    {
+      const unsigned short *h = (const unsigned short*)this->data()+k;
+      return Vec4d(HalfFloat::toFloat(h[0]),HalfFloat::toFloat(h[1]),HalfFloat::toFloat(h[2]),HalfFloat::toFloat(h[3]));
+    }
+    const float *f = (const float*)this->data()+k;
+    return Vec4d(f[0],f[1],f[2],f[3]);
+  }
+
+  RAYTRACER_EXPORTS void setTilePixel(const Vec4d &rgba, size_t tile, size_t x, size_t y)
+  {
+    const size_t k = this->offset(tile,x,y);
+    if (mFormat == Half4)
+    {
+      unsigned short *h = (unsigned short*)this->data()+k;
+      for (size_t c=0;c<4;++c)
+        h[c] = HalfFloat::fromFloat(float(rgba[int(c)]));
+      return;
+    }
+    float *f = (float*)this->data()+k;
+    for (size_t c=0;c<4;++c)
+      f[c] = float(rgba[int(c)]);
+  }
+
+  /// Returns the RGBA color at image position i,j
+  RAYTRACER_EXPORTS Vec4d pixel(size_t i, size_t j) const
+  {
+    return this->tilePixel(this->tileIndex(i/TileSize,j/TileSize),i%TileSize,j%TileSize);
+  }
+
+  RAYTRACER_EXPORTS void setPixel(const Vec4d &rgba, size_t i, size_t j)
+  {
+    this->setTilePixel(rgba,this->tileIndex(i/TileSize,j/TileSize),i%TileSize,j%TileSize);
+  }
+
+  /// Conversion from and to the row-major Image, the framebuffer keeps its format.
+  RAYTRACER_EXPORTS void fromImage(const Image &image);
+  RAYTRACER_EXPORTS void toImage(Image &image) const;
+
+  /// Copies the tiles whose flag is set from a framebuffer of the same size
+  /// and format, e.g. the finished ones while the others are still rendered.
+  RAYTRACER_EXPORTS void copyTiles(const Framebuffer &source, const std::vector<unsigned char> &tiles);
+
+  /// Number of bytes occupied by the pixels.
+  RAYTRACER_EXPORTS size_t memoryUsage() const;
+
+  /// Raw pixel data of memoryUsage() bytes in tile order, four floats or
+  /// half floats per pixel depending on the format. Aligned to CacheLineSize.
+  RAYTRACER_EXPORTS const void* data() const
+  {
+    //the storage is over-allocated by CacheLineSize-1 bytes, the pixels start at the first boundary
+    const size_t address = (size_t)mStorage.data();
+    return mStorage.data() + (CacheLineSize - address%CacheLineSize)%CacheLineSize;
+  }
+  RAYTRACER_EXPORTS void* data()
+  {
+    return (void*)((const Framebuffer*)this)->data();
+  }
+
+private:
+  size_t offset(size_t tile, size_t x, size_t y) const
+  {
+    return 4*(tile*TileSize*TileSize + y*TileSize + x);
+  }
+
+  size_t mWidth;
+  size_t mHeight;
+  size_t mTilesX;
+  size_t mTilesY;
+  Format mFormat;
+  std::vector<unsigned char> mStorage;  //!< pixels at data(), four floats or half floats each
+};
+
+} //namespace rt
+
+#endif //FRAMEBUFFER_HPP_INCLUDE_ONCE
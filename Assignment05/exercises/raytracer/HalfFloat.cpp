@@ -0,0 +1,77 @@
+#include "HalfFloat.hpp"
+
+#include <cstring>
+
+namespace rt
+{
+
+unsigned short HalfFloat::fromFloat(float value)
+{
+  unsigned int bits;
+  std::memcpy(&bits,&value,sizeof(bits));
+
+  const unsigned int sign     = (bits >> 16) & 0x8000;
+  const int          exponent = int((bits >> 23) & 0xff) - 127 + 15;
+  unsigned int       mantissa = bits & 0x7fffff;
+
+  //infinity and NaN
+  if (((bits >> 23) & 0xff) == 0xff)
+    return (unsigned short)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  //overflow
+  if (exponent >= 31)
+    return (unsigned short)(sign | 0x7c00);
+  //subnormal or zero
+  if (exponent <= 0)
+  {
+    if (exponent < -10)
+      return (unsigned short)sign;
+    mantissa |= 0x800000;
+    const unsigned int shift = 14 - exponent;
+    unsigned int half = mantissa >> shift;
+    if ((mantissa >> (shift-1)) & 1)
+      ++half;
+    return (unsigned short)(sign | half);
+  }
+
+  //round to nearest, a carry correctly propagates into the exponent
+  unsigned int half = sign | (unsigned int)(exponent << 10) | (mantissa >> 13);
+  if (mantissa & 0x1000)
+    ++half;
+  return (unsigned short)half;
+}
+
+float HalfFloat::toFloat(unsigned short value)
+{
+  const unsigned int sign     = (unsigned int)(value & 0x8000) << 16;
+  int                exponent = (value >> 10) & 0x1f;
+  unsigned int       mantissa = value & 0x3ff;
+  unsigned int bits;
+
+  if (exponent == 0)
+  {
+    if (mantissa == 0)
+      bits = sign;
+    else
+    {
+      //renormalize subnormal
+      exponent = 1;
+      while (!(mantissa & 0x400))
+      {
+        mantissa <<= 1;
+        --exponent;
+      }
+      mantissa &= 0x3ff;
+      bits = sign | (unsigned int)((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+  }
+  else if (exponent == 31)
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  else
+    bits = sign | (unsigned int)((exponent + 127 - 15) << 23) | (mantissa << 13);
+
+  float result;
+  std::memcpy(&result,&bits,sizeof(result));
+  return result;
+}
+
+} //namespace rt
@@ -0,0 +1,21 @@
+#ifndef HALFFLOAT_HPP_INCLUDE_ONCE
+#define HALFFLOAT_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+namespace rt
+{
+
+/// Conversions between single and IEEE 754 half precision floats, which are
+/// stored as 16 bit integers. Rounding is to nearest, values beyond the half
+/// range become infinity and small values become subnormals or zero.
+class HalfFloat
+{
+public:
+  RAYTRACER_EXPORTS static unsigned short fromFloat(float value);
+  RAYTRACER_EXPORTS static float toFloat(unsigned short value);
+};
+
+} //namespace rt
+
+#endif //HALFFLOAT_HPP_INCLUDE_ONCE
@@ -5,6 +5,8 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <functional>
 
 namespace rt {
 
@@ -30,71 +32,226 @@ void Image::init(size_t width, size_t height)
   //std::cerr<<"Image MB: "<<megaBytes<<std::endl;
 }
 
-bool Image::saveToTGA(std::string fileName) const
+// Adds the file extension if not yet present and opens the file for writing.
+static bool openImageFile(const std::string &fileName, const std::string &suffix, std::ofstream &f)
 {
-  //add .tga file extension if not yet present
-  std::string suffix(".tga"), outName(fileName), outNameLower(fileName);
+  std::string outName(fileName), outNameLower(fileName);
 
   std::transform(outNameLower.begin(),
                  outNameLower.end(),
                  outNameLower.begin(),
                  ::tolower);
 
-  if (!std::equal(suffix.rbegin(),
+  if (outNameLower.size() < suffix.size() ||
+      !std::equal(suffix.rbegin(),
                   suffix.rend(),
                   outNameLower.rbegin()))
     outName+=suffix;
 
-  std::ofstream f(outName, std::ios::binary | std::ios::out);
+  f.open(outName, std::ios::binary | std::ios::out);
 
   if (!f.is_open())
   {
-    std::cerr<<"Image::saveToBitmap: could not open file." <<
+    std::cerr<<"Image::save: could not open file." <<
                outName <<std::endl;
     return false;
   }
+  return true;
+}
+
+// Encodes blocks of rows in parallel and writes each block with few large
+// write calls. Rows are written from the first to the last image row, or in
+// reverse order for formats storing the top row first.
+static bool writeRows(std::ofstream &f, size_t height, bool reverse,
+                      const std::function<void(size_t,std::vector<char>&)> &encodeRow)
+{
+  const size_t blockSize=64;
+  std::vector<std::vector<char> > rows(std::min(blockSize,height));
+
+  for (size_t first=0; first<height && f.good(); first+=blockSize)
+  {
+    const size_t count=std::min(blockSize,height-first);
+#pragma omp parallel for schedule(dynamic,1)
+    for (int i=0; i<(int)count; ++i)
+    {
+      rows[i].clear();
+      encodeRow(reverse ? height-1-(first+i) : first+i, rows[i]);
+    }
+    for (size_t i=0; i<count; ++i)
+      f.write(&rows[i][0], std::streamsize(rows[i].size()));
+  }
+  return f.good();
+}
+
+static inline char quantize(double value)
+{
+  return (char)(unsigned char)(Math::clamp(value)*255);
+}
+
+// Run-length encodes a row of 4 byte pixels in TGA packets, which never
+// extend over the end of a row.
+static void encodeRunLength(const char *pixels, size_t width, std::vector<char> &out)
+{
+  size_t i=0;
+  while (i<width)
+  {
+    //a run of at least two equal pixels becomes a run-length packet
+    size_t run=1;
+    while (i+run<width && run<128 && std::memcmp(pixels+4*i, pixels+4*(i+run), 4)==0)
+      ++run;
+    if (run>1)
+    {
+      out.push_back((char)(0x80 | (run-1)));
+      out.insert(out.end(), pixels+4*i, pixels+4*i+4);
+      i+=run;
+      continue;
+    }
 
+    //otherwise collect pixels until the next run starts
+    size_t raw=1;
+    while (i+raw<width && raw<128 &&
+           !(i+raw+1<width && std::memcmp(pixels+4*(i+raw), pixels+4*(i+raw+1), 4)==0))
+      ++raw;
+    out.push_back((char)(raw-1));
+    out.insert(out.end(), pixels+4*i, pixels+4*(i+raw));
+    i+=raw;
+  }
+}
+
+bool Image::saveToTGA(std::string fileName, bool runLengthEncoded) const
+{
   if (!mData.size())
   {
     std::cerr<<"Image::saveToBitmap: image data uninitialized." << std::endl;
     return false;
   }
 
-  if (mWidth<1 || mHeight<1)
+  if (mWidth<1 || mHeight<1 || mWidth>0xFFFF || mHeight>0xFFFF)
   {
-    std::cerr << "Image::saveToBitmap: image dimensions too small to write ("
+    std::cerr << "Image::saveToBitmap: image dimensions not supported by TGA ("
               << mWidth << "," << mHeight << ")" << std::endl;
     return false;
   }
 
-  //Write the header
-  f.put(0);
-  f.put(0);
-  f.put(2);                       /* uncompressed RGB */
-  f.put(0); 	f.put(0);
-  f.put(0); 	f.put(0);
-  f.put(0);
-  f.put(0); 	f.put(0);           /* X origin */
-  f.put(0); 	f.put(0);           /* y origin */
-  f.put((mWidth & 0x00FF));
-  f.put((unsigned char)((mWidth & 0xFF00) / 256));
-  f.put((unsigned char)(mHeight & 0x00FF));
-  f.put((unsigned char)((mHeight & 0xFF00) / 256));
-  f.put(32);                      /* 32 bit RGBA bitmap */
-  f.put(0);
+  std::ofstream f;
+  if (!openImageFile(fileName, ".tga", f))
+    return false;
+
+  //Write the header, 32 bit RGBA bitmap with the origin at the lower left
+  const unsigned char header[18] = {0, 0,
+                                    (unsigned char)(runLengthEncoded ? 10 : 2),
+                                    0, 0, 0, 0, 0,
+                                    0, 0, 0, 0,
+                                    (unsigned char)(mWidth & 0xFF), (unsigned char)((mWidth >> 8) & 0xFF),
+                                    (unsigned char)(mHeight & 0xFF), (unsigned char)((mHeight >> 8) & 0xFF),
+                                    32, 0};
+  f.write((const char*)header, sizeof(header));
 
   //Write the pixel data in BGRA
-  for (size_t i=0; i<mHeight*mWidth; i++)
+  const size_t width=mWidth;
+  const std::vector<Vec4d> &data=mData;
+  return writeRows(f, mHeight, false, [&](size_t y, std::vector<char> &out)
+  {
+    std::vector<char> row(4*width);
+    for (size_t x=0; x<width; ++x)
+    {
+      const Vec4d &rgba=data[x+width*y];
+      row[4*x+0]=quantize(rgba[2]);
+      row[4*x+1]=quantize(rgba[1]);
+      row[4*x+2]=quantize(rgba[0]);
+      row[4*x+3]=quantize(rgba[3]);
+    }
+    if (runLengthEncoded)
+      encodeRunLength(&row[0], width, out);
+    else
+      out.swap(row);
+  });
+}
+
+bool Image::saveToPFM(std::string fileName) const
+{
+  if (!mData.size())
+  {
+    std::cerr<<"Image::saveToPFM: image data uninitialized." << std::endl;
+    return false;
+  }
+
+  std::ofstream f;
+  if (!openImageFile(fileName, ".pfm", f))
+    return false;
+
+  //the negative scale denotes little endian floats, rows are stored bottom to top
+  f<<"PF\n"<<mWidth<<" "<<mHeight<<"\n-1.0\n";
+
+  const size_t width=mWidth;
+  const std::vector<Vec4d> &data=mData;
+  return writeRows(f, mHeight, false, [&](size_t y, std::vector<char> &out)
+  {
+    out.resize(3*sizeof(float)*width);
+    for (size_t x=0; x<width; ++x)
+    {
+      const Vec4d &rgba=data[x+width*y];
+      const float rgb[3]={float(rgba[0]), float(rgba[1]), float(rgba[2])};
+      std::memcpy(&out[sizeof(rgb)*x], rgb, sizeof(rgb));
+    }
+  });
+}
+
+bool Image::saveToPPM(std::string fileName) const
+{
+  if (!mData.size())
   {
-    f.put((unsigned char)(Math::clamp(mData[i][2])*255));
-    f.put((unsigned char)(Math::clamp(mData[i][1])*255));
-    f.put((unsigned char)(Math::clamp(mData[i][0])*255));
-    f.put((unsigned char)(Math::clamp(mData[i][3])*255));
+    std::cerr<<"Image::saveToPPM: image data uninitialized." << std::endl;
+    return false;
   }
 
-  f.close();
+  std::ofstream f;
+  if (!openImageFile(fileName, ".ppm", f))
+    return false;
 
-  return true;
+  f<<"P6\n"<<mWidth<<" "<<mHeight<<"\n255\n";
+
+  //the top row is stored first, the last image row as in the TGA files
+  const size_t width=mWidth;
+  const std::vector<Vec4d> &data=mData;
+  return writeRows(f, mHeight, true, [&](size_t y, std::vector<char> &out)
+  {
+    out.resize(3*width);
+    for (size_t x=0; x<width; ++x)
+    {
+      const Vec4d &rgba=data[x+width*y];
+      for (int c=0; c<3; ++c)
+        out[3*x+c]=quantize(rgba[c]);
+    }
+  });
+}
+
+bool Image::saveToPAM(std::string fileName) const
+{
+  if (!mData.size())
+  {
+    std::cerr<<"Image::saveToPAM: image data uninitialized." << std::endl;
+    return false;
+  }
+
+  std::ofstream f;
+  if (!openImageFile(fileName, ".pam", f))
+    return false;
+
+  f<<"P7\nWIDTH "<<mWidth<<"\nHEIGHT "<<mHeight<<"\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+
+  const size_t width=mWidth;
+  const std::vector<Vec4d> &data=mData;
+  return writeRows(f, mHeight, true, [&](size_t y, std::vector<char> &out)
+  {
+    out.resize(4*width);
+    for (size_t x=0; x<width; ++x)
+    {
+      const Vec4d &rgba=data[x+width*y];
+      for (int c=0; c<4; ++c)
+        out[4*x+c]=quantize(rgba[c]);
+    }
+  });
 }
 
 } //namespace rt
@@ -20,9 +20,18 @@ public:
   /// Valid values for width and height must be > 0.
   RAYTRACER_EXPORTS void init(size_t width, size_t height);
 
-  /// Writes an integer 4x[0,255] RGBA image in TGA format.
-  /// Pixel intensities outside valid range [0,1] are clamped.
-  RAYTRACER_EXPORTS bool saveToTGA(std::string filename)  const;
+  /// Writes an integer 4x[0,255] RGBA image in TGA format, optionally
+  /// run-length encoded. Pixel intensities outside valid range [0,1] are clamped.
+  RAYTRACER_EXPORTS bool saveToTGA(std::string filename, bool runLengthEncoded=false) const;
+
+  /// Writes the RGB components as 32 bit floats in PFM format without any
+  /// clamping, so high dynamic range images can be tone mapped later.
+  RAYTRACER_EXPORTS bool saveToPFM(std::string filename) const;
+
+  /// Write integer [0,255] RGB (PPM) or RGBA (PAM) images in the binary
+  /// Netpbm formats. Pixel intensities are clamped as for TGA.
+  RAYTRACER_EXPORTS bool saveToPPM(std::string filename) const;
+  RAYTRACER_EXPORTS bool saveToPAM(std::string filename) const;
 
   size_t width ()                       const { return mWidth; }
   size_t height()                       const { return mHeight; }
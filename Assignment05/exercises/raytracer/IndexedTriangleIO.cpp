@@ -1,8 +1,9 @@
 #include "IndexedTriangleIO.hpp"
+#include "OBJReader.hpp"
+#include "PLYReader.hpp"
 
 #include <fstream>
 #include <string>
-#include <cstring>
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4996) //Visual Studio compiler complains about unsafe C function
@@ -24,132 +25,64 @@ void IndexedTriangleIO::clear()
 
 bool IndexedTriangleIO::loadFromOBJ(const std::string &filePath)
 {
-  std::fstream in(filePath, std::ios::binary | std::ios::in);
+  OBJReader reader;
+  const bool success = reader.read(filePath);
+  reader.printDiagnostics(true);
 
-  //could not open file, reject
-  if(!in.is_open())
+  if (!success)
   {
-    std::cerr<<"Error: Could not open file "<<filePath<<std::endl;
+    //keep the current data if the file could not be opened at all
+    if (reader.fileOpened())
+      this->clear();
     return false;
   }
 
-  char line[1024];
-  rt::Vec3d v,t,n;
-  rt::Vec3i idx_v,idx_t,idx_n;
+  mVertexPositionCache.swap(reader.vertexPositions());
+  mVertexTextureCoordinateCache.swap(reader.vertexTextureCoordinates());
+  mVertexNormalCache.swap(reader.vertexNormals());
 
-  int lineIndex(0);
+  //flatten the (v,vt,vn) corners into single-indexed vertices
+  const std::vector<Vec3i> &corners = reader.faceCorners();
+  mIndices.reserve(mIndices.size()+corners.size());
+  mIndicesCache.reserve(mIndicesCache.size()+mVertexPositionCache.size());
+  for (size_t i=0;i<corners.size();++i)
+    mIndices.push_back(insertFlattenedVertexVTN(corners[i][0],corners[i][1],corners[i][2]));
 
-  UnsupportedFeatures features;
+  this->clearCaches();
+  return true;
+}
 
-  //read lines in file
-  while (!in.eof())
+bool IndexedTriangleIO::loadFromPLY(const std::string &filePath)
+{
+  PLYReader reader;
+  if (!reader.read(filePath))
   {
-    //line could not be read, this may have different reasons
-    if (!in.getline(line,1024))
-    {
-      if (in.eof())
-        break;
-      std::cerr<<"Error: Could not read file"<<std::endl;
+    //keep the current data if the file could not be opened at all
+    if (reader.fileOpened())
       this->clear();
-      return false;
-    }
-    ++lineIndex;
-
-    //comment
-    if (line[0]=='#')  continue;
-
-    //empty line
-    if (line[0]=='\n' || line[0]=='\r') continue;
-
-    //vertex position
-    if (line[0]=='v' && line[1]==' ') 
-    {
-      if (sscanf(line+2,"%lf %lf %lf\n",&v[0],&v[1],&v[2])!=3)
-      {
-        std::cerr<<"Error: Could not read 'v' line "<<lineIndex<<std::endl;
-        this->clear();
-        return false;
-      }
-      mVertexPositionCache.push_back(v);
-    }
-    //vertex texture coordinate
-    else if (line[0]=='v' && line[1]=='t')
-    {
-      if (sscanf(line+3,"%lf %lf %lf\n",&t[0],&t[1],&t[2])!=3)
-      {
-        std::cerr<<"Error: Could not read 'vt' line "<<lineIndex<<std::endl;
-        this->clear();
-        return false;
-      }
-      mVertexTextureCoordinateCache.push_back(t);
-    }
-    //vertex normal
-    else if (line[0]=='v' && line[1]=='n')
-    {
-      if (sscanf(line+3,"%lf %lf %lf\n",&n[0],&n[1],&n[2])!=3)
-      {
-        std::cerr<<"Error: Could not read 'vn' line "<<lineIndex<<std::endl;
-        this->clear();
-        return false;
-      }
-      mVertexNormalCache.push_back(n);
-    }
+    return false;
+  }
 
-    //(triangle) face
-    else if (line[0]=='f' && line[1]==' ')
-    {
-      // position index
-      if (sscanf(line+2,"%d %d %d\n",&idx_v[0],&idx_v[1],&idx_v[2])==3)
-      {
-        this->insertFlattenedTriangleV(idx_v);
-      }
-      // position and texture coordinate index
-      else if (sscanf(line+2,"%d/%d %d/%d %d/%d\n",&idx_v[0],&idx_t[0],
-        &idx_v[1],&idx_t[1],
-        &idx_v[2],&idx_t[2])==6)
-      {
-        this->insertFlattenedTriangleVT(idx_v,idx_t);
-      }
-      // position and normal index
-      else if (sscanf(line+2,"%d//%d %d//%d %d//%d\n",&idx_v[0],&idx_n[0],
-        &idx_v[1],&idx_n[1],
-        &idx_v[2],&idx_n[2])==6)
-      {
-        this->insertFlattenedTriangleVN(idx_v,idx_n);
-      }
-      // position, texture coordinate and normal index
-      else if (sscanf(line+2,"%d/%d/%d %d/%d/%d %d/%d/%d\n",&idx_v[0],&idx_t[0],&idx_n[0],
-        &idx_v[1],&idx_t[1],&idx_n[1],
-        &idx_v[2],&idx_t[2],&idx_n[2])==9)
-      {
-        this->insertFlattenedTriangleVTN(idx_v,idx_t,idx_n);
-      }
-      //quads and other n-gons are not supported
-      else
-      {
-        std::cerr<<"Error: face format invalid in line "<<lineIndex<<std::endl;
-        this->clear();
-        return false;
-      }
-    }
-    else if(line[0]=='s') //smoothing group
-      features.hasSmoothingGroup=true;
-    else if(line[0]=='g')
-      features.hasGroup=true;
-    else if(line[0]=='l')
-      features.hasLine=true;
-    else if(strstr(line,"usemtl")!=0 || strstr(line,"mtllib")!=0)
-      features.hasMaterial=true;
-    else
-    {
-      std::cerr<<"Warning: unknown data in line "<<lineIndex<<std::endl;
-    }
+  //PLY vertices already carry all attributes, no flattening is required
+  if (mVertexPosition.empty() && mIndices.empty())
+  {
+    mVertexPosition.swap(reader.vertexPositions());
+    mVertexTextureCoordinate.swap(reader.vertexTextureCoordinates());
+    mVertexNormal.swap(reader.vertexNormals());
+    mIndices.swap(reader.triangleIndices());
+    return true;
   }
 
-  if(features.hasGroup || features.hasLine || features.hasMaterial || features.hasSmoothingGroup)
-    std::cerr<<"Warning: obj file contains unsupported data."<<std::endl;
+  const int offset = int(mVertexPosition.size());
+  mVertexPosition.insert(mVertexPosition.end(),reader.vertexPositions().begin(),reader.vertexPositions().end());
+  mVertexTextureCoordinate.insert(mVertexTextureCoordinate.end(),reader.vertexTextureCoordinates().begin(),
+                                  reader.vertexTextureCoordinates().end());
+  mVertexNormal.insert(mVertexNormal.end(),reader.vertexNormals().begin(),reader.vertexNormals().end());
 
-  this->clearCaches();
+  const std::vector<int> &indices = reader.triangleIndices();
+  mIndices.reserve(mIndices.size()+indices.size());
+  for (size_t i=0;i<indices.size();++i)
+    mIndices.push_back(indices[i]+offset);
   return true;
 }
 
@@ -248,36 +181,14 @@ bool IndexedTriangleIO::saveToOBJ(const std::string &filePath,bool textureCoordi
   return true;
 }
 
-void IndexedTriangleIO::insertFlattenedTriangleV(const Vec3i &v)
-{
-  for (int i = 0; i < 3;++i)
-    mIndices.push_back(insertFlattenedVertexVTN(v[i],-1,-1));
-}
-void IndexedTriangleIO::insertFlattenedTriangleVT(const Vec3i &v, const Vec3i &t)
-{
-  for (int i = 0; i < 3;++i)
-    mIndices.push_back(insertFlattenedVertexVTN(v[i],t[i],-1));
-}
-void IndexedTriangleIO::insertFlattenedTriangleVN(const Vec3i &v, const Vec3i &n)
-{
-  for (int i = 0; i < 3;++i)
-    mIndices.push_back(insertFlattenedVertexVTN(v[i],-1,n[i]));
-}
-void IndexedTriangleIO::insertFlattenedTriangleVTN(const Vec3i &v, const Vec3i &t, const Vec3i &n)
-{
-  for (int i = 0; i < 3;++i)
-    mIndices.push_back(insertFlattenedVertexVTN(v[i],t[i],n[i]));
-}
-
 int IndexedTriangleIO::insertFlattenedVertexVTN(const int v, const int t, const  int n)
 {
-  Vec3i idx(v,t,n);
-  std::map<Vec3i,size_t>::iterator it = mIndicesCache.find(idx);
+  bool inserted;
+  const int index = mIndicesCache.insert(Vec3i(v,t,n),int(mVertexPosition.size()),inserted);
 
   //vertex does not exist
-  if(it==mIndicesCache.end())
+  if(inserted)
   {
-    it = (mIndicesCache.insert(std::make_pair(idx,mVertexPosition.size()))).first;
     mVertexPosition.push_back(mVertexPositionCache[v-1]);
 
     // copy / duplicate texcoords and normals if appropriate
@@ -286,14 +197,14 @@ int IndexedTriangleIO::insertFlattenedVertexVTN(const int v, const int t, const
     if(n >= 0)
       mVertexNormal.push_back(mVertexNormalCache[n-1]);
   }
-  return int(it->second);
+  return index;
 }
 void IndexedTriangleIO::clearCaches()
 {
   std::vector<Vec3d>().swap(mVertexPositionCache);
   std::vector<Vec3d>().swap(mVertexTextureCoordinateCache);
   std::vector<Vec3d>().swap(mVertexNormalCache);
-  std::map<Vec3i,size_t,CompareVec3i>().swap(mIndicesCache);
+  mIndicesCache.clear();
 }
 } //namespace rt
 
@@ -4,7 +4,7 @@
 #include "raytracerConfig.hpp"
 
 #include "Math.hpp"
-#include <map>
+#include "VertexIndexTable.hpp"
 #include <vector>
 
 namespace rt
@@ -15,6 +15,8 @@ class IndexedTriangleIO
 public:
   RAYTRACER_EXPORTS void clear();
   RAYTRACER_EXPORTS bool loadFromOBJ(const std::string &filePath);
+  /// Loads an ASCII or binary PLY file (see PLYReader), polygons are triangulated.
+  RAYTRACER_EXPORTS bool loadFromPLY(const std::string &filePath);
   RAYTRACER_EXPORTS bool saveToOBJ(const std::string &filePath, bool textureCoordinates=true, bool normals=true) const;
 
   RAYTRACER_EXPORTS const std::vector<Vec3d>& vertexPositions()          const {return mVertexPosition;}
@@ -27,42 +29,19 @@ public:
   RAYTRACER_EXPORTS void setVertexNormals(const std::vector<Vec3d>& v) {mVertexNormal=std::vector<Vec3d>(v);}
   RAYTRACER_EXPORTS void setTriangleIndices(const std::vector<int>& v) {mIndices=std::vector<int>(v);}
 
-private:
-
-  // Container for printing warnings on Wavefront OBJ format specs
-  // that are unsupported by this loader. 
-  struct UnsupportedFeatures
+  /// Hands the loaded arrays over to the caller without copying, afterwards this object is empty.
+  RAYTRACER_EXPORTS void releaseData(std::vector<Vec3d> &positions, std::vector<Vec3d> &textureCoordinates,
+                                     std::vector<Vec3d> &normals, std::vector<int> &indices)
   {
-    UnsupportedFeatures() : hasLine(false),
-      hasGroup(false),
-      hasSmoothingGroup(false),
-      hasMaterial(false) 
-    { }
+    positions.swap(mVertexPosition);
+    textureCoordinates.swap(mVertexTextureCoordinate);
+    normals.swap(mVertexNormal);
+    indices.swap(mIndices);
+    this->clear();
+  }
 
-    bool hasLine;
-    bool hasGroup;
-    bool hasSmoothingGroup;
-    bool hasMaterial;
-  };
-  
-  // Vertex flattening or duplication needs strict weak ordering
-  struct CompareVec3i
-  {
-    bool operator()(const Vec3i& lhs, const Vec3i& rhs) const
-    {
-      for (int i=0;i<3;++i)
-      {
-        if (lhs[i] < rhs[i]) return true;
-        if (lhs[i] > rhs[i]) return false;
-      }
-      return false;
-    }
-  };
+private:
 
-  void insertFlattenedTriangleV  (const Vec3i &v);
-  void insertFlattenedTriangleVT (const Vec3i &v,const Vec3i &t);
-  void insertFlattenedTriangleVN (const Vec3i &v,const Vec3i &n);
-  void insertFlattenedTriangleVTN(const Vec3i &v,const Vec3i &t,const Vec3i &n);
   int insertFlattenedVertexVTN(const int v, const int t, const  int n);
   void clearCaches();
 
@@ -74,7 +53,7 @@ private:
   std::vector<Vec3d>                   mVertexPositionCache;
   std::vector<Vec3d>                   mVertexTextureCoordinateCache;
   std::vector<Vec3d>                   mVertexNormalCache;
-  std::map<Vec3i,size_t,CompareVec3i> mIndicesCache;
+  VertexIndexTable                    mIndicesCache;
 };
 
 } //namespace rt
@@ -1,7 +1,10 @@
 #include "IndexedTriangleMesh.hpp"
 #include "IndexedTriangleIO.hpp"
+#include "CompressedMeshFile.hpp"
 #include "Helper.hpp"
 
+#include <fstream>
+
 namespace rt
 {
 
@@ -16,19 +19,28 @@ bool IndexedTriangleMesh::closestIntersectionModel(const Ray &ray, double maxLam
   Vec3d bary;
   double lambda;
 
-  // Loop over all stored triangles to find a possible intersection between ray 
-  // and any triangle
-  for (size_t i=0;i<mIndices.size();i+=3)
+  // Test all triangles packet-wise if the packed layout is up to date,
+  // otherwise loop over all stored triangles
+  size_t slot;
+  if (this->hasTrianglePackets())
   {
-    const int i0 = mIndices[i+0];
-    const int i1 = mIndices[i+1];
-    const int i2 = mIndices[i+2];
-	if (Helper::Helper2(ray, mVertexPosition[i0], mVertexPosition[i1], mVertexPosition[i2], bary, lambda) &&
-      lambda > 0 && lambda < closestLambda)
+    if (mTrianglePackets.closestIntersection(ray,0,mTrianglePackets.size(),closestLambda,closestbary,slot))
+      closestTri = 3*mTrianglePackets.triangle(slot);
+  }
+  else
+  {
+    for (size_t i=0;i<mIndices.size();i+=3)
     {
-      closestLambda = lambda;
-      closestbary = bary;
-      closestTri = (int)i;
+      const int i0 = mIndices[i+0];
+      const int i1 = mIndices[i+1];
+      const int i2 = mIndices[i+2];
+      if (Helper::Helper2(ray, vertexPosition(i0), vertexPosition(i1), vertexPosition(i2), bary, lambda) &&
+        lambda > 0 && lambda < closestLambda)
+      {
+        closestLambda = lambda;
+        closestbary = bary;
+        closestTri = (int)i;
+      }
     }
   }
 
@@ -41,18 +53,18 @@ bool IndexedTriangleMesh::closestIntersectionModel(const Ray &ray, double maxLam
     const int i2 = mIndices[closestTri+2];
 
     Vec3d n;
-    if(mVertexNormal.empty())
-      n = cross(mVertexPosition[i1]-mVertexPosition[i0],mVertexPosition[i2]-mVertexPosition[i0]).normalize();
+    if(!hasVertexNormals())
+      n = cross(vertexPosition(i1)-vertexPosition(i0),vertexPosition(i2)-vertexPosition(i0)).normalize();
     else
-      n = (mVertexNormal[i0]*closestbary[0]+
-           mVertexNormal[i1]*closestbary[1]+
-           mVertexNormal[i2]*closestbary[2]).normalize();
+      n = (vertexNormal(i0)*closestbary[0]+
+           vertexNormal(i1)*closestbary[1]+
+           vertexNormal(i2)*closestbary[2]).normalize();
 
     Vec3d uvw(0,0,0);
-    if(!mVertexTextureCoordinate.empty())
-      uvw = (mVertexTextureCoordinate[i0]*closestbary[0]+
-             mVertexTextureCoordinate[i1]*closestbary[1]+
-             mVertexTextureCoordinate[i2]*closestbary[2]);
+    if(hasVertexTextureCoordinates())
+      uvw = (vertexTextureCoordinate(i0)*closestbary[0]+
+             vertexTextureCoordinate(i1)*closestbary[1]+
+             vertexTextureCoordinate(i2)*closestbary[2]);
     intersection=RayIntersection(ray,shared_from_this(),closestLambda,n,uvw);
     return true;
   }
@@ -62,6 +74,9 @@ bool IndexedTriangleMesh::closestIntersectionModel(const Ray &ray, double maxLam
 
 bool IndexedTriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda) const
 {
+  if (this->hasTrianglePackets())
+    return mTrianglePackets.anyIntersection(ray,0,mTrianglePackets.size(),maxLambda);
+
   Vec3d uvw;
   double lambda;
   for (size_t i=0;i<mIndices.size();i+=3)
@@ -69,7 +84,7 @@ bool IndexedTriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda)
     const int i0 = mIndices[i+0];
     const int i1 = mIndices[i+1];
     const int i2 = mIndices[i+2];
-	if (Helper::Helper2(ray, mVertexPosition[i0], mVertexPosition[i1], mVertexPosition[i2], uvw, lambda) &&
+	if (Helper::Helper2(ray, vertexPosition(i0), vertexPosition(i1), vertexPosition(i2), uvw, lambda) &&
       lambda > 0 && lambda < maxLambda)
       return true;
   }
@@ -82,11 +97,25 @@ bool IndexedTriangleMesh::loadFromOBJ(const std::string &filePath)
   if(!io.loadFromOBJ(filePath))
     return false;
 
-  //loading succeeded, copy data
-  mVertexPosition=std::vector<Vec3d>(io.vertexPositions());
-  mVertexTextureCoordinate=std::vector<Vec3d>(io.vertexTextureCoordinates());
-  mVertexNormal=std::vector<Vec3d>(io.vertexNormals());
-  mIndices=std::vector<int>(io.triangleIndices());
+  //loading succeeded, take over the data without copying
+  std::vector<Vec3d> positions, textureCoordinates, normals;
+  std::vector<int> indices;
+  io.releaseData(positions,textureCoordinates,normals,indices);
+  this->setMeshData(std::move(positions),std::move(normals),std::move(textureCoordinates),std::move(indices));
+
+  return true;
+}
+
+bool IndexedTriangleMesh::loadFromPLY(const std::string &filePath)
+{
+  IndexedTriangleIO io;
+  if(!io.loadFromPLY(filePath))
+    return false;
+
+  std::vector<Vec3d> positions, textureCoordinates, normals;
+  std::vector<int> indices;
+  io.releaseData(positions,textureCoordinates,normals,indices);
+  this->setMeshData(std::move(positions),std::move(normals),std::move(textureCoordinates),std::move(indices));
 
   return true;
 }
@@ -98,19 +127,237 @@ bool IndexedTriangleMesh::saveToOBJ(const std::string &filePath,
   IndexedTriangleIO io;
 
   //set io data
-  io.setVertexPositions(mVertexPosition);
-  io.setVertexTextureCoordinates(mVertexTextureCoordinate);
-  io.setVertexNormals(mVertexNormal);
+  if (mVertexStorage == FullPrecision)
+  {
+    io.setVertexPositions(mVertexPosition);
+    io.setVertexTextureCoordinates(mVertexTextureCoordinate);
+    io.setVertexNormals(mVertexNormal);
+  }
+  else
+  {
+    std::vector<Vec3d> positions, normals, textureCoordinates;
+    mCompactVertices.decode(positions,normals,textureCoordinates);
+    io.setVertexPositions(positions);
+    io.setVertexTextureCoordinates(textureCoordinates);
+    io.setVertexNormals(normals);
+  }
   io.setTriangleIndices(mIndices);
   return io.saveToOBJ(filePath,textureCoordinates,normals);
 }
 
+bool IndexedTriangleMesh::loadFromBinary(const std::string &filePath)
+{
+  MeshFile file;
+  if(!file.open(filePath))
+    return false;
+  return this->loadFromMeshFile(file);
+}
+
+bool IndexedTriangleMesh::loadFromMeshFile(const MeshFile &file)
+{
+  const size_t numVertices = file.count(MeshFile::Positions);
+  if((file.count(MeshFile::Normals) != 0 && file.count(MeshFile::Normals) != numVertices) ||
+     (file.count(MeshFile::TextureCoordinates) != 0 && file.count(MeshFile::TextureCoordinates) != numVertices) ||
+     file.count(MeshFile::Indices) % 3 != 0)
+  {
+    std::cerr<<"Error: Mesh file sections differ in size"<<std::endl;
+    return false;
+  }
+
+  const int *fileIndices = (const int*)file.data(MeshFile::Indices);
+  for (size_t i=0;i<file.count(MeshFile::Indices);++i)
+  {
+    if (fileIndices[i] < 0 || size_t(fileIndices[i]) >= numVertices)
+    {
+      std::cerr<<"Error: Mesh file contains invalid vertex index "<<fileIndices[i]<<std::endl;
+      return false;
+    }
+  }
+
+  std::vector<Vec3d> positions, normals, textureCoordinates;
+  file.copyAttribute(MeshFile::Positions,positions);
+  file.copyAttribute(MeshFile::Normals,normals);
+  file.copyAttribute(MeshFile::TextureCoordinates,textureCoordinates);
+  std::vector<int> indices(fileIndices,fileIndices+file.count(MeshFile::Indices));
+
+  this->setMeshData(std::move(positions),std::move(normals),std::move(textureCoordinates),std::move(indices));
+  return true;
+}
+
+bool IndexedTriangleMesh::saveToBinary(const std::string &filePath, bool singlePrecision) const
+{
+  std::ofstream out(filePath, std::ios::binary | std::ios::out);
+  if(!out.is_open())
+  {
+    std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  if(!this->saveToBinary(out,singlePrecision))
+  {
+    if(!out)
+      std::cerr<<"Error: Could not write file "<<filePath<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool IndexedTriangleMesh::saveToBinary(std::ostream &out, bool singlePrecision) const
+{
+  return this->writeMeshFile(out,singlePrecision,0,0,0);
+}
+
+bool IndexedTriangleMesh::loadFromCompressed(const std::string &filePath)
+{
+  std::vector<Vec3d> positions, normals, textureCoordinates;
+  std::vector<int> indices;
+  if(!CompressedMeshFile::read(filePath,positions,normals,textureCoordinates,indices))
+    return false;
+  this->setMeshData(std::move(positions),std::move(normals),std::move(textureCoordinates),std::move(indices));
+  return true;
+}
+
+bool IndexedTriangleMesh::saveToCompressed(const std::string &filePath) const
+{
+  if (mVertexStorage == FullPrecision)
+    return CompressedMeshFile::write(filePath,mVertexPosition,mVertexNormal,mVertexTextureCoordinate,mIndices);
+
+  std::vector<Vec3d> positions, normals, textureCoordinates;
+  mCompactVertices.decode(positions,normals,textureCoordinates);
+  return CompressedMeshFile::write(filePath,positions,normals,textureCoordinates,mIndices);
+}
+
+bool IndexedTriangleMesh::writeMeshFile(std::ostream &out, bool singlePrecision,
+                                        const void *nodes, size_t numNodes, size_t nodeSize) const
+{
+  if (mVertexStorage == FullPrecision)
+    return MeshFile::write(out,mVertexPosition,mVertexNormal,mVertexTextureCoordinate,mIndices,
+                           singlePrecision,nodes,numNodes,nodeSize);
+
+  std::vector<Vec3d> positions, normals, textureCoordinates;
+  mCompactVertices.decode(positions,normals,textureCoordinates);
+  return MeshFile::write(out,positions,normals,textureCoordinates,mIndices,
+                         singlePrecision,nodes,numNodes,nodeSize);
+}
+
 BoundingBox IndexedTriangleMesh::computeBoundingBox() const
 {
   BoundingBox bbox;
-  for (size_t i=0;i<mVertexPosition.size();++i)
-    bbox.expandByPoint(mVertexPosition[i]);
+  for (size_t i=0;i<numVertices();++i)
+    bbox.expandByPoint(vertexPosition(int(i)));
   return bbox;
 }
 
+void IndexedTriangleMesh::initialize()
+{
+  this->buildTrianglePackets();
+}
+
+const std::vector<Vec3d>& IndexedTriangleMesh::fullPrecisionPositions(std::vector<Vec3d> &buffer) const
+{
+  if (mVertexStorage == FullPrecision)
+    return mVertexPosition;
+
+  buffer.resize(mCompactVertices.size());
+  for (size_t i=0;i<buffer.size();++i)
+    buffer[i] = mCompactVertices.position(i);
+  return buffer;
+}
+
+void IndexedTriangleMesh::reorderTriangles(const std::vector<int> &triangleOrder)
+{
+  if (triangleOrder.size() != mIndices.size()/3)
+    return;
+
+  //assign new vertex numbers in order of first use
+  const size_t n = numVertices();
+  std::vector<int> oldToNew(n,-1);
+  std::vector<int> newToOld;
+  newToOld.reserve(n);
+
+  std::vector<int> indices(mIndices.size());
+  for (size_t i=0;i<triangleOrder.size();++i)
+  {
+    for (size_t k=0;k<3;++k)
+    {
+      const int oldVertex = mIndices[3*triangleOrder[i]+k];
+      if (oldToNew[oldVertex] < 0)
+      {
+        oldToNew[oldVertex] = int(newToOld.size());
+        newToOld.push_back(oldVertex);
+      }
+      indices[3*i+k] = oldToNew[oldVertex];
+    }
+  }
+
+  //keep unreferenced vertices behind the referenced ones
+  for (size_t i=0;i<n;++i)
+    if (oldToNew[i] < 0)
+      newToOld.push_back(int(i));
+
+  mIndices.swap(indices);
+  mTrianglePackets.clear();
+  ++mDataVersion;
+
+  if (mVertexStorage != FullPrecision)
+  {
+    mCompactVertices.permute(newToOld);
+    return;
+  }
+
+  std::vector<Vec3d>* attributes[3] = {&mVertexPosition,&mVertexNormal,&mVertexTextureCoordinate};
+  for (size_t a=0;a<3;++a)
+  {
+    if (attributes[a]->size() != n)
+      continue;
+    std::vector<Vec3d> permuted(n);
+    for (size_t i=0;i<n;++i)
+      permuted[i] = (*attributes[a])[newToOld[i]];
+    attributes[a]->swap(permuted);
+  }
+}
+
+void IndexedTriangleMesh::setVertexStorage(VertexStorage storage)
+{
+  if (storage == mVertexStorage)
+    return;
+
+  //decode back to full precision first
+  if (mVertexStorage != FullPrecision)
+  {
+    mCompactVertices.decode(mVertexPosition,mVertexNormal,mVertexTextureCoordinate);
+    mCompactVertices.clear();
+  }
+
+  mVertexStorage = storage;
+  mTrianglePackets.clear();
+  ++mDataVersion;
+  this->compactVertices();
+}
+
+size_t IndexedTriangleMesh::vertexMemoryUsage() const
+{
+  if (mVertexStorage != FullPrecision)
+    return mCompactVertices.memoryUsage();
+  return (mVertexPosition.size()+mVertexNormal.size()+mVertexTextureCoordinate.size())*sizeof(Vec3d);
+}
+
+size_t IndexedTriangleMesh::memoryUsage() const
+{
+  return this->vertexMemoryUsage() + mIndices.size()*sizeof(int) + mTrianglePackets.memoryUsage();
+}
+
+void IndexedTriangleMesh::compactVertices()
+{
+  if (mVertexStorage == FullPrecision)
+    return;
+
+  mCompactVertices.encode(mVertexPosition,mVertexNormal,mVertexTextureCoordinate,
+                          mVertexStorage == Quantized16);
+
+  //release the full precision arrays
+  std::vector<Vec3d>().swap(mVertexPosition);
+  std::vector<Vec3d>().swap(mVertexNormal);
+  std::vector<Vec3d>().swap(mVertexTextureCoordinate);
+}
+
 } //rt
\ No newline at end of file
@@ -5,6 +5,9 @@
 
 #include "Renderable.hpp"
 #include "Ray.hpp"
+#include "CompactVertexArray.hpp"
+#include "TrianglePacketArray.hpp"
+#include "MeshFile.hpp"
 
 namespace rt
 {
@@ -13,6 +16,20 @@ class IndexedTriangleMesh : public Renderable
 {
 public:
 
+  /// Precision of the stored vertex attributes. In the compact modes normals
+  /// are octahedral-encoded and texture coordinates are stored as half floats.
+  enum VertexStorage
+  {
+    FullPrecision,  //!< Vec3d attributes, 72 bytes per vertex
+    FloatPrecision, //!< float positions, 20 bytes per vertex
+    Quantized16     //!< 16 bit positions relative to the bounding box, 14 bytes per vertex
+  };
+
+  RAYTRACER_EXPORTS IndexedTriangleMesh() : mVertexStorage(FullPrecision), mDataVersion(1) {}
+
+  /// Precomputes the packed triangle layout used by the intersection tests.
+  RAYTRACER_EXPORTS void initialize() override;
+
   /// Implements the intersection computation between ray and any stored triangle.
   RAYTRACER_EXPORTS bool
     closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const override;
@@ -20,13 +37,35 @@ public:
   RAYTRACER_EXPORTS bool anyIntersectionModel(const Ray &ray, double maxLambda) const override;
 
   RAYTRACER_EXPORTS bool loadFromOBJ(const std::string &filePath);
+  /// Loads an ASCII or binary PLY file, polygons are triangulated.
+  RAYTRACER_EXPORTS bool loadFromPLY(const std::string &filePath);
   RAYTRACER_EXPORTS bool saveToOBJ(const std::string &filePath, bool textureCoordinates=true, bool normals=true) const;
 
+  /// Loads a mesh written by saveToBinary() (see MeshFile), the arrays are
+  /// copied from the mapped file as a whole without parsing.
+  RAYTRACER_EXPORTS bool loadFromBinary(const std::string &filePath);
+  /// Writes the mesh as a MeshFile, singlePrecision rounds the attributes to float.
+  RAYTRACER_EXPORTS bool saveToBinary(const std::string &filePath, bool singlePrecision=false) const;
+  /// Writes the MeshFile at the current position of the stream, see MeshFile::write().
+  RAYTRACER_EXPORTS virtual bool saveToBinary(std::ostream &out, bool singlePrecision=false) const;
+
+  /// Replaces the mesh by the content of an opened mesh file.
+  RAYTRACER_EXPORTS virtual bool loadFromMeshFile(const MeshFile &file);
+
+  /// Loads a mesh written by saveToCompressed() (see CompressedMeshFile).
+  RAYTRACER_EXPORTS bool loadFromCompressed(const std::string &filePath);
+  /// Writes the mesh as a CompressedMeshFile, the attributes are quantized to 16 bits.
+  RAYTRACER_EXPORTS bool saveToCompressed(const std::string &filePath) const;
+
+  /// Appends a vertex. A mesh in compact storage is converted back to full precision first.
   RAYTRACER_EXPORTS int addVertex(const Vec3d &v, const Vec3d &n, const Vec3d &uvw)
   {
+    if (mVertexStorage != FullPrecision)
+      setVertexStorage(FullPrecision);
     mVertexPosition.push_back(v);
     mVertexNormal.push_back(n);
     mVertexTextureCoordinate.push_back(uvw);
+    ++mDataVersion;
     return int(mVertexPosition.size()-1);
   }
   RAYTRACER_EXPORTS void addTriangle(const int i0,const int i1,const int i2)
@@ -34,8 +73,62 @@ public:
     mIndices.push_back(i0);
     mIndices.push_back(i1);
     mIndices.push_back(i2);
+    ++mDataVersion;
+  }
+
+  /// Replaces all vertex and index data, taking ownership of the given arrays.
+  /// Normals and texture coordinates may be empty.
+  RAYTRACER_EXPORTS void setMeshData(std::vector<Vec3d> &&positions,
+                                     std::vector<Vec3d> &&normals,
+                                     std::vector<Vec3d> &&textureCoordinates,
+                                     std::vector<int> &&indices)
+  {
+    mVertexPosition          = std::move(positions);
+    mVertexNormal            = std::move(normals);
+    mVertexTextureCoordinate = std::move(textureCoordinates);
+    mIndices                 = std::move(indices);
+    mTrianglePackets.clear();
+    ++mDataVersion;
+    this->compactVertices();
   }
 
+  /// Converts the vertex attributes to the given storage. Converting from a
+  /// compact storage back to full precision does not restore the lost bits.
+  RAYTRACER_EXPORTS void setVertexStorage(VertexStorage storage);
+  RAYTRACER_EXPORTS VertexStorage vertexStorage() const {return mVertexStorage;}
+
+  /// Number of bytes occupied by the vertex attributes.
+  RAYTRACER_EXPORTS size_t vertexMemoryUsage() const;
+  /// Number of bytes occupied by the vertex attributes, indices and acceleration data.
+  RAYTRACER_EXPORTS virtual size_t memoryUsage() const;
+
+  /// Per-vertex accessors which decode compact storage on the fly.
+  RAYTRACER_EXPORTS size_t numVertices() const
+  {
+    return mVertexStorage == FullPrecision ? mVertexPosition.size() : mCompactVertices.size();
+  }
+  RAYTRACER_EXPORTS bool hasVertexNormals() const
+  {
+    return mVertexStorage == FullPrecision ? !mVertexNormal.empty() : mCompactVertices.hasNormals();
+  }
+  RAYTRACER_EXPORTS bool hasVertexTextureCoordinates() const
+  {
+    return mVertexStorage == FullPrecision ? !mVertexTextureCoordinate.empty() : mCompactVertices.hasTextureCoordinates();
+  }
+  RAYTRACER_EXPORTS Vec3d vertexPosition(int i) const
+  {
+    return mVertexStorage == FullPrecision ? mVertexPosition[i] : mCompactVertices.position(i);
+  }
+  RAYTRACER_EXPORTS Vec3d vertexNormal(int i) const
+  {
+    return mVertexStorage == FullPrecision ? mVertexNormal[i] : mCompactVertices.normal(i);
+  }
+  RAYTRACER_EXPORTS Vec3d vertexTextureCoordinate(int i) const
+  {
+    return mVertexStorage == FullPrecision ? mVertexTextureCoordinate[i] : mCompactVertices.textureCoordinate(i);
+  }
+
+  /// Full precision attribute arrays, these are empty in compact storage.
   RAYTRACER_EXPORTS const std::vector<Vec3d>& vertexPositions()          const {return mVertexPosition;}
   RAYTRACER_EXPORTS const std::vector<Vec3d>& vertexTextureCoordinates() const {return mVertexTextureCoordinate;}
   RAYTRACER_EXPORTS const std::vector<Vec3d>& vertexNormals()            const {return mVertexNormal;}
@@ -46,11 +139,51 @@ protected:
   // Override this method to recompute the bounding box of this object.
   RAYTRACER_EXPORTS BoundingBox computeBoundingBox() const override;
 
+  // Writes the mesh together with optional hierarchy nodes.
+  RAYTRACER_EXPORTS bool writeMeshFile(std::ostream &out, bool singlePrecision,
+                                       const void *nodes, size_t numNodes, size_t nodeSize) const;
+
+  // Returns the full precision positions, decoding compact storage into buffer if required.
+  RAYTRACER_EXPORTS const std::vector<Vec3d>& fullPrecisionPositions(std::vector<Vec3d> &buffer) const;
+
+  // Permutes the triangles into the given order and the vertices into the order of
+  // their first use by these triangles, indices are remapped accordingly.
+  RAYTRACER_EXPORTS void reorderTriangles(const std::vector<int> &triangleOrder);
+
+  // Stores the triangles in the given order for the packet intersection kernels.
+  // Only full precision meshes get packets, in compact storage their double
+  // precision copy of every triangle would outweigh the memory saved by the
+  // vertices, so the triangles are intersected from the decoded vertices.
+  RAYTRACER_EXPORTS void buildTrianglePackets(const std::vector<int> &order=std::vector<int>())
+  {
+    if (mVertexStorage == FullPrecision)
+      mTrianglePackets.build(mVertexPosition,mIndices,order);
+    else
+      mTrianglePackets.clear();
+  }
+  // True if the packets are up to date with the triangles.
+  RAYTRACER_EXPORTS bool hasTrianglePackets() const
+  {
+    return !mIndices.empty() && mTrianglePackets.size() == mIndices.size()/3;
+  }
+  RAYTRACER_EXPORTS const TrianglePacketArray& trianglePackets() const {return mTrianglePackets;}
+
+  // Incremented by every change of the vertex or index data, derived data such as
+  // a hierarchy is up to date if it was computed at the current version.
+  RAYTRACER_EXPORTS unsigned long long dataVersion() const {return mDataVersion;}
+
 private:
+  // Moves the full precision attributes into compact storage if it is selected.
+  void compactVertices();
+
+  VertexStorage                       mVertexStorage;
+  CompactVertexArray                  mCompactVertices;
   std::vector<Vec3d>                   mVertexPosition;
   std::vector<Vec3d>                   mVertexTextureCoordinate;
   std::vector<Vec3d>                   mVertexNormal;
   std::vector<int>                    mIndices;
+  TrianglePacketArray                 mTrianglePackets;
+  unsigned long long                  mDataVersion;
 };
 } //namespace rt
 
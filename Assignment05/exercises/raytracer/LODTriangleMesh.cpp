@@ -0,0 +1,117 @@
+#include "LODTriangleMesh.hpp"
+#include "MeshSimplifier.hpp"
+
+namespace rt
+{
+
+LODTriangleMesh::LODTriangleMesh() : mErrorTolerance(1)
+{
+}
+
+// Copies the triangles with the vertices they use into a new mesh.
+static std::shared_ptr<BVHIndexedTriangleMesh> createLevel(const IndexedTriangleMesh &mesh,
+                                                           const std::vector<Vec3d> &positions,
+                                                           const std::vector<int> &indices)
+{
+  std::vector<int> localIndex(positions.size(),-1);
+  std::vector<Vec3d> levelPositions, levelNormals, levelTextureCoordinates;
+  std::vector<int> levelIndices(indices.size());
+  for(size_t i=0;i<indices.size();++i)
+  {
+    const int v = indices[i];
+    if(localIndex[v] < 0)
+    {
+      localIndex[v] = int(levelPositions.size());
+      levelPositions.push_back(positions[v]);
+      if(mesh.hasVertexNormals())
+        levelNormals.push_back(mesh.vertexNormal(v));
+      if(mesh.hasVertexTextureCoordinates())
+        levelTextureCoordinates.push_back(mesh.vertexTextureCoordinate(v));
+    }
+    levelIndices[i] = localIndex[v];
+  }
+
+  std::shared_ptr<BVHIndexedTriangleMesh> level = std::make_shared<BVHIndexedTriangleMesh>();
+  level->setMeshData(std::move(levelPositions),std::move(levelNormals),
+                     std::move(levelTextureCoordinates),std::move(levelIndices));
+  return level;
+}
+
+void LODTriangleMesh::build(const IndexedTriangleMesh &mesh, double reduction,
+                            size_t minTriangles, size_t maxLevels)
+{
+  mLevels.clear();
+  mErrors.clear();
+  mBox = BoundingBox();
+
+  std::vector<Vec3d> positions(mesh.numVertices());
+  for(size_t i=0;i<positions.size();++i)
+  {
+    positions[i] = mesh.vertexPosition(int(i));
+    mBox.expandByPoint(positions[i]);
+  }
+
+  mLevels.push_back(createLevel(mesh,positions,mesh.triangleIndices()));
+  mErrors.push_back(0);
+
+  //every level continues the simplification of the previous one
+  MeshSimplifier simplifier(positions,mesh.triangleIndices());
+  std::vector<int> indices;
+  size_t target = size_t(double(simplifier.numTriangles())*reduction);
+  while(mLevels.size() < maxLevels && target >= minTriangles && reduction < 1)
+  {
+    if(!simplifier.simplify(target))
+      break;
+    simplifier.triangles(indices);
+    mLevels.push_back(createLevel(mesh,positions,indices));
+    mErrors.push_back(simplifier.error());
+    target = size_t(double(simplifier.numTriangles())*reduction);
+  }
+}
+
+void LODTriangleMesh::initialize()
+{
+  for(size_t i=0;i<mLevels.size();++i)
+    mLevels[i]->initialize();
+}
+
+size_t LODTriangleMesh::selectLevel(const Ray &ray) const
+{
+  //the footprint where the ray enters the mesh is the smallest it can have
+  //at any hit, so the selected level is accurate enough for all of them
+  const double entry = mBox.entryDistance(ray);
+  if(mLevels.size() < 2 || entry == std::numeric_limits<double>::infinity())
+    return 0;
+  const double footprint = ray.footprint(entry)*mErrorTolerance;
+
+  size_t level = 0;
+  while(level+1 < mLevels.size() && mErrors[level+1] <= footprint)
+    ++level;
+  return level;
+}
+
+bool LODTriangleMesh::closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const
+{
+  if(mLevels.empty())
+    return false;
+
+  RayIntersection hit;
+  if(!mLevels[this->selectLevel(ray)]->closestIntersectionModel(ray,maxLambda,hit))
+    return false;
+  intersection = RayIntersection(ray,shared_from_this(),hit.lambda(),hit.normal(),hit.uvw());
+  return true;
+}
+
+bool LODTriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda) const
+{
+  if(mLevels.empty())
+    return false;
+  return mLevels[this->selectLevel(ray)]->anyIntersectionModel(ray,maxLambda);
+}
+
+BoundingBox LODTriangleMesh::computeBoundingBox() const
+{
+  return mBox;
+}
+
+} //namespace rt
@@ -0,0 +1,64 @@
+#ifndef LODTRIANGLEMESH_HPP_INCLUDE_ONCE
+#define LODTRIANGLEMESH_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <memory>
+#include <vector>
+#include "Renderable.hpp"
+#include "BVHIndexedTriangleMesh.hpp"
+
+namespace rt
+{
+
+/// Triangle mesh with a chain of simplified levels of detail (see
+/// MeshSimplifier), each with its own hierarchy. Every ray intersects the
+/// coarsest level whose geometric error is below the footprint of its cone
+/// (see Ray::setCone()) where it enters the bounding box, so distant meshes
+/// and wide secondary rays traverse much smaller hierarchies. Rays without
+/// a cone always use the full mesh.
+class LODTriangleMesh : public Renderable
+{
+public:
+  RAYTRACER_EXPORTS LODTriangleMesh();
+
+  /// Builds the levels from the mesh, which becomes level 0. Every further
+  /// level has reduction times the triangles of the previous one, until it
+  /// would have less than minTriangles or maxLevels levels exist.
+  RAYTRACER_EXPORTS void build(const IndexedTriangleMesh &mesh, double reduction=0.25,
+                               size_t minTriangles=256, size_t maxLevels=8);
+
+  RAYTRACER_EXPORTS size_t numLevels() const { return mLevels.size(); }
+  RAYTRACER_EXPORTS std::shared_ptr<const BVHIndexedTriangleMesh> level(size_t i) const { return mLevels[i]; }
+  /// Estimated distance between a level and the full mesh, 0 for level 0.
+  RAYTRACER_EXPORTS double levelError(size_t i) const { return mErrors[i]; }
+
+  /// Multiplies the footprint before the comparison with the level errors,
+  /// larger values select coarser levels. The default is 1.
+  RAYTRACER_EXPORTS void setErrorTolerance(double tolerance) { mErrorTolerance = tolerance; }
+  RAYTRACER_EXPORTS double errorTolerance() const { return mErrorTolerance; }
+
+  /// Level used for the ray in model coordinates.
+  RAYTRACER_EXPORTS size_t selectLevel(const Ray &ray) const;
+
+  /// Builds the hierarchies of the levels.
+  RAYTRACER_EXPORTS void initialize() override;
+
+  RAYTRACER_EXPORTS bool
+    closestIntersectionModel(const Ray &ray, double maxLambda, RayIntersection& intersection) const override;
+
+  RAYTRACER_EXPORTS bool anyIntersectionModel(const Ray &ray, double maxLambda) const override;
+
+protected:
+  RAYTRACER_EXPORTS BoundingBox computeBoundingBox() const override;
+
+private:
+  std::vector<std::shared_ptr<BVHIndexedTriangleMesh>> mLevels;
+  std::vector<double>                                  mErrors;
+  BoundingBox                                          mBox;
+  double                                               mErrorTolerance;
+};
+
+} //namespace rt
+
+#endif //LODTRIANGLEMESH_HPP_INCLUDE_ONCE
@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_HPP_INCLUDE_ONCE
+#define MAPPEDFILE_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <string>
+#include <vector>
+
+namespace rt
+{
+
+/// Read-only view of a whole file. The file is memory-mapped where the
+/// platform supports it, otherwise it is read into memory.
+class MappedFile
+{
+public:
+  RAYTRACER_EXPORTS MappedFile();
+  RAYTRACER_EXPORTS ~MappedFile();
+
+  /// Maps the file, returns false if it could not be opened.
+  RAYTRACER_EXPORTS bool open(const std::string &filePath);
+  RAYTRACER_EXPORTS void close();
+
+  RAYTRACER_EXPORTS const char* data() const { return mData; }
+  RAYTRACER_EXPORTS size_t size() const { return mSize; }
+
+private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  const char*       mData;
+  size_t            mSize;
+  void*             mMapping;   //!< platform handle of the mapping, null if not mapped
+  std::vector<char> mBuffer;    //!< file content if mapping was not possible
+};
+
+} //namespace rt
+
+#endif //MAPPEDFILE_HPP_INCLUDE_ONCE
@@ -27,6 +27,10 @@ public:
 
   RAYTRACER_EXPORTS const Vec3d& color() const {return mColor;}
 
+  /// Surface color at an intersection point, independent of the lighting.
+  /// Used as a feature for denoising.
+  RAYTRACER_EXPORTS virtual Vec3d albedo(const RayIntersection& /*intersection*/) const { return mColor; }
+
   RAYTRACER_EXPORTS double reflectance() const {
     return mReflectance;
   }
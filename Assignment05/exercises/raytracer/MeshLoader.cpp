@@ -0,0 +1,63 @@
+#include "MeshLoader.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace rt
+{
+
+static bool endsWith(const std::string &s, const std::string &suffix)
+{
+  return s.size() >= suffix.size() && s.compare(s.size()-suffix.size(),suffix.size(),suffix) == 0;
+}
+
+void MeshLoader::add(std::shared_ptr<IndexedTriangleMesh> mesh, const std::string &filePath)
+{
+  Job job;
+  job.mesh = mesh;
+  job.filePath = filePath;
+
+  //missing files are reported when they are loaded
+  std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+  job.fileSize = file.is_open() ? (long long)file.tellg() : 0;
+  mJobs.push_back(job);
+}
+
+bool MeshLoader::run()
+{
+  //largest files first, so that a big mesh does not start last
+  std::stable_sort(mJobs.begin(),mJobs.end(),[](const Job &a, const Job &b) -> bool
+  {
+    return a.fileSize > b.fileSize;
+  });
+
+  //a single mesh keeps the parallel parsing and build of its own
+  const int numJobs = int(mJobs.size());
+  bool success = true;
+#pragma omp parallel for schedule(dynamic,1) if(numJobs > 1)
+  for (int i=0;i<numJobs;++i)
+  {
+    const Job &job = mJobs[i];
+    bool loaded;
+    if (endsWith(job.filePath,".mesh"))
+      loaded = job.mesh->loadFromBinary(job.filePath);
+    else if (endsWith(job.filePath,".cmesh"))
+      loaded = job.mesh->loadFromCompressed(job.filePath);
+    else if (endsWith(job.filePath,".ply"))
+      loaded = job.mesh->loadFromPLY(job.filePath);
+    else
+      loaded = job.mesh->loadFromOBJ(job.filePath);
+    if (loaded)
+      job.mesh->initialize();
+    else
+    {
+#pragma omp critical
+      success = false;
+    }
+  }
+
+  mJobs.clear();
+  return success;
+}
+
+} //namespace rt
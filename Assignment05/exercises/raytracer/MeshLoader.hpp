@@ -0,0 +1,45 @@
+#ifndef MESHLOADER_HPP_INCLUDE_ONCE
+#define MESHLOADER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "IndexedTriangleMesh.hpp"
+
+namespace rt
+{
+
+/// Loads the meshes of a scene concurrently. Every mesh is initialized
+/// (e.g. its hierarchy is built) by the same thread right after it was
+/// loaded, so builds overlap with the parsing of the other files. The
+/// following Scene::prepareScene() reuses the results as long as the
+/// meshes are not modified in between.
+class MeshLoader
+{
+public:
+  /// Queues a mesh to be loaded from an OBJ file, a PLY file (".ply"), a
+  /// file written by saveToBinary() (".mesh") or saveToCompressed() (".cmesh").
+  RAYTRACER_EXPORTS void add(std::shared_ptr<IndexedTriangleMesh> mesh, const std::string &filePath);
+
+  /// Loads and initializes all queued meshes and clears the queue. Returns
+  /// false if any file could not be loaded, the other meshes are loaded anyway.
+  RAYTRACER_EXPORTS bool run();
+
+  RAYTRACER_EXPORTS size_t size() const { return mJobs.size(); }
+
+private:
+  struct Job
+  {
+    std::shared_ptr<IndexedTriangleMesh> mesh;
+    std::string                          filePath;
+    long long                            fileSize;
+  };
+
+  std::vector<Job> mJobs;
+};
+
+} //namespace rt
+
+#endif //MESHLOADER_HPP_INCLUDE_ONCE
@@ -0,0 +1,287 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace rt
+{
+
+static const size_t MaxValence = 24;
+
+struct SimplifierEdge
+{
+  int a, b;      // a < b
+  int triangle;
+  bool operator<(const SimplifierEdge &other) const
+  {
+    return a < other.a || (a == other.a && b < other.b);
+  }
+};
+
+// Sorted, unique vertices of the triangles around v, v itself excluded.
+static void collectNeighbors(const std::vector<Vec3i> &triangles, const std::vector<int> &vertexTriangles,
+                             int v, std::vector<int> &neighbors)
+{
+  neighbors.clear();
+  for(size_t i=0;i<vertexTriangles.size();++i)
+  {
+    const Vec3i &t = triangles[vertexTriangles[i]];
+    for(unsigned int c=0;c<3;++c)
+      if(t[c] != v)
+        neighbors.push_back(t[c]);
+  }
+  std::sort(neighbors.begin(),neighbors.end());
+  neighbors.erase(std::unique(neighbors.begin(),neighbors.end()),neighbors.end());
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<Vec3d> &positions, const std::vector<int> &indices) :
+  mPositions(positions), mNumTriangles(indices.size()/3), mMaxCost(0)
+{
+  mTriangles.resize(mNumTriangles);
+  mVertexTriangles.resize(positions.size());
+  mQuadrics.resize(positions.size());
+  for(size_t i=0;i<mQuadrics.size();++i)
+    std::fill(mQuadrics[i].a,mQuadrics[i].a+10,0.0);
+
+  std::vector<SimplifierEdge> edges;
+  edges.reserve(3*mTriangles.size());
+  for(size_t t=0;t<mTriangles.size();++t)
+  {
+    mTriangles[t] = Vec3i(indices[3*t+0],indices[3*t+1],indices[3*t+2]);
+    if(mTriangles[t][0] == mTriangles[t][1] || mTriangles[t][1] == mTriangles[t][2] ||
+       mTriangles[t][2] == mTriangles[t][0])
+    {
+      //triangles referring to a vertex twice are dropped
+      mTriangles[t] = Vec3i(-1,-1,-1);
+      --mNumTriangles;
+      continue;
+    }
+    const Vec3d &p0 = positions[mTriangles[t][0]];
+    const Vec3d n = cross(positions[mTriangles[t][1]]-p0,positions[mTriangles[t][2]]-p0);
+    for(unsigned int c=0;c<3;++c)
+    {
+      mVertexTriangles[mTriangles[t][c]].push_back(int(t));
+      SimplifierEdge edge;
+      edge.a = std::min(mTriangles[t][c],mTriangles[t][(c+1)%3]);
+      edge.b = std::max(mTriangles[t][c],mTriangles[t][(c+1)%3]);
+      edge.triangle = int(t);
+      edges.push_back(edge);
+    }
+
+    //every vertex measures the squared distance to the planes of its triangles
+    const double length = n.length();
+    if(length == 0)
+      continue;
+    const Vec3d normal = n/length;
+    for(unsigned int c=0;c<3;++c)
+      addPlane(mQuadrics[mTriangles[t][c]],normal,-dot(normal,p0),1.0);
+  }
+
+  std::sort(edges.begin(),edges.end());
+  for(size_t i=0;i<edges.size();)
+  {
+    size_t j = i+1;
+    while(j < edges.size() && edges[j].a == edges[i].a && edges[j].b == edges[i].b)
+      ++j;
+
+    //border edges keep their position by a plane through the edge,
+    //perpendicular to the triangle
+    if(j == i+1)
+    {
+      const Vec3i &t = mTriangles[edges[i].triangle];
+      const Vec3d &pa = positions[edges[i].a];
+      const Vec3d n = cross(positions[t[1]]-positions[t[0]],positions[t[2]]-positions[t[0]]);
+      Vec3d border = cross(positions[edges[i].b]-pa,n);
+      const double length = border.length();
+      if(length > 0)
+      {
+        border = border/length;
+        addPlane(mQuadrics[edges[i].a],border,-dot(border,pa),1.0);
+        addPlane(mQuadrics[edges[i].b],border,-dot(border,pa),1.0);
+      }
+    }
+    this->pushEdge(edges[i].a,edges[i].b);
+    i = j;
+  }
+}
+
+void MeshSimplifier::addPlane(Quadric &q, const Vec3d &n, double d, double weight)
+{
+  const double p[4] = {n[0],n[1],n[2],d};
+  int k = 0;
+  for(int i=0;i<4;++i)
+    for(int j=i;j<4;++j)
+      q.a[k++] += weight*p[i]*p[j];
+}
+
+double MeshSimplifier::evaluate(const Quadric &q, const Vec3d &p)
+{
+  const double x = p[0], y = p[1], z = p[2];
+  const double *a = q.a;
+  return a[0]*x*x + 2*a[1]*x*y + 2*a[2]*x*z + 2*a[3]*x +
+         a[4]*y*y + 2*a[5]*y*z + 2*a[6]*y +
+         a[7]*z*z + 2*a[8]*z +
+         a[9];
+}
+
+double MeshSimplifier::cost(int from, int to) const
+{
+  const Vec3d &p = mPositions[to];
+  return std::max(0.0,evaluate(mQuadrics[from],p)+evaluate(mQuadrics[to],p));
+}
+
+void MeshSimplifier::pushEdge(int a, int b)
+{
+  Collapse collapse;
+  const double costAB = this->cost(a,b);
+  const double costBA = this->cost(b,a);
+  collapse.cost = std::min(costAB,costBA);
+  collapse.from = costAB <= costBA ? a : b;
+  collapse.to   = costAB <= costBA ? b : a;
+  mHeap.push_back(collapse);
+  std::push_heap(mHeap.begin(),mHeap.end());
+}
+
+bool MeshSimplifier::isCollapseValid(int from, int to) const
+{
+  //the edge has to exist and both vertices may only share the vertices
+  //opposite to it, otherwise the collapse would pinch the surface
+  std::vector<int> neighborsFrom, neighborsTo;
+  collectNeighbors(mTriangles,mVertexTriangles[from],from,neighborsFrom);
+  if(!std::binary_search(neighborsFrom.begin(),neighborsFrom.end(),to))
+    return false;
+  collectNeighbors(mTriangles,mVertexTriangles[to],to,neighborsTo);
+
+  size_t sharedTriangles = 0;
+  for(size_t i=0;i<mVertexTriangles[from].size();++i)
+  {
+    const Vec3i &t = mTriangles[mVertexTriangles[from][i]];
+    if(t[0] == to || t[1] == to || t[2] == to)
+      ++sharedTriangles;
+  }
+  std::vector<int> common;
+  std::set_intersection(neighborsFrom.begin(),neighborsFrom.end(),neighborsTo.begin(),neighborsTo.end(),
+                        std::back_inserter(common));
+  if(common.size() != sharedTriangles)
+    return false;
+
+  //flat regions have no preferred collapses, and merging ever more vertices into
+  //the same one would create fans of slivers and make every check slower
+  if(neighborsFrom.size()+neighborsTo.size()-common.size()-2 > MaxValence)
+    return false;
+
+  //the remaining triangles must not flip or degenerate
+  for(size_t i=0;i<mVertexTriangles[from].size();++i)
+  {
+    const Vec3i &t = mTriangles[mVertexTriangles[from][i]];
+    if(t[0] == to || t[1] == to || t[2] == to)
+      continue;
+    Vec3d p[3], q[3];
+    for(unsigned int c=0;c<3;++c)
+    {
+      p[c] = mPositions[t[c]];
+      q[c] = t[c] == from ? mPositions[to] : p[c];
+    }
+    const Vec3d before = cross(p[1]-p[0],p[2]-p[0]);
+    const Vec3d after  = cross(q[1]-q[0],q[2]-q[0]);
+    if(after.lengthSquared() == 0 || dot(before,after) <= 0)
+      return false;
+  }
+  return true;
+}
+
+void MeshSimplifier::collapse(int from, int to)
+{
+  std::vector<int> &fromTriangles = mVertexTriangles[from];
+  for(size_t i=0;i<fromTriangles.size();++i)
+  {
+    const int ti = fromTriangles[i];
+    Vec3i &t = mTriangles[ti];
+    if(t[0] == to || t[1] == to || t[2] == to)
+    {
+      //the triangles on the edge disappear
+      for(unsigned int c=0;c<3;++c)
+      {
+        if(t[c] == from)
+          continue;
+        std::vector<int> &list = mVertexTriangles[t[c]];
+        list.erase(std::find(list.begin(),list.end(),ti));
+      }
+      t = Vec3i(-1,-1,-1);
+      --mNumTriangles;
+    }
+    else
+    {
+      for(unsigned int c=0;c<3;++c)
+        if(t[c] == from)
+          t[c] = to;
+      mVertexTriangles[to].push_back(ti);
+    }
+  }
+  std::vector<int>().swap(fromTriangles);
+
+  for(int k=0;k<10;++k)
+    mQuadrics[to].a[k] += mQuadrics[from].a[k];
+
+  std::vector<int> neighbors;
+  collectNeighbors(mTriangles,mVertexTriangles[to],to,neighbors);
+  for(size_t i=0;i<neighbors.size();++i)
+    this->pushEdge(to,neighbors[i]);
+}
+
+bool MeshSimplifier::simplify(size_t targetTriangles)
+{
+  const size_t before = mNumTriangles;
+  while(mNumTriangles > targetTriangles && !mHeap.empty())
+  {
+    std::pop_heap(mHeap.begin(),mHeap.end());
+    const Collapse entry = mHeap.back();
+    mHeap.pop_back();
+    if(mVertexTriangles[entry.from].empty() || mVertexTriangles[entry.to].empty())
+      continue;
+
+    //quadrics only grow, so a stored cost is a lower bound and an entry
+    //whose cost increased is queued again
+    const double current = this->cost(entry.from,entry.to);
+    if(current > entry.cost)
+    {
+      Collapse updated = entry;
+      updated.cost = current;
+      mHeap.push_back(updated);
+      std::push_heap(mHeap.begin(),mHeap.end());
+      continue;
+    }
+
+    if(this->isCollapseValid(entry.from,entry.to))
+    {
+      mMaxCost = std::max(mMaxCost,current);
+      this->collapse(entry.from,entry.to);
+    }
+    else if(this->isCollapseValid(entry.to,entry.from))
+    {
+      //the other direction is queued with its own cost
+      Collapse reverse;
+      reverse.cost = this->cost(entry.to,entry.from);
+      reverse.from = entry.to;
+      reverse.to   = entry.from;
+      mHeap.push_back(reverse);
+      std::push_heap(mHeap.begin(),mHeap.end());
+    }
+  }
+  return mNumTriangles < before;
+}
+
+void MeshSimplifier::triangles(std::vector<int> &indices) const
+{
+  indices.clear();
+  indices.reserve(3*mNumTriangles);
+  for(size_t t=0;t<mTriangles.size();++t)
+  {
+    if(mTriangles[t][0] < 0)
+      continue;
+    for(unsigned int c=0;c<3;++c)
+      indices.push_back(mTriangles[t][c]);
+  }
+}
+
+} //namespace rt
@@ -0,0 +1,73 @@
+#ifndef MESHSIMPLIFIER_HPP_INCLUDE_ONCE
+#define MESHSIMPLIFIER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <vector>
+#include "Math.hpp"
+
+namespace rt
+{
+
+/// Quadric error simplification (Garland and Heckbert) by half-edge
+/// collapses: a vertex is merged into one of its neighbors, so the
+/// remaining triangles always refer to original vertices and keep their
+/// normals and texture coordinates. Border edges are protected by
+/// additional planes perpendicular to them, collapses which would flip a
+/// triangle or make the mesh non-manifold are rejected.
+///
+/// simplify() can be called repeatedly with decreasing targets to obtain a
+/// chain of levels of detail, each continuing from the previous one.
+class MeshSimplifier
+{
+public:
+  /// The arrays are only referenced and have to stay valid.
+  RAYTRACER_EXPORTS MeshSimplifier(const std::vector<Vec3d> &positions, const std::vector<int> &indices);
+
+  /// Collapses the cheapest edges until at most targetTriangles remain or no
+  /// valid collapse is left. Returns false if no triangle could be removed.
+  RAYTRACER_EXPORTS bool simplify(size_t targetTriangles);
+
+  /// Current triangles, three indices into the original positions each.
+  RAYTRACER_EXPORTS void triangles(std::vector<int> &indices) const;
+  RAYTRACER_EXPORTS size_t numTriangles() const { return mNumTriangles; }
+
+  /// Upper bound of the distance between the current and the original surface,
+  /// estimated as the square root of the largest quadric error of a collapse.
+  RAYTRACER_EXPORTS double error() const { return std::sqrt(mMaxCost); }
+
+private:
+  // Symmetric 4x4 matrix summing squared distances to planes.
+  struct Quadric
+  {
+    double a[10];
+  };
+
+  struct Collapse
+  {
+    double cost;
+    int    from;
+    int    to;
+    bool operator<(const Collapse &other) const { return cost > other.cost; }
+  };
+
+  static void addPlane(Quadric &q, const Vec3d &normal, double d, double weight);
+  static double evaluate(const Quadric &q, const Vec3d &p);
+
+  double cost(int from, int to) const;
+  void pushEdge(int a, int b);
+  bool isCollapseValid(int from, int to) const;
+  void collapse(int from, int to);
+
+  const std::vector<Vec3d>      &mPositions;
+  std::vector<Vec3i>             mTriangles;        //!< removed triangles have index -1
+  std::vector<std::vector<int>>  mVertexTriangles;  //!< triangles around every vertex
+  std::vector<Quadric>           mQuadrics;
+  std::vector<Collapse>          mHeap;             //!< priority queue, entries are re-evaluated when popped
+  size_t                         mNumTriangles;
+  double                         mMaxCost;
+};
+
+} //namespace rt
+
+#endif //MESHSIMPLIFIER_HPP_INCLUDE_ONCE
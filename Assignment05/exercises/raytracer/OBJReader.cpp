@@ -0,0 +1,476 @@
+#include "OBJReader.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace rt
+{
+
+// Whitespace as skipped by sscanf
+static inline bool isSpace(char c)
+{
+  return c==' ' || c=='\t' || c=='\n' || c=='\v' || c=='\f' || c=='\r';
+}
+
+static inline bool isDigit(char c)
+{
+  return c>='0' && c<='9';
+}
+
+// Reads a real number with the standard library, used for anything the fast
+// path below cannot convert exactly (many digits, large exponents, inf, nan, hex).
+static const char* parseRealFallback(const char *p, const char *end, OBJReader::Precision precision, double &value)
+{
+  char buffer[256];
+  size_t n = 0;
+  while (p+n<end && n<sizeof(buffer)-1 && !isSpace(p[n]))
+  {
+    buffer[n] = p[n];
+    ++n;
+  }
+  buffer[n] = 0;
+
+  char *stop;
+  if (precision == OBJReader::SinglePrecision)
+    value = strtof(buffer,&stop);
+  else
+    value = strtod(buffer,&stop);
+  if (stop == buffer)
+    return 0;
+  return p + (stop-buffer);
+}
+
+// Reads a real number at p, returns the position behind it or null on failure.
+// Decimal numbers with few digits are converted by a single correctly rounded
+// multiplication or division with an exact power of ten, which gives the
+// same result as strtod (strtof for single precision).
+static const char* parseReal(const char *p, const char *end, OBJReader::Precision precision, double &value)
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+  static const float powersf[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+  const char *start = p;
+  bool negative = false;
+  if (p<end && (*p=='+' || *p=='-'))
+  {
+    negative = *p=='-';
+    ++p;
+  }
+
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool anyDigit = false;
+
+  //integer part
+  for (;p<end && isDigit(*p);++p)
+  {
+    mantissa = mantissa*10 + (*p-'0');
+    digits += mantissa != 0;
+    anyDigit = true;
+  }
+  //fractional part
+  if (p<end && *p=='.')
+  {
+    for (++p;p<end && isDigit(*p);++p)
+    {
+      mantissa = mantissa*10 + (*p-'0');
+      digits += mantissa != 0;
+      --exponent;
+      anyDigit = true;
+    }
+  }
+  if (!anyDigit || digits > 19 || (p<end && (*p=='x' || *p=='X')))
+    return parseRealFallback(start,end,precision,value);
+
+  //exponent, an incomplete exponent is not part of the number
+  if (p<end && (*p=='e' || *p=='E'))
+  {
+    const char *q = p+1;
+    bool negativeExponent = false;
+    if (q<end && (*q=='+' || *q=='-'))
+    {
+      negativeExponent = *q=='-';
+      ++q;
+    }
+    if (q<end && isDigit(*q))
+    {
+      int e = 0;
+      for (;q<end && isDigit(*q);++q)
+        if (e < 100000)
+          e = e*10 + (*q-'0');
+      exponent += negativeExponent ? -e : e;
+      p = q;
+    }
+  }
+
+  if (precision == OBJReader::SinglePrecision)
+  {
+    if (mantissa > (1ull<<24) || exponent < -10 || exponent > 10)
+      return parseRealFallback(start,end,precision,value);
+    const float v = exponent < 0 ? float(mantissa)/powersf[-exponent] : float(mantissa)*powersf[exponent];
+    value = negative ? -v : v;
+  }
+  else
+  {
+    if (mantissa > (1ull<<53) || exponent < -22 || exponent > 22)
+      return parseRealFallback(start,end,precision,value);
+    const double v = exponent < 0 ? double(mantissa)/powers[-exponent] : double(mantissa)*powers[exponent];
+    value = negative ? -v : v;
+  }
+  return p;
+}
+
+// Reads an integer like "%d", returns the position behind it or null on failure.
+static const char* parseInteger(const char *p, const char *end, int &value)
+{
+  bool negative = false;
+  if (p<end && (*p=='+' || *p=='-'))
+  {
+    negative = *p=='-';
+    ++p;
+  }
+  if (p>=end || !isDigit(*p))
+    return 0;
+
+  //saturate like strtol
+  long long v = 0;
+  for (;p<end && isDigit(*p);++p)
+    if (v <= LLONG_MAX/10)
+      v = std::min<long long>(v*10 + (*p-'0'), LLONG_MAX);
+    else
+      v = LLONG_MAX;
+  value = int(negative ? -v : v);
+  return p;
+}
+
+// Reads up to three real numbers like "%lf %lf %lf", returns the number read.
+static int scanReals(const char *p, const char *end, OBJReader::Precision precision, Vec3d &v)
+{
+  for (int i=0;i<3;++i)
+  {
+    while (p<end && isSpace(*p))
+      ++p;
+    p = parseReal(p,end,precision,v[i]);
+    if (!p)
+      return i;
+  }
+  return 3;
+}
+
+// Matches a sscanf-like pattern of 'd' (integer), ' ' (any whitespace) and
+// literal characters, returns the number of integers read.
+static int scanIntegers(const char *p, const char *end, const char *pattern, int *values)
+{
+  int count = 0;
+  for (;*pattern;++pattern)
+  {
+    if (*pattern==' ' || *pattern=='d')
+    {
+      while (p<end && isSpace(*p))
+        ++p;
+    }
+    if (*pattern=='d')
+    {
+      p = parseInteger(p,end,values[count]);
+      if (!p)
+        return count;
+      ++count;
+    }
+    else if (*pattern!=' ')
+    {
+      if (p>=end || *p!=*pattern)
+        return count;
+      ++p;
+    }
+  }
+  return count;
+}
+
+// Reads a triangle face in one of the formats v, v/t, v//n or v/t/n. The
+// format is decided from the first corner, so every face is scanned once.
+static bool scanFace(const char *p, const char *end, Vec3i corners[3])
+{
+  const char *q = p;
+  while (q<end && isSpace(*q))
+    ++q;
+  int index;
+  q = parseInteger(q,end,index);
+  if (!q)
+    return false;
+
+  int values[9];
+  if (q>=end || *q!='/')
+  {
+    if (scanIntegers(p,end,"d d d",values) != 3)
+      return false;
+    for (int i=0;i<3;++i)
+      corners[i] = Vec3i(values[i],-1,-1);
+    return true;
+  }
+  if (q+1<end && q[1]=='/')
+  {
+    if (scanIntegers(p,end,"d//d d//d d//d",values) != 6)
+      return false;
+    for (int i=0;i<3;++i)
+      corners[i] = Vec3i(values[2*i],-1,values[2*i+1]);
+    return true;
+  }
+
+  ++q;
+  while (q<end && isSpace(*q))
+    ++q;
+  q = parseInteger(q,end,index);
+  if (!q)
+    return false;
+  if (q>=end || *q!='/')
+  {
+    if (scanIntegers(p,end,"d/d d/d d/d",values) != 6)
+      return false;
+    for (int i=0;i<3;++i)
+      corners[i] = Vec3i(values[2*i],values[2*i+1],-1);
+    return true;
+  }
+  if (scanIntegers(p,end,"d/d/d d/d/d d/d/d",values) != 9)
+    return false;
+  for (int i=0;i<3;++i)
+    corners[i] = Vec3i(values[3*i],values[3*i+1],values[3*i+2]);
+  return true;
+}
+
+// Tests if the keyword occurs in [begin,end)
+static bool contains(const char *begin, const char *end, const char *keyword)
+{
+  const size_t length = strlen(keyword);
+  return std::search(begin,end,keyword,keyword+length) != end;
+}
+
+OBJReader::OBJReader() : mError(NoError), mErrorLine(0), mHasUnsupportedData(false)
+{
+}
+
+void OBJReader::clear()
+{
+  std::vector<Vec3d>().swap(mVertexPosition);
+  std::vector<Vec3d>().swap(mVertexTextureCoordinate);
+  std::vector<Vec3d>().swap(mVertexNormal);
+  std::vector<Vec3i>().swap(mFaceCorners);
+  std::vector<int>().swap(mUnknownLines);
+  mError = NoError;
+  mErrorLine = 0;
+  mHasUnsupportedData = false;
+}
+
+void OBJReader::parseChunk(const char *begin, const char *end, Precision precision, Chunk &chunk)
+{
+  Vec3d v;
+  Vec3i corners[3];
+
+  const char *line = begin;
+  while (line < end)
+  {
+    const char *lineEnd = (const char*)memchr(line,'\n',size_t(end-line));
+    if (!lineEnd)
+      lineEnd = end;
+    ++chunk.numLines;
+
+    //the former loader read lines into a buffer of 1024 characters
+    if (lineEnd-line > 1023)
+    {
+      chunk.error = ReadError;
+      chunk.errorLine = chunk.numLines;
+      return;
+    }
+
+    //characters behind the end of the line read as terminating zero
+    const size_t length = size_t(lineEnd-line);
+    const char c0 = length > 0 ? line[0] : 0;
+    const char c1 = length > 1 ? line[1] : 0;
+
+    //comment or empty line
+    if (c0=='#' || c0=='\r')
+    {
+    }
+    //vertex position
+    else if (c0=='v' && c1==' ')
+    {
+      if (scanReals(line+2,lineEnd,precision,v) != 3)
+      {
+        chunk.error = PositionError;
+        chunk.errorLine = chunk.numLines;
+        return;
+      }
+      chunk.positions.push_back(v);
+    }
+    //vertex texture coordinate
+    else if (c0=='v' && c1=='t')
+    {
+      if (scanReals(std::min(line+3,lineEnd),lineEnd,precision,v) != 3)
+      {
+        chunk.error = TextureCoordinateError;
+        chunk.errorLine = chunk.numLines;
+        return;
+      }
+      chunk.textureCoordinates.push_back(v);
+    }
+    //vertex normal
+    else if (c0=='v' && c1=='n')
+    {
+      if (scanReals(std::min(line+3,lineEnd),lineEnd,precision,v) != 3)
+      {
+        chunk.error = NormalError;
+        chunk.errorLine = chunk.numLines;
+        return;
+      }
+      chunk.normals.push_back(v);
+    }
+    //(triangle) face, quads and other n-gons are not supported
+    else if (c0=='f' && c1==' ')
+    {
+      if (!scanFace(line+2,lineEnd,corners))
+      {
+        chunk.error = FaceError;
+        chunk.errorLine = chunk.numLines;
+        return;
+      }
+      chunk.corners.insert(chunk.corners.end(),corners,corners+3);
+    }
+    else if (c0=='s')
+      chunk.hasSmoothingGroup = true;
+    else if (c0=='g')
+      chunk.hasGroup = true;
+    else if (c0=='l')
+      chunk.hasLine = true;
+    else if (contains(line,lineEnd,"usemtl") || contains(line,lineEnd,"mtllib"))
+      chunk.hasMaterial = true;
+    else
+      chunk.unknownLines.push_back(c0 ? chunk.numLines : -chunk.numLines);
+
+    line = lineEnd+1;
+  }
+}
+
+bool OBJReader::read(const std::string &filePath, Precision precision)
+{
+  this->clear();
+  mFilePath = filePath;
+
+  MappedFile file;
+  if (!file.open(filePath))
+  {
+    mError = OpenError;
+    return false;
+  }
+
+  const char *begin = file.data();
+  const char *end   = begin + file.size();
+
+  //split large files into chunks at line boundaries
+  int numChunks = 1;
+#if defined(_OPENMP)
+  if (file.size() > (1<<20))
+    numChunks = 4*omp_get_max_threads();
+#endif
+  std::vector<const char*> bounds(numChunks+1,end);
+  bounds[0] = begin;
+  for (int i=1;i<numChunks;++i)
+  {
+    const char *split = std::max(begin + file.size()*size_t(i)/size_t(numChunks),bounds[i-1]);
+    const char *newline = split < end ? (const char*)memchr(split,'\n',size_t(end-split)) : 0;
+    bounds[i] = newline ? newline+1 : end;
+  }
+
+  std::vector<Chunk> chunks(numChunks);
+#pragma omp parallel for schedule(dynamic,1)
+  for (int i=0;i<numChunks;++i)
+    parseChunk(bounds[i],bounds[i+1],precision,chunks[i]);
+
+  //gather diagnostics up to the first error, line numbers become global
+  int lineOffset = 0;
+  size_t numPositions = 0, numTextureCoordinates = 0, numNormals = 0, numCorners = 0;
+  for (int i=0;i<numChunks;++i)
+  {
+    const Chunk &chunk = chunks[i];
+    for (size_t j=0;j<chunk.unknownLines.size();++j)
+    {
+      const int line = chunk.unknownLines[j];
+      mUnknownLines.push_back(line > 0 ? line+lineOffset : line-lineOffset);
+    }
+    if (chunk.error != NoError)
+    {
+      mError = chunk.error;
+      mErrorLine = chunk.errorLine+lineOffset;
+      return false;
+    }
+    mHasUnsupportedData = mHasUnsupportedData || chunk.hasGroup || chunk.hasLine ||
+                          chunk.hasMaterial || chunk.hasSmoothingGroup;
+    lineOffset += chunk.numLines;
+    numPositions          += chunk.positions.size();
+    numTextureCoordinates += chunk.textureCoordinates.size();
+    numNormals            += chunk.normals.size();
+    numCorners            += chunk.corners.size();
+  }
+
+  //concatenate the chunks
+  mVertexPosition.reserve(numPositions);
+  mVertexTextureCoordinate.reserve(numTextureCoordinates);
+  mVertexNormal.reserve(numNormals);
+  mFaceCorners.reserve(numCorners);
+  for (int i=0;i<numChunks;++i)
+  {
+    Chunk &chunk = chunks[i];
+    mVertexPosition.insert(mVertexPosition.end(),chunk.positions.begin(),chunk.positions.end());
+    mVertexTextureCoordinate.insert(mVertexTextureCoordinate.end(),chunk.textureCoordinates.begin(),chunk.textureCoordinates.end());
+    mVertexNormal.insert(mVertexNormal.end(),chunk.normals.begin(),chunk.normals.end());
+    mFaceCorners.insert(mFaceCorners.end(),chunk.corners.begin(),chunk.corners.end());
+    chunk = Chunk();
+  }
+  return true;
+}
+
+void OBJReader::printDiagnostics(bool warnEmptyLines) const
+{
+  for (size_t i=0;i<mUnknownLines.size();++i)
+  {
+    if (mUnknownLines[i] > 0)
+      std::cerr<<"Warning: unknown data in line "<<mUnknownLines[i]<<std::endl;
+    else if (warnEmptyLines)
+      std::cerr<<"Warning: unknown data in line "<<-mUnknownLines[i]<<std::endl;
+  }
+
+  switch (mError)
+  {
+  case OpenError:
+    std::cerr<<"Error: Could not open file "<<mFilePath<<std::endl;
+    break;
+  case ReadError:
+    std::cerr<<"Error: Could not read file"<<std::endl;
+    break;
+  case PositionError:
+    std::cerr<<"Error: Could not read 'v' line "<<mErrorLine<<std::endl;
+    break;
+  case TextureCoordinateError:
+    std::cerr<<"Error: Could not read 'vt' line "<<mErrorLine<<std::endl;
+    break;
+  case NormalError:
+    std::cerr<<"Error: Could not read 'vn' line "<<mErrorLine<<std::endl;
+    break;
+  case FaceError:
+    std::cerr<<"Error: face format invalid in line "<<mErrorLine<<std::endl;
+    break;
+  case NoError:
+    if (mHasUnsupportedData)
+      std::cerr<<"Warning: obj file contains unsupported data."<<std::endl;
+    break;
+  }
+}
+
+} //namespace rt
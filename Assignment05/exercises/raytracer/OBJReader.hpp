@@ -0,0 +1,102 @@
+#ifndef OBJREADER_HPP_INCLUDE_ONCE
+#define OBJREADER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <string>
+#include <vector>
+#include "Math.hpp"
+
+namespace rt
+{
+
+/// Parser for the subset of Wavefront OBJ read by IndexedTriangleIO.
+/// The file is memory-mapped and large files are split at line boundaries
+/// into chunks which are parsed in parallel. Numbers are read by a
+/// hand-written tokenizer which yields the same values as sscanf, so the
+/// result is identical to the former line-by-line loader.
+class OBJReader
+{
+public:
+  /// Precision of the parsed numbers, SinglePrecision reproduces reading
+  /// with "%f" although the values are returned as doubles.
+  enum Precision
+  {
+    DoublePrecision,
+    SinglePrecision
+  };
+
+  RAYTRACER_EXPORTS OBJReader();
+
+  /// Parses the file, returns false if it cannot be opened or contains invalid data.
+  RAYTRACER_EXPORTS bool read(const std::string &filePath, Precision precision=DoublePrecision);
+
+  /// Prints the warnings and errors of the last read in file order.
+  /// Empty lines are reported as unknown data if warnEmptyLines is set.
+  RAYTRACER_EXPORTS void printDiagnostics(bool warnEmptyLines) const;
+
+  RAYTRACER_EXPORTS void clear();
+
+  /// False if the last read failed because the file could not be opened.
+  RAYTRACER_EXPORTS bool fileOpened() const { return mError != OpenError; }
+
+  /// Vertex data in file order.
+  RAYTRACER_EXPORTS std::vector<Vec3d>& vertexPositions()          { return mVertexPosition; }
+  RAYTRACER_EXPORTS std::vector<Vec3d>& vertexTextureCoordinates() { return mVertexTextureCoordinate; }
+  RAYTRACER_EXPORTS std::vector<Vec3d>& vertexNormals()            { return mVertexNormal; }
+
+  /// One (v,vt,vn) index triple per triangle corner as written in the file
+  /// (starting from 1), absent indices are -1.
+  RAYTRACER_EXPORTS const std::vector<Vec3i>& faceCorners() const { return mFaceCorners; }
+
+private:
+
+  enum ErrorType
+  {
+    NoError,
+    OpenError,
+    ReadError,
+    PositionError,
+    TextureCoordinateError,
+    NormalError,
+    FaceError
+  };
+
+  // Result of parsing a contiguous range of lines
+  struct Chunk
+  {
+    Chunk() : numLines(0), error(NoError), errorLine(0),
+      hasLine(false), hasGroup(false), hasSmoothingGroup(false), hasMaterial(false) {}
+
+    std::vector<Vec3d> positions;
+    std::vector<Vec3d> textureCoordinates;
+    std::vector<Vec3d> normals;
+    std::vector<Vec3i> corners;
+    std::vector<int>   unknownLines;  //!< local line numbers, negative for empty lines
+    int       numLines;
+    ErrorType error;
+    int       errorLine;              //!< local line number of the first error
+    bool hasLine;
+    bool hasGroup;
+    bool hasSmoothingGroup;
+    bool hasMaterial;
+  };
+
+  static void parseChunk(const char *begin, const char *end, Precision precision, Chunk &chunk);
+
+  std::string        mFilePath;
+  std::vector<Vec3d> mVertexPosition;
+  std::vector<Vec3d> mVertexTextureCoordinate;
+  std::vector<Vec3d> mVertexNormal;
+  std::vector<Vec3i> mFaceCorners;
+
+  //diagnostics of the last read
+  std::vector<int> mUnknownLines;
+  ErrorType        mError;
+  int              mErrorLine;
+  bool             mHasUnsupportedData;
+};
+
+} //namespace rt
+
+#endif //OBJREADER_HPP_INCLUDE_ONCE
@@ -0,0 +1,534 @@
+#include "PLYReader.hpp"
+#include "MappedFile.hpp"
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace rt
+{
+
+enum PLYFormat
+{
+  PLYAscii,
+  PLYBinaryLittleEndian,
+  PLYBinaryBigEndian
+};
+
+enum PLYScalarType
+{
+  PLYInt8, PLYUInt8, PLYInt16, PLYUInt16, PLYInt32, PLYUInt32, PLYFloat32, PLYFloat64, PLYInvalidType
+};
+
+struct PLYProperty
+{
+  std::string   name;
+  PLYScalarType type;
+  PLYScalarType countType;  // type of the list length, PLYInvalidType for scalar properties
+};
+
+struct PLYElement
+{
+  std::string              name;
+  size_t                   count;
+  std::vector<PLYProperty> properties;
+};
+
+// Vertices with more properties are converted sequentially
+static const size_t MaxParallelVertexProperties = 32;
+
+// Indices of the vertex properties read into the mesh, -1 if absent
+struct PLYVertexLayout
+{
+  int position[3];
+  int normal[3];
+  int textureCoordinate[2];
+};
+
+static PLYScalarType scalarType(const std::string &name)
+{
+  if (name == "char"   || name == "int8")    return PLYInt8;
+  if (name == "uchar"  || name == "uint8")   return PLYUInt8;
+  if (name == "short"  || name == "int16")   return PLYInt16;
+  if (name == "ushort" || name == "uint16")  return PLYUInt16;
+  if (name == "int"    || name == "int32")   return PLYInt32;
+  if (name == "uint"   || name == "uint32")  return PLYUInt32;
+  if (name == "float"  || name == "float32") return PLYFloat32;
+  if (name == "double" || name == "float64") return PLYFloat64;
+  return PLYInvalidType;
+}
+
+static size_t scalarSize(PLYScalarType type)
+{
+  static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+  return sizes[type];
+}
+
+// Converts a binary value, swapBytes reverses the byte order first
+static inline double readScalar(const char *p, PLYScalarType type, bool swapBytes)
+{
+  char bytes[8];
+  const size_t size = scalarSize(type);
+  if (swapBytes)
+  {
+    for (size_t i=0;i<size;++i)
+      bytes[i] = p[size-1-i];
+  }
+  else
+    memcpy(bytes,p,size);
+
+  switch (type)
+  {
+  case PLYInt8:    { int8_t v;   memcpy(&v,bytes,1); return v; }
+  case PLYUInt8:   { uint8_t v;  memcpy(&v,bytes,1); return v; }
+  case PLYInt16:   { int16_t v;  memcpy(&v,bytes,2); return v; }
+  case PLYUInt16:  { uint16_t v; memcpy(&v,bytes,2); return v; }
+  case PLYInt32:   { int32_t v;  memcpy(&v,bytes,4); return v; }
+  case PLYUInt32:  { uint32_t v; memcpy(&v,bytes,4); return v; }
+  case PLYFloat32: { float v;    memcpy(&v,bytes,4); return v; }
+  case PLYFloat64: { double v;   memcpy(&v,bytes,8); return v; }
+  default:         return 0;
+  }
+}
+
+// Reads the next whitespace separated number, returns the position behind it or null
+static const char* readAsciiValue(const char *p, const char *end, double &value)
+{
+  while (p<end && (*p==' ' || *p=='\t' || *p=='\n' || *p=='\r' || *p=='\v' || *p=='\f'))
+    ++p;
+
+  //the mapping is not null-terminated
+  char buffer[64];
+  size_t n = 0;
+  while (p+n<end && n<sizeof(buffer)-1 && !(p[n]==' ' || p[n]=='\t' || p[n]=='\n' || p[n]=='\r'))
+  {
+    buffer[n] = p[n];
+    ++n;
+  }
+  buffer[n] = 0;
+
+  char *stop;
+  value = strtod(buffer,&stop);
+  if (n == 0 || stop != buffer+n)
+    return 0;
+  return p+n;
+}
+
+static bool isValidCount(double count)
+{
+  return count >= 0 && count <= double(INT_MAX) && count == double(int(count));
+}
+
+static int findProperty(const PLYElement &element, const char *name0, const char *name1=0, const char *name2=0)
+{
+  for (size_t i=0;i<element.properties.size();++i)
+  {
+    const std::string &name = element.properties[i].name;
+    if (element.properties[i].countType == PLYInvalidType &&
+        (name == name0 || (name1 && name == name1) || (name2 && name == name2)))
+      return int(i);
+  }
+  return -1;
+}
+
+static PLYVertexLayout vertexLayout(const PLYElement &element)
+{
+  PLYVertexLayout layout;
+  layout.position[0] = findProperty(element,"x");
+  layout.position[1] = findProperty(element,"y");
+  layout.position[2] = findProperty(element,"z");
+  layout.normal[0] = findProperty(element,"nx");
+  layout.normal[1] = findProperty(element,"ny");
+  layout.normal[2] = findProperty(element,"nz");
+  layout.textureCoordinate[0] = findProperty(element,"u","s","texture_u");
+  layout.textureCoordinate[1] = findProperty(element,"v","t","texture_v");
+
+  //partial attributes are ignored
+  if (layout.normal[0] < 0 || layout.normal[1] < 0 || layout.normal[2] < 0)
+    layout.normal[0] = layout.normal[1] = layout.normal[2] = -1;
+  if (layout.textureCoordinate[0] < 0 || layout.textureCoordinate[1] < 0)
+    layout.textureCoordinate[0] = layout.textureCoordinate[1] = -1;
+  return layout;
+}
+
+static int faceIndexProperty(const PLYElement &element)
+{
+  for (size_t i=0;i<element.properties.size();++i)
+  {
+    const PLYProperty &property = element.properties[i];
+    if (property.countType != PLYInvalidType &&
+        (property.name == "vertex_indices" || property.name == "vertex_index"))
+      return int(i);
+  }
+  return -1;
+}
+
+// Size of one element in binary format, 0 if it contains lists
+static size_t binaryStride(const PLYElement &element)
+{
+  size_t stride = 0;
+  for (size_t i=0;i<element.properties.size();++i)
+  {
+    if (element.properties[i].countType != PLYInvalidType)
+      return 0;
+    stride += scalarSize(element.properties[i].type);
+  }
+  return stride;
+}
+
+// Smallest possible size of one element in the file, a list takes at least its
+// count and an ASCII value at least one character
+static size_t minimumElementSize(const PLYElement &element, PLYFormat format)
+{
+  if (format == PLYAscii)
+    return element.properties.size();
+  size_t size = 0;
+  for (size_t i=0;i<element.properties.size();++i)
+  {
+    const PLYProperty &property = element.properties[i];
+    size += scalarSize(property.countType != PLYInvalidType ? property.countType : property.type);
+  }
+  return size;
+}
+
+// Parses the header, returns the offset of the element data or 0 on failure
+static size_t readHeader(const char *data, size_t size, const std::string &filePath,
+                         PLYFormat &format, std::vector<PLYElement> &elements)
+{
+  size_t position = 0;
+  bool hasFormat = false;
+  for (int lineNumber=1;position<size;++lineNumber)
+  {
+    const char *lineEnd = (const char*)memchr(data+position,'\n',size-position);
+    if (!lineEnd)
+      break;
+    std::string line(data+position,lineEnd);
+    position = size_t(lineEnd-data)+1;
+    if (!line.empty() && line[line.size()-1] == '\r')
+      line.erase(line.size()-1);
+
+    std::istringstream tokens(line);
+    std::string keyword;
+    tokens>>keyword;
+
+    if (lineNumber == 1)
+    {
+      if (keyword != "ply")
+        break;
+      continue;
+    }
+
+    if (keyword == "format")
+    {
+      std::string name, version;
+      tokens>>name>>version;
+      if (name == "ascii")
+        format = PLYAscii;
+      else if (name == "binary_little_endian")
+        format = PLYBinaryLittleEndian;
+      else if (name == "binary_big_endian")
+        format = PLYBinaryBigEndian;
+      else
+      {
+        std::cerr<<"Error: Unsupported PLY format "<<name<<" in "<<filePath<<std::endl;
+        return 0;
+      }
+      hasFormat = true;
+    }
+    else if (keyword == "element")
+    {
+      PLYElement element;
+      double count = -1;
+      tokens>>element.name>>count;
+      if (!tokens || !isValidCount(count))
+      {
+        std::cerr<<"Error: Invalid PLY header line "<<lineNumber<<" in "<<filePath<<std::endl;
+        return 0;
+      }
+      element.count = size_t(count);
+      elements.push_back(element);
+    }
+    else if (keyword == "property")
+    {
+      PLYProperty property;
+      std::string type;
+      tokens>>type;
+      property.countType = PLYInvalidType;
+      if (type == "list")
+      {
+        std::string countType;
+        tokens>>countType>>type;
+        property.countType = scalarType(countType);
+      }
+      property.type = scalarType(type);
+      tokens>>property.name;
+      if (!tokens || elements.empty() || property.type == PLYInvalidType ||
+          (type == "list" && property.countType == PLYInvalidType) ||
+          property.countType == PLYFloat32 || property.countType == PLYFloat64)
+      {
+        std::cerr<<"Error: Invalid PLY header line "<<lineNumber<<" in "<<filePath<<std::endl;
+        return 0;
+      }
+      elements.back().properties.push_back(property);
+    }
+    else if (keyword == "end_header")
+    {
+      if (!hasFormat)
+        break;
+      return position;
+    }
+    else if (keyword != "comment" && keyword != "obj_info" && !keyword.empty())
+    {
+      std::cerr<<"Error: Invalid PLY header line "<<lineNumber<<" in "<<filePath<<std::endl;
+      return 0;
+    }
+  }
+
+  std::cerr<<"Error: "<<filePath<<" is not a PLY file"<<std::endl;
+  return 0;
+}
+
+// Appends a polygon as triangle fan, returns false for less than three vertices
+static bool addPolygon(const int *vertices, size_t count, std::vector<int> &indices)
+{
+  if (count < 3)
+    return false;
+  for (size_t i=1;i+1<count;++i)
+  {
+    indices.push_back(vertices[0]);
+    indices.push_back(vertices[i]);
+    indices.push_back(vertices[i+1]);
+  }
+  return true;
+}
+
+// Stores the values of vertex i, values holds one entry per property
+static void storeVertex(const double *values, const PLYVertexLayout &layout, size_t i,
+                        std::vector<Vec3d> &positions, std::vector<Vec3d> &normals,
+                        std::vector<Vec3d> &textureCoordinates)
+{
+  positions[i] = Vec3d(values[layout.position[0]],values[layout.position[1]],values[layout.position[2]]);
+  if (layout.normal[0] >= 0)
+    normals[i] = Vec3d(values[layout.normal[0]],values[layout.normal[1]],values[layout.normal[2]]);
+  if (layout.textureCoordinate[0] >= 0)
+    textureCoordinates[i] = Vec3d(values[layout.textureCoordinate[0]],values[layout.textureCoordinate[1]],0);
+}
+
+PLYReader::PLYReader() : mFileOpened(true)
+{
+}
+
+void PLYReader::clear()
+{
+  std::vector<Vec3d>().swap(mVertexPosition);
+  std::vector<Vec3d>().swap(mVertexTextureCoordinate);
+  std::vector<Vec3d>().swap(mVertexNormal);
+  std::vector<int>().swap(mIndices);
+}
+
+bool PLYReader::read(const std::string &filePath)
+{
+  this->clear();
+
+  MappedFile file;
+  mFileOpened = file.open(filePath);
+  if (!mFileOpened)
+  {
+    std::cerr<<"Error: Could not open file "<<filePath<<std::endl;
+    return false;
+  }
+
+  PLYFormat format = PLYAscii;
+  std::vector<PLYElement> elements;
+  const size_t offset = readHeader(file.data(),file.size(),filePath,format,elements);
+  if (offset == 0)
+    return false;
+
+  //the vertex element defines the positions, all other data is optional
+  const PLYElement *vertexElement = 0;
+  for (size_t e=0;e<elements.size();++e)
+    if (elements[e].name == "vertex")
+      vertexElement = &elements[e];
+  if (!vertexElement)
+  {
+    std::cerr<<"Error: PLY file "<<filePath<<" contains no vertices"<<std::endl;
+    return false;
+  }
+  const PLYVertexLayout layout = vertexLayout(*vertexElement);
+  if (layout.position[0] < 0 || layout.position[1] < 0 || layout.position[2] < 0 ||
+      vertexElement->count > size_t(INT_MAX))
+  {
+    std::cerr<<"Error: PLY file "<<filePath<<" contains no vertex positions"<<std::endl;
+    return false;
+  }
+  //the counts are checked against the file size before they size any array
+  size_t remaining = file.size()-offset;
+  for (size_t e=0;e<elements.size();++e)
+  {
+    const size_t size = minimumElementSize(elements[e],format);
+    if (size > 0 && elements[e].count > remaining/size)
+    {
+      std::cerr<<"Error: PLY file "<<filePath<<" is too short for "<<elements[e].count<<" "<<elements[e].name<<" elements"<<std::endl;
+      return false;
+    }
+    remaining -= elements[e].count*size;
+  }
+
+  mVertexPosition.resize(vertexElement->count);
+  if (layout.normal[0] >= 0)
+    mVertexNormal.resize(vertexElement->count);
+  if (layout.textureCoordinate[0] >= 0)
+    mVertexTextureCoordinate.resize(vertexElement->count);
+
+  const uint16_t probe = 1;
+  const bool littleEndianHost = *(const unsigned char*)&probe == 1;
+  const bool swapBytes = (format == PLYBinaryLittleEndian) != littleEndianHost;
+
+  const char *p = file.data()+offset;
+  const char *end = file.data()+file.size();
+  size_t numSkippedFaces = 0;
+  std::vector<double> values;
+  std::vector<int> polygon;
+
+  for (size_t e=0;e<elements.size() && p;++e)
+  {
+    const PLYElement &element = elements[e];
+    const bool isVertex = &element == vertexElement;
+    const int indexProperty = element.name == "face" ? faceIndexProperty(element) : -1;
+    const size_t stride = binaryStride(element);
+    values.resize(element.properties.size());
+
+    if (indexProperty >= 0)
+      mIndices.reserve(mIndices.size()+3*element.count);
+
+    //binary elements without lists have a fixed size and are converted in parallel
+    if (format != PLYAscii && stride > 0 &&
+        (!isVertex || element.properties.size() <= MaxParallelVertexProperties))
+    {
+      if (element.count > size_t(end-p)/stride)
+      {
+        p = 0;
+        break;
+      }
+      if (isVertex)
+      {
+        const int n = int(element.count);
+        const char *begin = p;
+#pragma omp parallel for
+        for (int i=0;i<n;++i)
+        {
+          double vertexValues[MaxParallelVertexProperties];
+          const char *q = begin+size_t(i)*stride;
+          for (size_t k=0;k<element.properties.size();++k)
+          {
+            vertexValues[k] = readScalar(q,element.properties[k].type,swapBytes);
+            q += scalarSize(element.properties[k].type);
+          }
+          storeVertex(vertexValues,layout,size_t(i),mVertexPosition,mVertexNormal,mVertexTextureCoordinate);
+        }
+      }
+      p += element.count*stride;
+      continue;
+    }
+
+    //fast path for the common binary face layout of uchar counts and 32 bit indices
+    const bool simpleFaces = format != PLYAscii && !swapBytes && indexProperty == 0 &&
+                             element.properties.size() == 1 && element.properties[0].countType == PLYUInt8 &&
+                             (element.properties[0].type == PLYInt32 || element.properties[0].type == PLYUInt32);
+
+    for (size_t i=0;i<element.count && p;++i)
+    {
+      if (simpleFaces && p+13 <= end && (unsigned char)p[0] == 3)
+      {
+        int triangle[3];
+        memcpy(triangle,p+1,12);
+        mIndices.insert(mIndices.end(),triangle,triangle+3);
+        p += 13;
+        continue;
+      }
+
+      for (size_t k=0;k<element.properties.size() && p;++k)
+      {
+        const PLYProperty &property = element.properties[k];
+        size_t count = 1;
+        if (property.countType != PLYInvalidType)
+        {
+          double listSize;
+          if (format == PLYAscii)
+            p = readAsciiValue(p,end,listSize);
+          else if (p+scalarSize(property.countType) <= end)
+          {
+            listSize = readScalar(p,property.countType,swapBytes);
+            p += scalarSize(property.countType);
+          }
+          else
+            p = 0;
+          //the list entries have to fit into the rest of the file as well
+          if (!p || !isValidCount(listSize) ||
+              size_t(listSize) > size_t(end-p)/(format == PLYAscii ? 1 : scalarSize(property.type)))
+          {
+            p = 0;
+            break;
+          }
+          count = size_t(listSize);
+          if (int(k) == indexProperty)
+            polygon.resize(count);
+        }
+
+        for (size_t j=0;j<count && p;++j)
+        {
+          double value;
+          if (format == PLYAscii)
+            p = readAsciiValue(p,end,value);
+          else if (p+scalarSize(property.type) <= end)
+          {
+            value = readScalar(p,property.type,swapBytes);
+            p += scalarSize(property.type);
+          }
+          else
+            p = 0;
+          if (!p)
+            break;
+
+          if (int(k) == indexProperty)
+            polygon[j] = value >= 0 && value <= double(INT_MAX) ? int(value) : -1;
+          else if (property.countType == PLYInvalidType)
+            values[k] = value;
+        }
+
+        if (p && int(k) == indexProperty && !addPolygon(polygon.empty() ? 0 : &polygon[0],count,mIndices))
+          ++numSkippedFaces;
+      }
+
+      if (p && isVertex)
+        storeVertex(&values[0],layout,i,mVertexPosition,mVertexNormal,mVertexTextureCoordinate);
+    }
+  }
+
+  if (!p)
+  {
+    std::cerr<<"Error: Unexpected end of data in PLY file "<<filePath<<std::endl;
+    this->clear();
+    return false;
+  }
+
+  const int numVertices = int(mVertexPosition.size());
+  for (size_t i=0;i<mIndices.size();++i)
+  {
+    if (mIndices[i] < 0 || mIndices[i] >= numVertices)
+    {
+      std::cerr<<"Error: Invalid vertex index in PLY file "<<filePath<<std::endl;
+      this->clear();
+      return false;
+    }
+  }
+
+  if (numSkippedFaces)
+    std::cerr<<"Warning: Skipped "<<numSkippedFaces<<" faces with less than three vertices"<<std::endl;
+  return true;
+}
+
+} //namespace rt
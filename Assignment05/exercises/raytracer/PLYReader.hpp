@@ -0,0 +1,52 @@
+#ifndef PLYREADER_HPP_INCLUDE_ONCE
+#define PLYREADER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <string>
+#include <vector>
+#include "Math.hpp"
+
+namespace rt
+{
+
+/// Parser for Stanford PLY files in ASCII, binary little endian and binary
+/// big endian format. The file is memory-mapped and binary vertex data is
+/// converted in parallel straight from the mapping. The vertex element
+/// provides positions (x,y,z), optional normals (nx,ny,nz) and texture
+/// coordinates (u,v or s,t), the face element a vertex_indices list.
+/// Polygons are triangulated as fans, all other elements and properties
+/// are skipped.
+class PLYReader
+{
+public:
+  RAYTRACER_EXPORTS PLYReader();
+
+  /// Parses the file, returns false and prints an error if it cannot be
+  /// opened or contains invalid data.
+  RAYTRACER_EXPORTS bool read(const std::string &filePath);
+
+  RAYTRACER_EXPORTS void clear();
+
+  /// False if the last read failed because the file could not be opened.
+  RAYTRACER_EXPORTS bool fileOpened() const { return mFileOpened; }
+
+  /// Vertex data in file order, normals and texture coordinates are empty if absent.
+  RAYTRACER_EXPORTS std::vector<Vec3d>& vertexPositions()          { return mVertexPosition; }
+  RAYTRACER_EXPORTS std::vector<Vec3d>& vertexTextureCoordinates() { return mVertexTextureCoordinate; }
+  RAYTRACER_EXPORTS std::vector<Vec3d>& vertexNormals()            { return mVertexNormal; }
+
+  /// Three vertex indices (starting from 0) per triangle.
+  RAYTRACER_EXPORTS std::vector<int>& triangleIndices() { return mIndices; }
+
+private:
+  std::vector<Vec3d> mVertexPosition;
+  std::vector<Vec3d> mVertexTextureCoordinate;
+  std::vector<Vec3d> mVertexNormal;
+  std::vector<int>   mIndices;
+  bool               mFileOpened;
+};
+
+} //namespace rt
+
+#endif //PLYREADER_HPP_INCLUDE_ONCE
@@ -4,8 +4,12 @@ namespace rt {
 
 Ray PerspectiveCamera::ray(size_t x, size_t y) const
 {
-  return Ray(this->position(),
-           ((this->topLeft() + this->right()*double(x) - this->down()*double(y)) - this->position()));
+  Ray ray(this->position(),
+          ((this->topLeft() + this->right()*double(x) - this->down()*double(y)) - this->position()));
+
+  // the image plane is at unit distance, so a pixel grows by its size per unit distance
+  ray.setCone(0,std::max(this->right().length(),this->down().length()));
+  return ray;
 }
 
 } //namespace rt
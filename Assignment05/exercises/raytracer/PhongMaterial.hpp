@@ -23,6 +23,8 @@ namespace rt
     RAYTRACER_EXPORTS Vec4d shade(const RayIntersection& intersection, 
       const Light& light) const override;
 
+    RAYTRACER_EXPORTS double shininess() const { return mShininess; }
+
   private:
 
     double mShininess; 
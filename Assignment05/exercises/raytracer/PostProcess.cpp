@@ -0,0 +1,134 @@
+#include "PostProcess.hpp"
+#include "Image.hpp"
+
+#include <vector>
+
+namespace rt {
+
+// Rows processed together by a thread, a block of a wide image still fits into the cache
+static const int BlockRows=16;
+
+PostProcess::PostProcess() : mExposure(1), mToneMapping(Clamp), mWhitePoint(1e10),
+                             mEncoding(Linear), mGamma(2.2),
+                             mBloomStrength(0), mBloomThreshold(1), mBloomRadius(8)
+{
+}
+
+static double toneMap(double c, PostProcess::ToneMapping toneMapping, double whitePoint)
+{
+  switch (toneMapping)
+  {
+    case PostProcess::Reinhard:
+      return c*(1+c/(whitePoint*whitePoint))/(1+c);
+    case PostProcess::Filmic:
+      return (c*(2.51*c+0.03))/(c*(2.43*c+0.59)+0.14);
+    default:
+      return c;
+  }
+}
+
+static double encode(double c, PostProcess::Encoding encoding, double gamma)
+{
+  switch (encoding)
+  {
+    case PostProcess::Gamma:
+      return std::pow(c,1.0/gamma);
+    case PostProcess::SRGB:
+      return c <= 0.0031308 ? 12.92*c : 1.055*std::pow(c,1.0/2.4)-0.055;
+    default:
+      return c;
+  }
+}
+
+Vec4d PostProcess::map(const Vec4d &color) const
+{
+  Vec4d result;
+  for (int c=0;c<3;++c)
+  {
+    const double exposed=std::max(0.0,color[c]*mExposure);
+    result[c]=Math::clamp(encode(Math::clamp(toneMap(exposed,mToneMapping,mWhitePoint)),mEncoding,mGamma));
+  }
+  result[3]=Math::clamp(color[3]);
+  return result;
+}
+
+// Separable Gaussian blur of the colors above the threshold.
+static void computeBloom(const Image &source, double threshold, size_t radius, std::vector<Vec3f> &bloom)
+{
+  const int width=int(source.width()), height=int(source.height());
+  const int r=int(radius);
+  const double sigma=std::max(0.5,0.5*double(radius));
+  std::vector<float> weights(2*r+1);
+  double sum=0;
+  for (int k=-r;k<=r;++k)
+    sum+=weights[k+r]=float(std::exp(-0.5*k*k/(sigma*sigma)));
+  for (size_t k=0;k<weights.size();++k)
+    weights[k]=float(weights[k]/sum);
+
+  //bright pass and horizontal blur per row
+  std::vector<Vec3f> horizontal(size_t(width)*height);
+#pragma omp parallel
+  {
+    std::vector<Vec3f> bright(width);
+#pragma omp for schedule(dynamic,BlockRows)
+    for (int y=0;y<height;++y)
+    {
+      for (int x=0;x<width;++x)
+      {
+        const Vec4d &c=source.pixel(x,y);
+        bright[x]=Vec3f(float(std::max(0.0,c[0]-threshold)),float(std::max(0.0,c[1]-threshold)),
+                        float(std::max(0.0,c[2]-threshold)));
+      }
+      for (int x=0;x<width;++x)
+      {
+        Vec3f sum(0,0,0);
+        for (int k=-r;k<=r;++k)
+          sum+=bright[std::min(width-1,std::max(0,x+k))]*weights[k+r];
+        horizontal[size_t(y)*width+x]=sum;
+      }
+    }
+  }
+
+  //the vertical blur adds whole rows, so it reads contiguous memory as well
+  bloom.assign(size_t(width)*height,Vec3f(0,0,0));
+#pragma omp parallel for schedule(dynamic,BlockRows)
+  for (int y=0;y<height;++y)
+  {
+    Vec3f *out=&bloom[size_t(y)*width];
+    for (int k=-r;k<=r;++k)
+    {
+      const Vec3f *in=&horizontal[size_t(std::min(height-1,std::max(0,y+k)))*width];
+      const float w=weights[k+r];
+      for (int x=0;x<width;++x)
+        out[x]+=in[x]*w;
+    }
+  }
+}
+
+void PostProcess::apply(const Image &source, Image &target) const
+{
+  std::vector<Vec3f> bloom;
+  if (mBloomStrength > 0)
+    computeBloom(source,mBloomThreshold,mBloomRadius,bloom);
+
+  if (&target != &source && (target.width() != source.width() || target.height() != source.height()))
+    target.init(source.width(),source.height());
+
+  const int width=int(source.width()), height=int(source.height());
+#pragma omp parallel for schedule(dynamic,BlockRows)
+  for (int y=0;y<height;++y)
+    for (int x=0;x<width;++x)
+    {
+      Vec4d color=source.pixel(x,y);
+      if (!bloom.empty())
+      {
+        const Vec3f &b=bloom[size_t(y)*width+x];
+        for (int c=0;c<3;++c)
+          color[c]+=mBloomStrength*b[c];
+      }
+      Vec4d mapped=this->map(color);
+      target.setPixel(mapped,x,y);
+    }
+}
+
+} //namespace rt
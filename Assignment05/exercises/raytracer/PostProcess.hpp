@@ -0,0 +1,84 @@
+#ifndef POSTPROCESS_HPP_INCLUDE_ONCE
+#define POSTPROCESS_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include "Math.hpp"
+
+namespace rt {
+
+class Image;
+
+/// Maps rendered high dynamic range colors to displayable [0,1] values:
+/// optional bloom, exposure, tone mapping, and encoding for the display, in
+/// this order. Everything but the bloom blur is done in a single parallel
+/// pass over blocks of rows. The alpha channel is only clamped.
+///
+/// The default settings just clamp, which is what the image writers do.
+class PostProcess
+{
+public:
+  enum ToneMapping
+  {
+    Clamp,     ///< values above 1 are cut off
+    Reinhard,  ///< c*(1+c/w^2)/(1+c) with white point w
+    Filmic     ///< ACES filmic curve fit (Narkowicz)
+  };
+
+  enum Encoding
+  {
+    Linear,
+    Gamma,     ///< c^(1/gamma)
+    SRGB       ///< sRGB transfer function
+  };
+
+  RAYTRACER_EXPORTS PostProcess();
+
+  /// Factor applied to all colors before tone mapping.
+  RAYTRACER_EXPORTS void setExposure(double exposure) { mExposure=exposure; }
+  RAYTRACER_EXPORTS double exposure() const { return mExposure; }
+
+  /// The white point is the smallest exposed value mapped to 1 by Reinhard.
+  RAYTRACER_EXPORTS void setToneMapping(ToneMapping toneMapping, double whitePoint=1e10)
+  {
+    mToneMapping=toneMapping;
+    mWhitePoint=whitePoint;
+  }
+
+  RAYTRACER_EXPORTS void setEncoding(Encoding encoding, double gamma=2.2)
+  {
+    mEncoding=encoding;
+    mGamma=gamma;
+  }
+
+  /// Adds the parts of the colors above threshold, blurred by a Gaussian with
+  /// the given radius in pixels and scaled by strength. 0 disables the bloom.
+  RAYTRACER_EXPORTS void setBloom(double strength, double threshold=1.0, size_t radius=8)
+  {
+    mBloomStrength=strength;
+    mBloomThreshold=threshold;
+    mBloomRadius=radius;
+  }
+
+  /// Writes the processed source to target, which is resized if needed and
+  /// may be the source itself. Keeping the source allows to try different
+  /// settings without rendering again.
+  RAYTRACER_EXPORTS void apply(const Image &source, Image &target) const;
+
+  /// Processes a single color without bloom.
+  RAYTRACER_EXPORTS Vec4d map(const Vec4d &color) const;
+
+private:
+  double      mExposure;
+  ToneMapping mToneMapping;
+  double      mWhitePoint;
+  Encoding    mEncoding;
+  double      mGamma;
+  double      mBloomStrength;
+  double      mBloomThreshold;
+  size_t      mBloomRadius;
+};
+
+} //namespace rt
+
+#endif //POSTPROCESS_HPP_INCLUDE_ONCE
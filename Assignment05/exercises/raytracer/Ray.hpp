@@ -12,37 +12,55 @@ namespace rt
 
 class Renderable;
 
-/// Ray consists of point and direction
+/// Ray consists of point and direction. It optionally carries a cone that
+/// describes the footprint of the ray, e.g. of a pixel, which is used to
+/// select levels of detail. By default the cone is empty.
 class Ray
 {
 public:
-  RAYTRACER_EXPORTS Ray() : mOrigin(0.0,0.0,0.0), mDirection(0.0,0.0,0.0) {}
+  RAYTRACER_EXPORTS Ray() : mOrigin(0.0,0.0,0.0), mDirection(0.0,0.0,0.0), mConeWidth(0), mConeSpread(0) {}
   RAYTRACER_EXPORTS Ray(const Vec3d &origin, const Vec3d &direction) :
-    mOrigin(origin), mDirection(Vec3d(direction).normalize())  {}
+    mOrigin(origin), mDirection(Vec3d(direction).normalize()), mConeWidth(0), mConeSpread(0)  {}
 
   RAYTRACER_EXPORTS Vec3d pointOnRay(double lambda) const { return mOrigin + mDirection*lambda; }
 
+  /// Sets the cone by its width at the origin and its growth per unit distance.
+  RAYTRACER_EXPORTS void setCone(double width, double spread) { mConeWidth=width; mConeSpread=spread; }
+  RAYTRACER_EXPORTS double coneWidth()  const { return mConeWidth; }
+  RAYTRACER_EXPORTS double coneSpread() const { return mConeSpread; }
+
+  /// Width of the cone at distance lambda.
+  RAYTRACER_EXPORTS double footprint(double lambda) const { return mConeWidth + mConeSpread*lambda; }
+
   RAYTRACER_EXPORTS const Vec3d& origin()    const { return mOrigin; }
   RAYTRACER_EXPORTS const Vec3d& direction() const { return mDirection; }
 
   RAYTRACER_EXPORTS void setOrigin(const Vec3d& origin)       { mOrigin=origin; }
   RAYTRACER_EXPORTS void setDirection(const Vec3d& direction) { mDirection=Vec3d(direction).normalize(); }
 
+  /// Distances along the ray are scaled by the transformation, so is the
+  /// width of the cone, while its spread is an angle and stays the same.
   RAYTRACER_EXPORTS void transform(const Mat4x4d &transform)
   {
-    mOrigin    = transform*mOrigin;
-    mDirection = (transform.as3x3()*mDirection).normalize();
+    const Vec3d direction = transform.as3x3()*mDirection;
+    mOrigin     = transform*mOrigin;
+    mDirection  = Vec3d(direction).normalize();
+    mConeWidth *= direction.length();
   }
 
   RAYTRACER_EXPORTS Ray transformed(const Mat4x4d &transform) const
   {
-    return Ray(transform*mOrigin,
-               (transform.as3x3()*mDirection).normalize());
+    const Vec3d direction = transform.as3x3()*mDirection;
+    Ray ray(transform*mOrigin,direction);
+    ray.setCone(mConeWidth*direction.length(),mConeSpread);
+    return ray;
   }
 
 private:
   Vec3d mOrigin;
   Vec3d mDirection;
+  double mConeWidth;   //!< width of the cone at the origin
+  double mConeSpread;  //!< increase of the width per unit distance
 };
 
 ///////////////////////////////////////////////////////////////////////////////
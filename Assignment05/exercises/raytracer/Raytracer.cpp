@@ -1,13 +1,22 @@
 #include "Raytracer.hpp"
 #include "Scene.hpp"
 #include "Image.hpp"
+#include "Framebuffer.hpp"
+#include "FeatureBuffer.hpp"
+#include "StreamingFramebuffer.hpp"
+#include "RenderCheckpoint.hpp"
 #include "Camera.hpp"
 #include "Light.hpp"
 #include "Renderable.hpp"
+#include "LODTriangleMesh.hpp"
 #include "Material.hpp"
 #include "Math.hpp"
 #include "Image.hpp"
 
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
 namespace rt
 {
 
@@ -19,7 +28,8 @@ Raytracer::~Raytracer()
 {
 }
 
-void Raytracer::renderToImage(std::shared_ptr<Image> image) const
+void Raytracer::renderToImage(std::shared_ptr<Image> image, std::shared_ptr<FeatureBuffer> features,
+                              const CropWindow &crop) const
 {
   if(!mScene)
     return;
@@ -27,10 +37,30 @@ void Raytracer::renderToImage(std::shared_ptr<Image> image) const
   if(!mScene->camera())
     return;
 
-  mScene->prepareScene();
+  if(!crop.empty() && !crop.valid())
+  {
+    std::cerr<<"Error: Crop window ("<<crop.x<<","<<crop.y<<","<<crop.width<<","<<crop.height
+             <<") is not inside the frame ("<<crop.frameWidth<<","<<crop.frameHeight<<")"<<std::endl;
+    return;
+  }
 
+  //the resolution is set first, view-dependent geometry may need it
   Camera &camera = *(mScene->camera().get());
-  camera.setResolution(image->width(),image->height());
+  if(crop.empty())
+    camera.setResolution(image->width(),image->height());
+  else
+  {
+    camera.setResolution(crop.frameWidth,crop.frameHeight);
+    if(image->width() != crop.width || image->height() != crop.height)
+      image->init(crop.width,crop.height);
+  }
+  const size_t x0 = crop.empty() ? 0 : crop.x;
+  const size_t y0 = crop.empty() ? 0 : crop.y;
+
+  mScene->prepareScene();
+
+  if(features && (features->width() != image->width() || features->height() != image->height()))
+    features->init(image->width(),image->height());
 
 #ifdef NDEBUG
 #pragma omp parallel for schedule(dynamic,16) //collapse(2)
@@ -38,22 +68,188 @@ void Raytracer::renderToImage(std::shared_ptr<Image> image) const
   for(int y=0;y<(int)(image->height());++y)
     for(int x=0;x<(int)(image->width());++x)
     {
-      // ray shot from camera position through camera pixel into scene
-      const Ray ray = camera.ray(x,y);
+      // ray shot from camera position through camera pixel into scene,
+      // a crop window only shifts the pixel within the full frame
+      const Ray ray = camera.ray(x0+x,y0+y);
 
-      // call recursive raytracing function
-      Vec4d color = this->trace(ray,0);
+      // call recursive raytracing function, which also returns the first hit for its features
+      Vec4d color;
+      RayIntersection intersection;
+      const bool hit = this->trace(ray,0,color,intersection);
+      if(features && hit)
+        features->setFeatures(x,y,intersection.normal(),intersection.lambda(),
+                              intersection.renderable()->material()->albedo(intersection));
+      else if(features)
+        features->setBackground(x,y);
       image->setPixel(color,x,y);
     }
 }
 
+bool Raytracer::renderToFramebuffer(std::shared_ptr<Framebuffer> framebuffer,
+                                    const TileCallback &tileDone) const
+{
+  if(!mScene)
+    return false;
+
+  if(!mScene->camera())
+    return false;
+
+  Camera &camera = *(mScene->camera().get());
+  camera.setResolution(framebuffer->width(),framebuffer->height());
+
+  mScene->prepareScene();
+
+  return this->renderTiles(camera,*framebuffer,0,tileDone);
+}
+
+bool Raytracer::renderWithCheckpoints(std::shared_ptr<Framebuffer> framebuffer,
+                                      const std::string &checkpointPath,
+                                      double intervalSeconds,
+                                      const TileCallback &tileDone) const
+{
+  if(!mScene)
+    return false;
+
+  if(!mScene->camera())
+    return false;
+
+  Camera &camera = *(mScene->camera().get());
+  camera.setResolution(framebuffer->width(),framebuffer->height());
+
+  mScene->prepareScene();
+
+  //a checkpoint of another view or scene must not be mixed into this one, the
+  //scene fingerprint is split into halves that a double holds exactly
+  RenderCheckpoint checkpoint(checkpointPath);
+  const Vec3d &position = camera.position(), &lookAt = camera.lookAt(), &up = camera.up();
+  const unsigned long long fingerprint = mScene->fingerprint();
+  const double setup[] = { position[0], position[1], position[2], lookAt[0], lookAt[1], lookAt[2],
+                           up[0], up[1], up[2], camera.horizontalFOV(), camera.verticalFOV(),
+                           double(mMaxDepth), double(fingerprint>>32), double(fingerprint&0xffffffffull) };
+  checkpoint.setSetup(std::vector<double>(setup,setup+sizeof(setup)/sizeof(setup[0])));
+
+  std::vector<unsigned char> finished(framebuffer->numTiles(),0);
+  if(checkpoint.load(*framebuffer,finished))
+  {
+    size_t numFinished = 0;
+    for(size_t i=0;i<finished.size();++i)
+      numFinished += finished[i];
+    std::cout<<"Resuming from "<<checkpointPath<<" with "<<numFinished<<" of "<<finished.size()<<" tiles"<<std::endl;
+  }
+  const std::vector<unsigned char> restored = finished;
+
+  //one thread saves while the others keep rendering. It must not read the
+  //framebuffer they write to, so it saves a copy that only receives the tiles
+  //flagged as finished under the mutex, which are no longer written
+  std::mutex finishedMutex;
+  Chrono lastSave = std::chrono::high_resolution_clock::now();
+  bool saving = false;
+  Framebuffer savedTiles(*framebuffer);
+  std::vector<unsigned char> copied = restored;
+  auto checkpointTile = [&](size_t tile)
+  {
+    const bool proceed = !tileDone || tileDone(tile);
+    std::vector<unsigned char> snapshot;
+    {
+      std::lock_guard<std::mutex> lock(finishedMutex);
+      finished[tile] = 1;
+      const Chrono now = std::chrono::high_resolution_clock::now();
+      if(saving || std::chrono::duration_cast<ChronoDuration>(now-lastSave).count() < intervalSeconds)
+        return proceed;
+      saving = true;
+      snapshot = finished;
+    }
+    std::vector<unsigned char> newTiles(snapshot.size(),0);
+    for(size_t i=0;i<snapshot.size();++i)
+      newTiles[i] = snapshot[i] && !copied[i];
+    savedTiles.copyTiles(*framebuffer,newTiles);
+    copied.swap(snapshot);
+    checkpoint.save(savedTiles,copied);
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    lastSave = std::chrono::high_resolution_clock::now();
+    saving = false;
+    return proceed;
+  };
+
+  if(!this->renderTiles(camera,*framebuffer,0,checkpointTile,&restored))
+  {
+    checkpoint.save(*framebuffer,finished);
+    return false;
+  }
+  checkpoint.remove();
+  return true;
+}
+
+bool Raytracer::renderToStream(std::shared_ptr<StreamingFramebuffer> stream) const
+{
+  if(!mScene)
+    return false;
+
+  if(!mScene->camera())
+    return false;
+
+  Camera &camera = *(mScene->camera().get());
+  camera.setResolution(stream->width(),stream->height());
+
+  mScene->prepareScene();
+
+  //only the band being rendered is kept in memory
+  bool written = true;
+  while(written && stream->nextBand() < stream->numBands())
+  {
+    this->renderTiles(camera,stream->band(),stream->bandOriginY(stream->nextBand()));
+    written = stream->writeBand();
+  }
+  return stream->close() && written;
+}
+
+bool Raytracer::renderTiles(const Camera &camera, Framebuffer &framebuffer, size_t originY,
+                            const TileCallback &tileDone,
+                            const std::vector<unsigned char> *skipTiles) const
+{
+  //an OpenMP loop cannot be left early, so cancelled tiles are skipped
+  std::atomic<bool> cancelled(false);
+
+  //a tile is written by a single thread and covers whole cache lines, so no cache lines are shared
+#ifdef NDEBUG
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+  for(int tile=0;tile<(int)(framebuffer.numTiles());++tile)
+  {
+    if(cancelled.load(std::memory_order_relaxed) || (skipTiles && (*skipTiles)[tile]))
+      continue;
+    const size_t x0 = framebuffer.tileOriginX(tile);
+    const size_t y0 = framebuffer.tileOriginY(tile);
+    for(size_t y=0;y<Framebuffer::TileSize && y0+y<framebuffer.height();++y)
+      for(size_t x=0;x<Framebuffer::TileSize && x0+x<framebuffer.width();++x)
+      {
+        const Ray ray = camera.ray(x0+x,originY+y0+y);
+        framebuffer.setTilePixel(this->trace(ray,0),tile,x,y);
+      }
+    if(tileDone && !tileDone(size_t(tile)))
+      cancelled.store(true,std::memory_order_relaxed);
+  }
+  return !cancelled.load();
+}
+
 Vec4d Raytracer::trace(const Ray &ray, size_t depth) const
 {
+  Vec4d color;
   RayIntersection intersection;
+  this->trace(ray,depth,color,intersection);
+  return color;
+}
+
+bool Raytracer::trace(const Ray &ray, size_t depth, Vec4d &color, RayIntersection &intersection) const
+{
   if (mScene->closestIntersection(ray,intersection))
-    return this->shade(intersection, depth);
+  {
+    color = this->shade(intersection, depth);
+    return true;
+  }
 
-  return mScene->backgroundColor();
+  color = mScene->backgroundColor();
+  return false;
 }
 
 Vec4d Raytracer::shade(const RayIntersection& intersection,
@@ -67,16 +263,26 @@ Vec4d Raytracer::shade(const RayIntersection& intersection,
   std::shared_ptr<const Renderable> renderable = intersection.renderable();
   std::shared_ptr<const Material>   material   = renderable->material();
 
+  // Width of the ray cone at the hit point, detail below it is not resolved
+  const double footprint = intersection.ray().footprint(intersection.lambda());
+
+  // A coarser level of detail of the hit surface may lie up to the footprint
+  // above the hit point, so shadow rays towards it stop short by the footprint
+  const double shadowBias =
+    std::dynamic_pointer_cast<const LODTriangleMesh>(renderable) ? footprint : 0.0;
+
   for(size_t i=0;i <mScene->lights().size();++i)
   {
     const Light &light = *(mScene->lights()[i].get());
 
-    //Shadow ray from light to hit point.
+    //Shadow ray from light to hit point. Its cone reaches the footprint at the
+    //hit point and only selects the level of detail of the meshes it passes.
     const Vec3d L = (intersection.position() + offset) - light.position();
-    const Ray shadowRay(light.position(), L);
+    Ray shadowRay(light.position(), L);
+    shadowRay.setCone(0, footprint/L.length());
 
     //Shade only if light in visible from intersection point.
-    if (!mScene->anyIntersection(shadowRay,L.length()))
+    if (!mScene->anyIntersection(shadowRay,L.length()-shadowBias))
       color += material->shade(intersection,light);
   }
 
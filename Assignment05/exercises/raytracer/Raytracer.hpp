@@ -6,8 +6,10 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <functional>
 
 #include "Math.hpp"
+#include "Camera.hpp"
 
 namespace rt
 {
@@ -16,6 +18,9 @@ class Scene;
 class Ray;
 class RayIntersection;
 class Image;
+class Framebuffer;
+class FeatureBuffer;
+class StreamingFramebuffer;
 
 /// Performs recursive raytracing.
 class Raytracer
@@ -27,8 +32,42 @@ public:
   /// The scene contains all Renderables, Lights, and a Camera.
   RAYTRACER_EXPORTS void setScene(std::shared_ptr<Scene> scene) { mScene=scene; }
 
-  /// Writes RGBA values to an image.
-  RAYTRACER_EXPORTS void renderToImage(std::shared_ptr<Image> image) const;
+  /// Writes RGBA values to an image. If a feature buffer is given, it
+  /// receives the normal, depth and albedo of the first hit of every pixel.
+  /// With a crop window only its pixels of the full frame are traced, with
+  /// the same rays as for the full frame. The image and the feature buffer
+  /// are then resized to the window, their pixel 0,0 is its corner x,y.
+  RAYTRACER_EXPORTS void renderToImage(std::shared_ptr<Image> image,
+                                       std::shared_ptr<FeatureBuffer> features=nullptr,
+                                       const CropWindow &crop=CropWindow()) const;
+
+  /// Called from the render threads with the index of each finished tile.
+  /// Returning false cancels the tiles that have not been started yet.
+  typedef std::function<bool(size_t tile)> TileCallback;
+
+  /// Writes RGBA values to a framebuffer, every thread renders whole tiles.
+  /// Returns false if the render was cancelled by the tile callback.
+  RAYTRACER_EXPORTS bool renderToFramebuffer(std::shared_ptr<Framebuffer> framebuffer,
+                                             const TileCallback &tileDone=TileCallback()) const;
+
+  /// Like renderToFramebuffer(), but saves the progress to a RenderCheckpoint
+  /// at checkpointPath whenever intervalSeconds have passed since the last
+  /// save, and when the tile callback cancels. If a checkpoint of the same
+  /// framebuffer size, format, camera, recursion depth and scene (see
+  /// Scene::fingerprint()) exists, its finished tiles are restored and only
+  /// the others are rendered. Every pixel is traced independently of the
+  /// others, so the result is bit-identical to an uninterrupted render. The
+  /// finished tiles are saved from a copy, which takes the memory of a second
+  /// framebuffer. The checkpoint is deleted once all tiles are done.
+  RAYTRACER_EXPORTS bool renderWithCheckpoints(std::shared_ptr<Framebuffer> framebuffer,
+                                               const std::string &checkpointPath,
+                                               double intervalSeconds=300,
+                                               const TileCallback &tileDone=TileCallback()) const;
+
+  /// Renders the bands of an opened streaming framebuffer one after the other
+  /// and writes each to its file, which is closed afterwards. Returns false if
+  /// writing failed.
+  RAYTRACER_EXPORTS bool renderToStream(std::shared_ptr<StreamingFramebuffer> stream) const;
 
 protected:
 
@@ -36,11 +75,23 @@ protected:
   RAYTRACER_EXPORTS Vec4d trace(const Ray &ray,
              size_t depth) const;
 
+  /// Traces a ray like trace() and also returns the closest intersection,
+  /// e.g. to record its features. Returns false for the background.
+  RAYTRACER_EXPORTS bool trace(const Ray &ray, size_t depth,
+                               Vec4d &color, RayIntersection &intersection) const;
+
   /// Determines the color of an intersection point.
   RAYTRACER_EXPORTS Vec4d shade(const RayIntersection& intersection,
              size_t depth) const;
 
 private:
+  /// Renders all tiles of the framebuffer, its row 0 is image row originY.
+  /// Tiles flagged in skipTiles are left as they are. Returns false if the
+  /// tile callback cancelled the render.
+  bool renderTiles(const Camera &camera, Framebuffer &framebuffer, size_t originY,
+                   const TileCallback &tileDone=TileCallback(),
+                   const std::vector<unsigned char> *skipTiles=nullptr) const;
+
   size_t mMaxDepth;              ///< Maximum number of ray indirections.
   std::shared_ptr<Scene> mScene;
 };
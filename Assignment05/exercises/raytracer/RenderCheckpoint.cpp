@@ -0,0 +1,134 @@
+#include "RenderCheckpoint.hpp"
+#include "Framebuffer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace rt
+{
+
+static const char     RenderCheckpointMagic[8]  = {'C','G','R','C','K','P','T',0};
+static const uint32_t RenderCheckpointByteOrder = 0x01020304u;
+static const uint32_t RenderCheckpointVersion   = 1;
+
+struct RenderCheckpointHeader
+{
+  char     magic[8];
+  uint32_t byteOrder;
+  uint32_t version;
+  uint64_t width;
+  uint64_t height;
+  uint64_t format;
+  uint64_t tileSize;
+  uint64_t numSetupValues;
+  uint64_t numTiles;
+  uint64_t dataSize;
+};
+
+bool RenderCheckpoint::load(Framebuffer &framebuffer, std::vector<unsigned char> &finishedTiles) const
+{
+  //no checkpoint is the regular start of a new render, no message
+  std::ifstream in(mPath, std::ios::binary | std::ios::in);
+  if (!in.is_open())
+    return false;
+
+  RenderCheckpointHeader header;
+  if (!in.read((char*)&header,sizeof(header)) ||
+      memcmp(header.magic,RenderCheckpointMagic,sizeof(RenderCheckpointMagic)) != 0 ||
+      header.byteOrder != RenderCheckpointByteOrder || header.version != RenderCheckpointVersion)
+  {
+    std::cerr<<"Warning: "<<mPath<<" is not a render checkpoint"<<std::endl;
+    return false;
+  }
+
+  std::vector<double> setup(mSetup.size());
+  const bool sameFramebuffer = header.width == framebuffer.width() && header.height == framebuffer.height() &&
+                               header.format == uint64_t(framebuffer.format()) &&
+                               header.tileSize == Framebuffer::TileSize &&
+                               header.numTiles == framebuffer.numTiles() &&
+                               header.dataSize == framebuffer.memoryUsage();
+  if (!sameFramebuffer || header.numSetupValues != mSetup.size() ||
+      (!setup.empty() && !in.read((char*)&setup[0],std::streamsize(setup.size()*sizeof(double)))) ||
+      setup != mSetup)
+  {
+    std::cerr<<"Warning: Render checkpoint "<<mPath<<" belongs to another render and is ignored"<<std::endl;
+    return false;
+  }
+
+  //if the data is truncated no tile counts as finished, so the partly read pixels are rendered again
+  std::vector<unsigned char> flags(header.numTiles);
+  if (!in.read((char*)&flags[0],std::streamsize(flags.size())) ||
+      !in.read((char*)framebuffer.data(),std::streamsize(header.dataSize)))
+  {
+    std::cerr<<"Warning: Render checkpoint "<<mPath<<" is truncated"<<std::endl;
+    return false;
+  }
+  finishedTiles.swap(flags);
+  return true;
+}
+
+bool RenderCheckpoint::save(const Framebuffer &framebuffer, const std::vector<unsigned char> &finishedTiles) const
+{
+  if (finishedTiles.size() != framebuffer.numTiles())
+  {
+    std::cerr<<"Error: "<<finishedTiles.size()<<" tile flags for "<<framebuffer.numTiles()<<" tiles"<<std::endl;
+    return false;
+  }
+
+  RenderCheckpointHeader header;
+  memcpy(header.magic,RenderCheckpointMagic,sizeof(RenderCheckpointMagic));
+  header.byteOrder      = RenderCheckpointByteOrder;
+  header.version        = RenderCheckpointVersion;
+  header.width          = framebuffer.width();
+  header.height         = framebuffer.height();
+  header.format         = uint64_t(framebuffer.format());
+  header.tileSize       = Framebuffer::TileSize;
+  header.numSetupValues = mSetup.size();
+  header.numTiles       = framebuffer.numTiles();
+  header.dataSize       = framebuffer.memoryUsage();
+
+  const std::string temporaryPath = mPath + ".tmp";
+  {
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!out.is_open())
+    {
+      std::cerr<<"Error: Could not write render checkpoint "<<temporaryPath<<std::endl;
+      return false;
+    }
+    out.write((const char*)&header,sizeof(header));
+    if (!mSetup.empty())
+      out.write((const char*)&mSetup[0],std::streamsize(mSetup.size()*sizeof(double)));
+    out.write((const char*)&finishedTiles[0],std::streamsize(finishedTiles.size()));
+    out.write((const char*)framebuffer.data(),std::streamsize(header.dataSize));
+    out.flush();
+    if (!out)
+    {
+      out.close();
+      std::remove(temporaryPath.c_str());
+      std::cerr<<"Error: Could not write render checkpoint "<<temporaryPath<<std::endl;
+      return false;
+    }
+  }
+
+  //renaming replaces the old checkpoint at once, Windows cannot rename onto an existing file
+#if defined(_WIN32)
+  std::remove(mPath.c_str());
+#endif
+  if (std::rename(temporaryPath.c_str(),mPath.c_str()) != 0)
+  {
+    std::remove(temporaryPath.c_str());
+    std::cerr<<"Error: Could not replace render checkpoint "<<mPath<<std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool RenderCheckpoint::remove() const
+{
+  return std::remove(mPath.c_str()) == 0;
+}
+
+} //namespace rt
@@ -0,0 +1,50 @@
+#ifndef RENDERCHECKPOINT_HPP_INCLUDE_ONCE
+#define RENDERCHECKPOINT_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <string>
+#include <vector>
+
+namespace rt
+{
+
+class Framebuffer;
+
+/// Progress of a tiled render on disk, so that an interrupted job can be
+/// resumed (see Raytracer::renderWithCheckpoints()). A checkpoint stores the
+/// raw framebuffer tiles, a flag per finished tile and values describing the
+/// render setup. Every save goes to a temporary file that then replaces the
+/// previous checkpoint, so an interruption while saving keeps the old one.
+class RenderCheckpoint
+{
+public:
+  RAYTRACER_EXPORTS explicit RenderCheckpoint(const std::string &path) : mPath(path) {}
+
+  RAYTRACER_EXPORTS const std::string& path() const { return mPath; }
+
+  /// Values describing the render setup, e.g. the camera, the recursion
+  /// depth and a scene fingerprint. A checkpoint is only loaded if they equal
+  /// the saved ones.
+  RAYTRACER_EXPORTS void setSetup(const std::vector<double> &setup) { mSetup=setup; }
+
+  /// Restores the tiles and finished flags into an initialized framebuffer.
+  /// Returns false without a message if there is no checkpoint, and with a
+  /// warning if it belongs to another framebuffer size, format or setup.
+  RAYTRACER_EXPORTS bool load(Framebuffer &framebuffer, std::vector<unsigned char> &finishedTiles) const;
+
+  /// Writes the framebuffer with one flag per tile, only flagged tiles are
+  /// restored by load().
+  RAYTRACER_EXPORTS bool save(const Framebuffer &framebuffer, const std::vector<unsigned char> &finishedTiles) const;
+
+  /// Deletes the checkpoint file.
+  RAYTRACER_EXPORTS bool remove() const;
+
+private:
+  std::string mPath;
+  std::vector<double> mSetup;
+};
+
+} //namespace rt
+
+#endif //RENDERCHECKPOINT_HPP_INCLUDE_ONCE
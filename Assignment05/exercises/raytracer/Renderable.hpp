@@ -37,6 +37,7 @@ public:
     mTransformClean = false;
     return mTransform;
   }
+  RAYTRACER_EXPORTS const Mat4x4d& transform() const { return mTransform; }
 
   // Gets the material.
   RAYTRACER_EXPORTS std::shared_ptr<const Material> material() const { return mMaterial; }
@@ -45,6 +46,8 @@ public:
 
   // Recomputes the bounding box.
   RAYTRACER_EXPORTS void updateBoundingBox() { mBoundingBox = this->computeBoundingBox();}
+  // Gets the bounding box in model coordinates as of the last update.
+  RAYTRACER_EXPORTS const BoundingBox& boundingBox() const { return mBoundingBox; }
 
   // Override this method for pre-render initialization
   RAYTRACER_EXPORTS virtual void initialize() {} 
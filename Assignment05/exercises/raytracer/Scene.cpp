@@ -1,7 +1,14 @@
 #include "Scene.hpp"
 #include "Camera.hpp"
 #include "Image.hpp"
+#include "Light.hpp"
+#include "Material.hpp"
+#include "PhongMaterial.hpp"
+#include "IndexedTriangleMesh.hpp"
+#include "LODTriangleMesh.hpp"
 #include <algorithm>
+#include <typeinfo>
+#include <cstring>
 
 namespace rt
 {
@@ -59,4 +66,74 @@ void Scene::prepareScene()
   }
 }
 
+// FNV-1a over the bytes of the hashed values
+class SceneHash
+{
+public:
+  SceneHash() : mHash(14695981039346656037ull) {}
+
+  void add(const void *data, size_t size)
+  {
+    const unsigned char *bytes=(const unsigned char*)data;
+    for(size_t i=0;i<size;++i)
+      mHash=(mHash^bytes[i])*1099511628211ull;
+  }
+  void add(double value) { this->add(&value,sizeof(value)); }
+  void add(const Vec3d &v) { this->add(v[0]); this->add(v[1]); this->add(v[2]); }
+  void add(const char *name) { this->add(name,strlen(name)+1); }
+
+  unsigned long long value() const { return mHash; }
+
+private:
+  unsigned long long mHash;
+};
+
+unsigned long long Scene::fingerprint() const
+{
+  SceneHash hash;
+  for(size_t c=0;c<4;++c)
+    hash.add(mBackgroundColor[c]);
+
+  for(size_t i=0;i<mLights.size();++i)
+  {
+    hash.add(mLights[i]->position());
+    hash.add(mLights[i]->spectralIntensity());
+  }
+
+  for(size_t i=0;i<mRenderables.size();++i)
+  {
+    const Renderable &renderable=*mRenderables[i];
+    hash.add(typeid(renderable).name());
+    hash.add(renderable.transform().ptr(),16*sizeof(double));
+
+    //the model space bounds and the mesh sizes stand in for the geometry
+    hash.add(renderable.boundingBox().min());
+    hash.add(renderable.boundingBox().max());
+    const IndexedTriangleMesh *mesh=dynamic_cast<const IndexedTriangleMesh*>(&renderable);
+    if(mesh)
+    {
+      hash.add(double(mesh->numVertices()));
+      hash.add(double(mesh->triangleIndices().size()));
+    }
+    const LODTriangleMesh *lodMesh=dynamic_cast<const LODTriangleMesh*>(&renderable);
+    if(lodMesh)
+    {
+      hash.add(double(lodMesh->numLevels()));
+      hash.add(lodMesh->errorTolerance());
+    }
+
+    std::shared_ptr<const Material> material=renderable.material();
+    if(material)
+    {
+      hash.add(typeid(*material).name());
+      hash.add(material->color());
+      hash.add(material->reflectance());
+      std::shared_ptr<const PhongMaterial> phong=std::dynamic_pointer_cast<const PhongMaterial>(material);
+      if(phong)
+        hash.add(phong->shininess());
+    }
+  }
+  return hash.value();
 }
+
+} //namespace rt
@@ -37,6 +37,9 @@ public:
   /// Returns a vector containing all lights in the scene.
   RAYTRACER_EXPORTS const std::vector<std::shared_ptr<Light>>& lights() const { return mLights; }
 
+  /// Returns a vector containing all geometry in the scene.
+  RAYTRACER_EXPORTS const std::vector<std::shared_ptr<Renderable>>& renderables() const { return mRenderables; }
+
   /// Computes the closest intersection of a ray and any object in scene.
   RAYTRACER_EXPORTS bool
   closestIntersection(const Ray &ray, RayIntersection& intersection,
@@ -55,6 +58,13 @@ public:
   //prepare scene for rendering
   RAYTRACER_EXPORTS void prepareScene();
 
+  /// Hash of the renderable transforms, materials and geometry sizes, the
+  /// lights and the background, e.g. to recognize a render of another scene.
+  /// The geometry is described by the bounding boxes of prepareScene() and
+  /// the mesh sizes. Not stable across builds, as the class names of the
+  /// compiler are hashed.
+  RAYTRACER_EXPORTS unsigned long long fingerprint() const;
+
 private:
   Vec4d mBackgroundColor;
 
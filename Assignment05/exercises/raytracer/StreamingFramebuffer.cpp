@@ -0,0 +1,135 @@
+#include "StreamingFramebuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace rt {
+
+StreamingFramebuffer::StreamingFramebuffer() : mFileFormat(TGA), mWidth(0), mHeight(0), mNextBand(0)
+{
+}
+
+StreamingFramebuffer::~StreamingFramebuffer()
+{
+  if (mFile.is_open())
+    this->close();
+}
+
+static bool hasSuffix(const std::string &fileName, const std::string &suffix)
+{
+  std::string lower(fileName);
+  std::transform(lower.begin(),lower.end(),lower.begin(),::tolower);
+  return lower.size() >= suffix.size() && std::equal(suffix.rbegin(),suffix.rend(),lower.rbegin());
+}
+
+bool StreamingFramebuffer::open(const std::string &fileName, size_t width, size_t height, size_t bandTileRows)
+{
+  if (mFile.is_open())
+    this->close();
+
+  if (width<1 || height<1 || bandTileRows<1)
+  {
+    std::cerr<<"Error: Invalid streaming framebuffer size ("<<width<<","<<height<<")"<<std::endl;
+    return false;
+  }
+
+  //add .tga file extension if no supported one is present
+  std::string outName(fileName);
+  mFileFormat = hasSuffix(fileName,".pfm") ? PFM : TGA;
+  if (mFileFormat == TGA && !hasSuffix(fileName,".tga"))
+    outName+=".tga";
+
+  if (mFileFormat == TGA && (width>0xFFFF || height>0xFFFF))
+  {
+    std::cerr<<"Error: TGA images are limited to 65535 pixels per side, use PFM for "<<outName<<std::endl;
+    return false;
+  }
+
+  mFile.open(outName, std::ios::binary | std::ios::out);
+  if (!mFile.is_open())
+  {
+    std::cerr<<"Error: Could not open file "<<outName<<std::endl;
+    return false;
+  }
+
+  mWidth=width;
+  mHeight=height;
+  mNextBand=0;
+  mBand.init(width,std::min(height,bandTileRows*Framebuffer::TileSize));
+
+  if (mFileFormat == TGA)
+  {
+    //uncompressed 32 bit BGRA with the origin at the lower left, as in Image::saveToTGA
+    const unsigned char header[18] = {0,0,2, 0,0,0,0,0, 0,0,0,0,
+                                      (unsigned char)(width & 0xFF),(unsigned char)((width >> 8) & 0xFF),
+                                      (unsigned char)(height & 0xFF),(unsigned char)((height >> 8) & 0xFF),
+                                      32,0};
+    mFile.write((const char*)header,sizeof(header));
+    mRow.resize(4*width);
+  }
+  else
+  {
+    //negative scale denotes little endian floats, rows are stored bottom to top
+    std::ostringstream header;
+    header<<"PF\n"<<width<<" "<<height<<"\n-1.0\n";
+    mFile<<header.str();
+    mRow.resize(3*sizeof(float)*width);
+  }
+
+  return mFile.good();
+}
+
+bool StreamingFramebuffer::writeBand()
+{
+  if (!mFile.is_open() || mNextBand >= this->numBands())
+    return false;
+
+  const size_t rows = this->bandRows(mNextBand);
+  for (size_t y=0;y<rows;++y)
+  {
+    if (mFileFormat == TGA)
+    {
+      for (size_t x=0;x<mWidth;++x)
+      {
+        const Vec4d rgba = mBand.pixel(x,y);
+        mRow[4*x+0] = (char)(unsigned char)(Math::clamp(rgba[2])*255);
+        mRow[4*x+1] = (char)(unsigned char)(Math::clamp(rgba[1])*255);
+        mRow[4*x+2] = (char)(unsigned char)(Math::clamp(rgba[0])*255);
+        mRow[4*x+3] = (char)(unsigned char)(Math::clamp(rgba[3])*255);
+      }
+    }
+    else
+    {
+      for (size_t x=0;x<mWidth;++x)
+      {
+        const Vec4d rgba = mBand.pixel(x,y);
+        const float rgb[3] = {float(rgba[0]),float(rgba[1]),float(rgba[2])};
+        std::memcpy(&mRow[3*sizeof(float)*x],rgb,sizeof(rgb));
+      }
+    }
+    mFile.write(&mRow[0],std::streamsize(mRow.size()));
+  }
+
+  ++mNextBand;
+  return mFile.good();
+}
+
+bool StreamingFramebuffer::close()
+{
+  if (!mFile.is_open())
+    return false;
+
+  const bool complete = mNextBand == this->numBands();
+  if (!complete)
+    std::cerr<<"Warning: Streaming framebuffer closed after "<<mNextBand<<" of "<<this->numBands()<<" bands"<<std::endl;
+
+  mFile.close();
+  const bool good = !mFile.fail();
+  mBand = Framebuffer();
+  std::vector<char>().swap(mRow);
+  return complete && good;
+}
+
+} //namespace rt
@@ -0,0 +1,78 @@
+#ifndef STREAMINGFRAMEBUFFER_HPP_INCLUDE_ONCE
+#define STREAMINGFRAMEBUFFER_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include "Framebuffer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+namespace rt {
+
+/// Render target for images too large to be kept in memory. The image is
+/// rendered in horizontal bands of whole tile rows into a Framebuffer that
+/// is reused for every band, and each finished band is appended to the
+/// output file. Peak memory is one band, width x bandHeight() pixels,
+/// independent of the image height.
+///
+/// The file is written as 32 bit TGA like Image::saveToTGA(), or as a
+/// floating point RGB PFM if the file name ends with ".pfm". Both store
+/// the first image row first, so no row has to be held back.
+class StreamingFramebuffer
+{
+public:
+  enum FileFormat
+  {
+    TGA,
+    PFM
+  };
+
+  RAYTRACER_EXPORTS StreamingFramebuffer();
+  RAYTRACER_EXPORTS ~StreamingFramebuffer();
+
+  /// Creates the file and writes its header. A band has bandTileRows rows of
+  /// tiles. Returns false if the file cannot be created or the size is not
+  /// supported (TGA is limited to 65535 pixels per side).
+  RAYTRACER_EXPORTS bool open(const std::string &fileName, size_t width, size_t height, size_t bandTileRows=4);
+
+  /// Flushes and closes the file. Returns false if a write failed or not all
+  /// bands have been written.
+  RAYTRACER_EXPORTS bool close();
+
+  size_t     width()      const { return mWidth; }
+  size_t     height()     const { return mHeight; }
+  FileFormat fileFormat() const { return mFileFormat; }
+
+  size_t bandHeight() const { return mBand.height(); }
+  size_t numBands()   const { return mBand.height() ? (mHeight+mBand.height()-1)/mBand.height() : 0; }
+
+  /// First image row of a band.
+  size_t bandOriginY(size_t band) const { return band*mBand.height(); }
+
+  /// Number of image rows of a band, less than bandHeight() for the last one.
+  size_t bandRows(size_t band) const { return std::min(mBand.height(),mHeight-this->bandOriginY(band)); }
+
+  /// Pixels of the band being rendered, row 0 is image row bandOriginY(nextBand()).
+  RAYTRACER_EXPORTS Framebuffer& band() { return mBand; }
+
+  /// Index of the band to be rendered and written next.
+  size_t nextBand() const { return mNextBand; }
+
+  /// Appends the rows of the current band to the file and moves to the next band.
+  RAYTRACER_EXPORTS bool writeBand();
+
+private:
+  std::ofstream     mFile;
+  FileFormat        mFileFormat;
+  size_t            mWidth;
+  size_t            mHeight;
+  size_t            mNextBand;
+  Framebuffer       mBand;
+  std::vector<char> mRow;      //!< one converted row
+};
+
+} //namespace rt
+
+#endif //STREAMINGFRAMEBUFFER_HPP_INCLUDE_ONCE
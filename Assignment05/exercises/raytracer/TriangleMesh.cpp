@@ -14,18 +14,27 @@ bool TriangleMesh::closestIntersectionModel(const Ray &ray, double maxLambda, Ra
   Vec3d bary;
   double lambda;
 
-  // Loop over all stored triangles to find a possible intersection between ray 
-  // and any triangle
-  for (size_t i=0;i<mTriangles.size();++i)
+  // Test all triangles packet-wise if the packed layout is up to date,
+  // otherwise loop over all stored triangles
+  size_t slot;
+  if (mTrianglePackets.size() == mTriangles.size())
   {
-    const TriangleElement &tri = mTriangles[i];
-
-    if (Helper::Helper2(ray,tri.v0,tri.v1,tri.v2,bary,lambda) &&
-      lambda > 0 && lambda < closestLambda)
+    if (mTrianglePackets.closestIntersection(ray,0,mTriangles.size(),closestLambda,closestbary,slot))
+      closestTri = mTrianglePackets.triangle(slot);
+  }
+  else
+  {
+    for (size_t i=0;i<mTriangles.size();++i)
     {
-      closestLambda = lambda;
-      closestbary = bary;
-      closestTri = (int)i;
+      const TriangleElement &tri = mTriangles[i];
+
+      if (Helper::Helper2(ray,tri.v0,tri.v1,tri.v2,bary,lambda) &&
+        lambda > 0 && lambda < closestLambda)
+      {
+        closestLambda = lambda;
+        closestbary = bary;
+        closestTri = (int)i;
+      }
     }
   }
 
@@ -47,6 +56,9 @@ bool TriangleMesh::closestIntersectionModel(const Ray &ray, double maxLambda, Ra
 
 bool TriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda) const
 {
+  if (mTrianglePackets.size() == mTriangles.size())
+    return mTrianglePackets.anyIntersection(ray,0,mTriangles.size(),maxLambda);
+
   Vec3d uvw;
   double lambda;
   for (size_t i=0;i<mTriangles.size();++i)
@@ -59,6 +71,21 @@ bool TriangleMesh::anyIntersectionModel(const Ray &ray, double maxLambda) const
   return false;
 }
 
+void TriangleMesh::initialize()
+{
+  std::vector<Vec3d> positions(3*mTriangles.size());
+  std::vector<int>   indices(3*mTriangles.size());
+  for (size_t i=0;i<mTriangles.size();++i)
+  {
+    positions[3*i+0] = mTriangles[i].v0;
+    positions[3*i+1] = mTriangles[i].v1;
+    positions[3*i+2] = mTriangles[i].v2;
+  }
+  for (size_t i=0;i<indices.size();++i)
+    indices[i] = int(i);
+  mTrianglePackets.build(positions,indices);
+}
+
 BoundingBox TriangleMesh::computeBoundingBox() const
 {
   BoundingBox bbox;
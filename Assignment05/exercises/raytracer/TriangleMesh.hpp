@@ -5,6 +5,7 @@
 
 #include "Renderable.hpp"
 #include "Triangle.hpp"
+#include "TrianglePacketArray.hpp"
 
 namespace rt
 {
@@ -68,6 +69,9 @@ public:
 
   RAYTRACER_EXPORTS bool anyIntersectionModel(const Ray &ray, double maxLambda) const override;
 
+  /// Precomputes the packed triangle layout used by the intersection tests.
+  RAYTRACER_EXPORTS void initialize() override;
+
   RAYTRACER_EXPORTS void addTriangle(const Vec3d &v0,const Vec3d &v1,const Vec3d &v2)
   {
     mTriangles.push_back(TriangleElement(v0,v1,v2));
@@ -91,6 +95,7 @@ protected:
 
 private:
   std::vector<TriangleElement> mTriangles;
+  TrianglePacketArray          mTrianglePackets;
 
 };
 } //namespace rt
@@ -0,0 +1,193 @@
+#include "TrianglePacketArray.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace rt
+{
+
+unsigned int TrianglePacketArray::lanes()
+{
+#if defined(__AVX__)
+  return 4;
+#else
+  return 1;
+#endif
+}
+
+void TrianglePacketArray::clear()
+{
+  for(unsigned int d=0;d<3;++d)
+  {
+    std::vector<double>().swap(mBase[d]);
+    std::vector<double>().swap(mEdge1[d]);
+    std::vector<double>().swap(mEdge2[d]);
+  }
+  std::vector<int>().swap(mTriangle);
+}
+
+size_t TrianglePacketArray::memoryUsage() const
+{
+  return 3*(mBase[0].size()+mEdge1[0].size()+mEdge2[0].size())*sizeof(double) +
+         mTriangle.size()*sizeof(int);
+}
+
+void TrianglePacketArray::build(const std::vector<Vec3d> &vertexPositions,
+                                const std::vector<int> &indices,
+                                const std::vector<int> &order)
+{
+  const size_t n = order.empty() ? indices.size()/3 : order.size();
+
+  //the padding allows loading a full packet from any slot
+  for(unsigned int d=0;d<3;++d)
+  {
+    mBase[d].assign(n+MaxLanes-1,0.0);
+    mEdge1[d].assign(n+MaxLanes-1,0.0);
+    mEdge2[d].assign(n+MaxLanes-1,0.0);
+  }
+  mTriangle.resize(n);
+
+  for(size_t i=0;i<n;++i)
+  {
+    const int tri = order.empty() ? int(i) : order[i];
+    const Vec3d &a = vertexPositions[indices[3*tri+0]];
+    const Vec3d &b = vertexPositions[indices[3*tri+1]];
+    const Vec3d &c = vertexPositions[indices[3*tri+2]];
+    for(unsigned int d=0;d<3;++d)
+    {
+      mBase[d][i]  = c[d];
+      mEdge1[d][i] = a[d]-c[d];
+      mEdge2[d][i] = b[d]-c[d];
+    }
+    mTriangle[i] = tri;
+  }
+}
+
+unsigned int TrianglePacketArray::intersectPacket(const Ray &ray, size_t slot, size_t end, double maxLambda,
+                                                  double *lambda, double *u, double *v) const
+{
+  const Vec3d &o = ray.origin();
+  const Vec3d &d = ray.direction();
+
+#if defined(__AVX__)
+  const __m256d signBit = _mm256_set1_pd(-0.0);
+  const __m256d zero    = _mm256_setzero_pd();
+  const __m256d one     = _mm256_set1_pd(1.0);
+
+  const __m256d ndx = _mm256_set1_pd(-d[0]);
+  const __m256d ndy = _mm256_set1_pd(-d[1]);
+  const __m256d ndz = _mm256_set1_pd(-d[2]);
+
+  const __m256d e1x = _mm256_loadu_pd(&mEdge1[0][slot]);
+  const __m256d e1y = _mm256_loadu_pd(&mEdge1[1][slot]);
+  const __m256d e1z = _mm256_loadu_pd(&mEdge1[2][slot]);
+  const __m256d e2x = _mm256_loadu_pd(&mEdge2[0][slot]);
+  const __m256d e2y = _mm256_loadu_pd(&mEdge2[1][slot]);
+  const __m256d e2z = _mm256_loadu_pd(&mEdge2[2][slot]);
+
+  const __m256d ttx = _mm256_sub_pd(_mm256_set1_pd(o[0]),_mm256_loadu_pd(&mBase[0][slot]));
+  const __m256d tty = _mm256_sub_pd(_mm256_set1_pd(o[1]),_mm256_loadu_pd(&mBase[1][slot]));
+  const __m256d ttz = _mm256_sub_pd(_mm256_set1_pd(o[2]),_mm256_loadu_pd(&mBase[2][slot]));
+
+  //pp = e2 x -d, qq = e1 x tt
+  const __m256d ppx = _mm256_sub_pd(_mm256_mul_pd(e2y,ndz),_mm256_mul_pd(e2z,ndy));
+  const __m256d ppy = _mm256_sub_pd(_mm256_mul_pd(e2z,ndx),_mm256_mul_pd(e2x,ndz));
+  const __m256d ppz = _mm256_sub_pd(_mm256_mul_pd(e2x,ndy),_mm256_mul_pd(e2y,ndx));
+  const __m256d qqx = _mm256_sub_pd(_mm256_mul_pd(e1y,ttz),_mm256_mul_pd(e1z,tty));
+  const __m256d qqy = _mm256_sub_pd(_mm256_mul_pd(e1z,ttx),_mm256_mul_pd(e1x,ttz));
+  const __m256d qqz = _mm256_sub_pd(_mm256_mul_pd(e1x,tty),_mm256_mul_pd(e1y,ttx));
+
+  const __m256d detA = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e1x,ppx),_mm256_mul_pd(e1y,ppy)),
+                                     _mm256_mul_pd(e1z,ppz));
+  const __m256d uu = _mm256_div_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ttx,ppx),_mm256_mul_pd(tty,ppy)),
+                                                 _mm256_mul_pd(ttz,ppz)),detA);
+  const __m256d vv = _mm256_div_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ndx,qqx),_mm256_mul_pd(ndy,qqy)),
+                                                 _mm256_mul_pd(ndz,qqz)),detA);
+  const __m256d ww = _mm256_sub_pd(_mm256_sub_pd(one,uu),vv);
+  const __m256d tt = _mm256_div_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_xor_pd(e2x,signBit),qqx),
+                                                               _mm256_mul_pd(_mm256_xor_pd(e2y,signBit),qqy)),
+                                                 _mm256_mul_pd(_mm256_xor_pd(e2z,signBit),qqz)),detA);
+
+  __m256d mask = _mm256_cmp_pd(_mm256_andnot_pd(signBit,detA),_mm256_set1_pd(Math::safetyEps()),_CMP_GE_OQ);
+  mask = _mm256_and_pd(mask,_mm256_and_pd(_mm256_cmp_pd(uu,zero,_CMP_GE_OQ),_mm256_cmp_pd(uu,one,_CMP_LE_OQ)));
+  mask = _mm256_and_pd(mask,_mm256_and_pd(_mm256_cmp_pd(vv,zero,_CMP_GE_OQ),_mm256_cmp_pd(vv,one,_CMP_LE_OQ)));
+  mask = _mm256_and_pd(mask,_mm256_and_pd(_mm256_cmp_pd(ww,zero,_CMP_GE_OQ),_mm256_cmp_pd(ww,one,_CMP_LE_OQ)));
+  mask = _mm256_and_pd(mask,_mm256_and_pd(_mm256_cmp_pd(tt,zero,_CMP_GT_OQ),
+                                          _mm256_cmp_pd(tt,_mm256_set1_pd(maxLambda),_CMP_LT_OQ)));
+
+  _mm256_storeu_pd(lambda,tt);
+  _mm256_storeu_pd(u,uu);
+  _mm256_storeu_pd(v,vv);
+
+  unsigned int hits = unsigned(_mm256_movemask_pd(mask));
+  if(end-slot < 4)
+    hits &= (1u << (end-slot))-1;
+  return hits;
+#else
+  //same arithmetic as Helper::Helper2 for the single lane at slot
+  (void)end;
+  const double e1x = mEdge1[0][slot], e1y = mEdge1[1][slot], e1z = mEdge1[2][slot];
+  const double e2x = mEdge2[0][slot], e2y = mEdge2[1][slot], e2z = mEdge2[2][slot];
+  const double ttx = o[0]-mBase[0][slot], tty = o[1]-mBase[1][slot], ttz = o[2]-mBase[2][slot];
+
+  const double ppx = e2y*-d[2] - e2z*-d[1];
+  const double ppy = e2z*-d[0] - e2x*-d[2];
+  const double ppz = e2x*-d[1] - e2y*-d[0];
+  const double qqx = e1y*ttz - e1z*tty;
+  const double qqy = e1z*ttx - e1x*ttz;
+  const double qqz = e1x*tty - e1y*ttx;
+
+  const double detA = e1x*ppx + e1y*ppy + e1z*ppz;
+  if(fabs(detA) < Math::safetyEps())
+    return 0;
+
+  u[0] = (ttx*ppx + tty*ppy + ttz*ppz)/detA;
+  v[0] = (-d[0]*qqx + -d[1]*qqy + -d[2]*qqz)/detA;
+  const double w = 1-u[0]-v[0];
+  lambda[0] = (-e2x*qqx + -e2y*qqy + -e2z*qqz)/detA;
+
+  if(u[0]<0 || u[0]>1 || v[0]<0 || v[0]>1 || w<0 || w>1)
+    return 0;
+  return lambda[0] > 0 && lambda[0] < maxLambda ? 1u : 0u;
+#endif
+}
+
+bool TrianglePacketArray::closestIntersection(const Ray &ray, size_t first, size_t count,
+                                              double &lambda, Vec3d &uvw, size_t &slot) const
+{
+  double packetLambda[MaxLanes], packetU[MaxLanes], packetV[MaxLanes];
+  bool found = false;
+
+  const size_t end = first+count;
+  const unsigned int step = lanes();
+  for(size_t i=first;i<end;i+=step)
+  {
+    unsigned int hits = intersectPacket(ray,i,end,lambda,packetLambda,packetU,packetV);
+    for(unsigned int k=0;hits;++k,hits>>=1)
+    {
+      if((hits & 1) && packetLambda[k] < lambda)
+      {
+        lambda = packetLambda[k];
+        uvw = Vec3d(packetU[k],packetV[k],1-packetU[k]-packetV[k]);
+        slot = i+k;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+bool TrianglePacketArray::anyIntersection(const Ray &ray, size_t first, size_t count, double maxLambda) const
+{
+  double packetLambda[MaxLanes], packetU[MaxLanes], packetV[MaxLanes];
+
+  const size_t end = first+count;
+  const unsigned int step = lanes();
+  for(size_t i=first;i<end;i+=step)
+    if(intersectPacket(ray,i,end,maxLambda,packetLambda,packetU,packetV))
+      return true;
+  return false;
+}
+
+} //namespace rt
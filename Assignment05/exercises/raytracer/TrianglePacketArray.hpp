@@ -0,0 +1,68 @@
+#ifndef TRIANGLEPACKETARRAY_HPP_INCLUDE_ONCE
+#define TRIANGLEPACKETARRAY_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <vector>
+#include "Math.hpp"
+#include "Ray.hpp"
+
+namespace rt
+{
+
+/// Structure-of-arrays triangle storage for intersecting one ray with several
+/// triangles at once. Every triangle is stored as base vertex and two edges
+/// following the formulation of Helper::Helper1, i.e. for a triangle (a,b,c)
+/// the base is c and the edges are a-c and b-c. The kernels process lanes()
+/// triangles per step, four when the library is compiled with AVX and one
+/// otherwise.
+class TrianglePacketArray
+{
+public:
+  static const unsigned int MaxLanes = 4;
+
+  RAYTRACER_EXPORTS TrianglePacketArray() {}
+
+  /// Number of triangles intersected per step.
+  RAYTRACER_EXPORTS static unsigned int lanes();
+
+  /// Stores the triangles given by indices (three per triangle) in the given
+  /// order. An empty order stores the triangles in index order.
+  RAYTRACER_EXPORTS void build(const std::vector<Vec3d> &vertexPositions,
+                               const std::vector<int> &indices,
+                               const std::vector<int> &order=std::vector<int>());
+
+  RAYTRACER_EXPORTS void clear();
+
+  RAYTRACER_EXPORTS size_t size() const { return mTriangle.size(); }
+
+  /// Number of bytes occupied by the packed triangles.
+  RAYTRACER_EXPORTS size_t memoryUsage() const;
+
+  /// Maps a storage slot back to the index of the triangle.
+  RAYTRACER_EXPORTS int triangle(size_t slot) const { return mTriangle[slot]; }
+
+  /// Finds the closest intersection with the triangles in [first,first+count)
+  /// which is closer than lambda. On success lambda, the barycentric
+  /// coordinates and the slot of the hit triangle are updated.
+  RAYTRACER_EXPORTS bool closestIntersection(const Ray &ray, size_t first, size_t count,
+                                             double &lambda, Vec3d &uvw, size_t &slot) const;
+
+  /// Tests if any triangle in [first,first+count) is hit before maxLambda.
+  RAYTRACER_EXPORTS bool anyIntersection(const Ray &ray, size_t first, size_t count, double maxLambda) const;
+
+private:
+  // Intersects lanes() triangles starting at slot, lanes at or behind end are
+  // ignored. Returns a bit mask of the lanes hit before maxLambda.
+  unsigned int intersectPacket(const Ray &ray, size_t slot, size_t end, double maxLambda,
+                               double *lambda, double *u, double *v) const;
+
+  std::vector<double> mBase[3];   //!< per component, padded by MaxLanes-1 entries
+  std::vector<double> mEdge1[3];
+  std::vector<double> mEdge2[3];
+  std::vector<int>    mTriangle;  //!< triangle index per slot
+};
+
+} //namespace rt
+
+#endif //TRIANGLEPACKETARRAY_HPP_INCLUDE_ONCE
@@ -0,0 +1,48 @@
+#include "VertexIndexTable.hpp"
+
+namespace rt
+{
+
+VertexIndexTable::VertexIndexTable() : mSize(0)
+{
+}
+
+void VertexIndexTable::reserve(size_t n)
+{
+  size_t numSlots = 16;
+  while (numSlots < 2*n)
+    numSlots *= 2;
+  if (numSlots > mSlots.size())
+    this->rehash(numSlots);
+}
+
+void VertexIndexTable::clear()
+{
+  std::vector<Slot>().swap(mSlots);
+  mSize = 0;
+}
+
+void VertexIndexTable::rehash(size_t numSlots)
+{
+  Slot empty;
+  empty.key[0] = empty.key[1] = empty.key[2] = 0;
+  empty.index = -1;
+
+  std::vector<Slot> slots(numSlots,empty);
+  slots.swap(mSlots);
+
+  //reinsert the existing entries
+  const size_t mask = numSlots-1;
+  for (size_t j=0;j<slots.size();++j)
+  {
+    if (slots[j].index < 0)
+      continue;
+    const Vec3i key(slots[j].key[0],slots[j].key[1],slots[j].key[2]);
+    size_t i = hash(key) & mask;
+    while (mSlots[i].index >= 0)
+      i = (i+1) & mask;
+    mSlots[i] = slots[j];
+  }
+}
+
+} //namespace rt
@@ -0,0 +1,82 @@
+#ifndef VERTEXINDEXTABLE_HPP_INCLUDE_ONCE
+#define VERTEXINDEXTABLE_HPP_INCLUDE_ONCE
+
+#include "raytracerConfig.hpp"
+
+#include <algorithm>
+#include <vector>
+#include "Math.hpp"
+
+namespace rt
+{
+
+/// Open-addressing hash table from (v,vt,vn) index triples to flattened
+/// vertex indices, used to deduplicate OBJ face corners. Entries are
+/// stored inline in a single array with linear probing, so there is no
+/// allocation per vertex and a lookup touches one or two cache lines.
+class VertexIndexTable
+{
+public:
+  RAYTRACER_EXPORTS VertexIndexTable();
+
+  /// Prepares the table for n entries without rehashing.
+  RAYTRACER_EXPORTS void reserve(size_t n);
+  RAYTRACER_EXPORTS void clear();
+  RAYTRACER_EXPORTS size_t size() const { return mSize; }
+
+  /// Returns the index stored for key. If the key is not contained yet,
+  /// index is stored for it and returned, inserted is set to true.
+  inline int insert(const Vec3i &key, int index, bool &inserted)
+  {
+    if (2*(mSize+1) > mSlots.size())
+      this->rehash(std::max<size_t>(2*mSlots.size(),16));
+
+    const size_t mask = mSlots.size()-1;
+    for (size_t i=hash(key) & mask;;i=(i+1) & mask)
+    {
+      Slot &slot = mSlots[i];
+      if (slot.index < 0)
+      {
+        slot.key[0] = key[0];
+        slot.key[1] = key[1];
+        slot.key[2] = key[2];
+        slot.index  = index;
+        ++mSize;
+        inserted = true;
+        return index;
+      }
+      if (slot.key[0]==key[0] && slot.key[1]==key[1] && slot.key[2]==key[2])
+      {
+        inserted = false;
+        return slot.index;
+      }
+    }
+  }
+
+private:
+  struct Slot
+  {
+    int key[3];
+    int index;    //!< negative for empty slots
+  };
+
+  static inline size_t hash(const Vec3i &key)
+  {
+    //multiplicative mixing, the high bits are folded into the low ones
+    unsigned long long h = (unsigned int)key[0];
+    h = (h*0x9E3779B97F4A7C15ull) ^ (unsigned int)key[1];
+    h = (h*0x9E3779B97F4A7C15ull) ^ (unsigned int)key[2];
+    h *= 0x9E3779B97F4A7C15ull;
+    return size_t(h ^ (h >> 32));
+  }
+
+  // Exported, as the inline insert() reaches it from other modules
+  RAYTRACER_EXPORTS void rehash(size_t numSlots);
+
+  std::vector<Slot> mSlots;     //!< power of two, at most half full
+  size_t            mSize;
+};
+
+} //namespace rt
+
+#endif //VERTEXINDEXTABLE_HPP_INCLUDE_ONCE
@@ -13,10 +13,28 @@
 #include <raytracer/CheckerMaterial.hpp>
 
 #include <raytracer/TriangleMesh.hpp>
+#include <raytracer/MeshLoader.hpp>
 #include <raytracer/PhongMaterial.hpp>
+#include <raytracer/PostProcess.hpp>
+#include <raytracer/Framebuffer.hpp>
+#include <raytracer/FeatureBuffer.hpp>
+#include <raytracer/Denoiser.hpp>
+#include <raytracer/FrameStream.hpp>
 #include <opengl/RaytracerWindow.hpp>
 
 bool gShowWindow=true;
+bool gDrawProgressive=false; ///< Show the tiles while they are rendered, a cancelled render is not saved
+bool gPreviewScene=false; ///< Place the camera in a rasterized preview before rendering
+bool gDenoise=false;      ///< Filter the noise of few samples guided by the normals, depths and albedos of the first hits
+//a long render can save its progress to a checkpoint file, so that it resumes
+//there when the program is started again after an interruption
+std::string gCheckpointPath="";
+//the result can go into a frame stream instead of a TGA file, e.g. a named pipe
+//read by "ffmpeg -i pipe out.mp4" or "-" for standard output. Alternatively an
+//inherited file descriptor is used, e.g. 3 when started with "3>result.y4m"
+std::string gStreamPath="";
+int gStreamFileDescriptor=-1;
+rt::FrameStream::Format gStreamFormat=rt::FrameStream::Y4M;
 int imageWidth=512;
 int imageHeight=512;
 std::string gDataPath= ""; ///< The path pointing to the resources (OBJ, shader)
@@ -82,6 +100,8 @@ std::shared_ptr<rt::Scene> makeMeshScene(std::string fileName,bool addArrows)
   std::shared_ptr<rt::Scene>    scene     = std::make_shared<rt::Scene>();
   scene->setBackgroundColor(rt::Vec4d(0,0,0,1));
 
+  //all meshes are loaded and their BVHs built concurrently
+  rt::MeshLoader loader;
 
   if(addArrows)
   {
@@ -90,19 +110,19 @@ std::shared_ptr<rt::Scene> makeMeshScene(std::string fileName,bool addArrows)
     std::shared_ptr<rt::Material> materialBlue = std::make_shared<rt::PhongMaterial>  (rt::Vec3d(0.1,0.1,0.8),0.2,1000.0);
 
     std::shared_ptr<rt::BVHIndexedTriangleMesh> meshXAxis = std::make_shared<rt::BVHIndexedTriangleMesh>();
-    meshXAxis->loadFromOBJ(gDataPath+"assets/arrowZ.obj");
+    loader.add(meshXAxis,gDataPath+"assets/arrowZ.obj");
     meshXAxis->transform().rotate(90.f,0,1,0);
     meshXAxis->setMaterial(materialRed);
     scene->addRenderable(meshXAxis);
 
     std::shared_ptr<rt::BVHIndexedTriangleMesh> meshYAxis = std::make_shared<rt::BVHIndexedTriangleMesh>();
-    meshYAxis->loadFromOBJ(gDataPath+"assets/arrowZ.obj");
+    loader.add(meshYAxis,gDataPath+"assets/arrowZ.obj");
     meshYAxis->transform().rotate(-90.f,1,0,0);
     meshYAxis->setMaterial(materialGreen);
     scene->addRenderable(meshYAxis);
 
     std::shared_ptr<rt::BVHIndexedTriangleMesh> meshZAxis = std::make_shared<rt::BVHIndexedTriangleMesh>();
-    meshZAxis->loadFromOBJ(gDataPath+"assets/arrowZ.obj");
+    loader.add(meshZAxis,gDataPath+"assets/arrowZ.obj");
     meshZAxis->setMaterial(materialBlue);
     scene->addRenderable(meshZAxis);
   }
@@ -130,11 +150,14 @@ std::shared_ptr<rt::Scene> makeMeshScene(std::string fileName,bool addArrows)
 
   scene->setCamera(camera);
 
+  //binary meshes written by mesh_converter are loaded without parsing and BVH build
   std::shared_ptr<rt::BVHIndexedTriangleMesh> mesh = std::make_shared<rt::BVHIndexedTriangleMesh>();
-  if(mesh->loadFromOBJ(gDataPath+fileName))
+  loader.add(mesh,gDataPath+fileName);
+  loader.run();
+  if(!mesh->triangleIndices().empty())
   {
     std::cout<<"Loaded BVHMesh with "<<mesh->triangleIndices().size()/3<<
-      " triangles and "<< mesh->vertexPositions().size()<<" vertices"<<std::endl;
+      " triangles and "<< mesh->numVertices()<<" vertices"<<std::endl;
 
     std::shared_ptr<rt::Material> materialObject = std::make_shared<rt::PhongMaterial>(rt::Vec3d(1,0.4,0.1),0.2,  50.0);
     mesh->setMaterial(materialObject);
@@ -166,6 +189,17 @@ int main(int argc, char** argv)
   //uncomment the line below for the bonus task
   //std::shared_ptr<rt::Scene> scene = makeMeshScene("assets/8.obj",showArrows);
 
+  //instead of editing the camera in makeTask2Scene and rendering again, it can be
+  //placed with the mouse, the chosen setup is printed for copying into the scene
+  if(gPreviewScene)
+  {
+    rt::RaytracerWindow previewWindow(imageWidth,imageHeight);
+    if(!previewWindow.init())
+      return -1;
+    if(!previewWindow.preview(scene,gDataPath))
+      return 0;
+  }
+
   std::shared_ptr<rt::Raytracer> raytracer = std::make_shared<rt::Raytracer>();
   //set maxDepth = 50 like this
   //std::shared_ptr<rt::Raytracer> raytracer = std::make_shared<rt::Raytracer>(50);
@@ -174,14 +208,68 @@ int main(int argc, char** argv)
   // Note the fastest way to execute your program using Visual Studio is pressing Ctrl+F5
   // in Release mode. This will detach the rendering process from the debugger.
 
-  rt::Chrono before = std::chrono::high_resolution_clock::now();
-  raytracer->renderToImage(image);
-  rt::ChronoDuration timeToRender = std::chrono::duration_cast<rt::ChronoDuration>(std::chrono::high_resolution_clock::now()-before);
-  std::cout<<"Rendering took "<<timeToRender.count()<<" seconds"<<std::endl;
+  //to check a detail, only a part of the frame can be traced with the same rays by
+  //rendering like this instead:
+  //raytracer->renderToImage(image,nullptr,rt::CropWindow(imageWidth,imageHeight,200,300,64,64));
 
-  image->saveToTGA(std::string(argv[0])+"_result");
+  //only renderToImage records the features, the tiled renders have nothing to denoise
+  std::shared_ptr<rt::FeatureBuffer> features;
+  if(gDrawProgressive)
+  {
+    //the window stays open with the final image, Escape cancels the render
+    std::shared_ptr<rt::Framebuffer> framebuffer = std::make_shared<rt::Framebuffer>(imageWidth,imageHeight);
+    rt::RaytracerWindow progressiveWindow(imageWidth,imageHeight);
+    if(!progressiveWindow.init())
+      return -1;
+    if(!progressiveWindow.drawProgressive(raytracer,framebuffer))
+      return 0;
+    framebuffer->toImage(*image);
+  }
+  else if(!gCheckpointPath.empty())
+  {
+    std::shared_ptr<rt::Framebuffer> framebuffer = std::make_shared<rt::Framebuffer>(imageWidth,imageHeight);
+    if(!raytracer->renderWithCheckpoints(framebuffer,gCheckpointPath))
+      return -1;
+    framebuffer->toImage(*image);
+  }
+  else
+  {
+    if(gDenoise)
+      features = std::make_shared<rt::FeatureBuffer>();
+    rt::Chrono before = std::chrono::high_resolution_clock::now();
+    raytracer->renderToImage(image,features);
+    rt::ChronoDuration timeToRender = std::chrono::duration_cast<rt::ChronoDuration>(std::chrono::high_resolution_clock::now()-before);
+    std::cout<<"Rendering took "<<timeToRender.count()<<" seconds"<<std::endl;
+  }
+
+  //the denoiser works on the linear colors, so it runs before the post processing
+  if(features)
+  {
+    rt::Denoiser denoiser;
+    if(!denoiser.apply(*image,*features,*image))
+      return -1;
+  }
+
+  //instead of changing intensityFactor and rendering again, the result can be
+  //tone mapped, e.g. post.setToneMapping(rt::PostProcess::Reinhard);
+  //post.setEncoding(rt::PostProcess::SRGB); The defaults only clamp.
+  rt::PostProcess post;
+  post.apply(*image,*image);
+
+  if(!gStreamPath.empty() || gStreamFileDescriptor >= 0)
+  {
+    rt::FrameStream stream;
+    const bool opened = gStreamPath.empty() ?
+      stream.open(gStreamFileDescriptor,image->width(),image->height(),gStreamFormat) :
+      stream.open(gStreamPath,image->width(),image->height(),gStreamFormat);
+    if(!opened || !stream.writeFrame(*image) || !stream.close())
+      return -1;
+  }
+  else
+    image->saveToTGA(std::string(argv[0])+"_result");
 
-  if(gShowWindow)
+  //the progressive window has shown the image already
+  if(gShowWindow && !gDrawProgressive)
   {
     rt::RaytracerWindow win(imageWidth,imageHeight);
     if(win.init())